@@ -0,0 +1,89 @@
+// Bulk keyframes -> engine load throughput on a synthetic project, from keyframe rows and then
+// from packed columnar track chunks (schema V0004).
+// Usage: desktop_loader_bench [--rows N] [--tracks T] [--db path]
+#include "verity/db.hpp"
+#include "verity/engine_loader.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <sqlite3.h>
+#include <string>
+
+using namespace verity;
+
+static void exec(sqlite3* db, const char* sql) {
+    char* err = nullptr;
+    if (sqlite3_exec(db, sql, nullptr, nullptr, &err) != SQLITE_OK) {
+        std::cerr << "SQL error: " << (err ? err : "") << "\n";
+        sqlite3_free(err);
+        std::exit(1);
+    }
+}
+
+static void build_project(const std::string& path, int rows, int tracks) {
+    std::filesystem::remove(path);
+    sqlite3* db = nullptr;
+    if (sqlite3_open(path.c_str(), &db) != SQLITE_OK) std::exit(1);
+    exec(db, "PRAGMA journal_mode=WAL;");
+    exec(db, "CREATE TABLE projects(id TEXT PRIMARY KEY, name TEXT, version INTEGER, created_at INTEGER, updated_at INTEGER);");
+    exec(db, "CREATE TABLE keyframes(id TEXT PRIMARY KEY, track_id TEXT NOT NULL, t_ms INTEGER NOT NULL, value_json TEXT NOT NULL, interp TEXT NOT NULL, created_at INTEGER, updated_at INTEGER);");
+    exec(db, "CREATE INDEX idx_keyframes_track_time ON keyframes(track_id, t_ms);");
+    exec(db, "CREATE TABLE revisions(id INTEGER PRIMARY KEY AUTOINCREMENT, project_id TEXT, user TEXT, label TEXT, diff_json TEXT, created_at INTEGER);");
+    exec(db, "BEGIN");
+    sqlite3_stmt* st = nullptr;
+    sqlite3_prepare_v2(db, "INSERT INTO keyframes VALUES(?,?,?,?,'auto',0,0)", -1, &st, nullptr);
+    const int per_track = rows / tracks;
+    char id[32], track[32], value[96];
+    for (int t = 0; t < tracks; ++t) {
+        std::snprintf(track, sizeof(track), "track-%05d", t);
+        for (int k = 0; k < per_track; ++k) {
+            std::snprintf(id, sizeof(id), "k-%05d-%06d", t, k);
+            std::snprintf(value, sizeof(value), "{\"x\":%.3f,\"y\":%.3f,\"z\":%d,\"in\":0.5,\"out\":-0.25}",
+                          t * 0.5 + k * 0.01, k * 0.02, k);
+            sqlite3_bind_text(st, 1, id, -1, SQLITE_STATIC);
+            sqlite3_bind_text(st, 2, track, -1, SQLITE_STATIC);
+            sqlite3_bind_int(st, 3, k * 40);
+            sqlite3_bind_text(st, 4, value, -1, SQLITE_STATIC);
+            sqlite3_step(st);
+            sqlite3_reset(st);
+        }
+    }
+    sqlite3_finalize(st);
+    exec(db, "COMMIT");
+    sqlite3_close(db);
+}
+
+int main(int argc, char** argv) {
+    int rows = 1000000;
+    int tracks = 1000;
+    std::string path = "loader_bench.db";
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string flag = argv[i];
+        if (flag == "--rows") rows = std::atoi(argv[i + 1]);
+        else if (flag == "--tracks") tracks = std::atoi(argv[i + 1]);
+        else if (flag == "--db") path = argv[i + 1];
+    }
+    build_project(path, rows, tracks);
+
+    SqliteStorage storage(path);
+    auto run = [&](const char* source) {
+        for (unsigned threads : {1u, 0u}) {
+            EngineLoadOptions opts;
+            opts.threads = threads;
+            auto r = load_engine_curves(storage, opts);
+            std::cout << "source=" << source << ", threads=" << (threads ? std::to_string(threads) : std::string("auto"))
+                      << ", rows=" << r.rows << ", curves=" << r.curves.size() << ", chunks=" << r.packed_chunks
+                      << ", malformed=" << r.malformed_rows << ", seconds=" << r.seconds
+                      << ", rows_per_s=" << (r.seconds > 0 ? r.rows / r.seconds : 0.0) << "\n";
+        }
+    };
+    run("rows");
+    const auto t0 = std::chrono::steady_clock::now();
+    const size_t packed = storage.packTrackChunks();
+    std::cout << "packed tracks=" << packed << ", seconds="
+              << std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count() << "\n";
+    run("chunks");
+    return 0;
+}
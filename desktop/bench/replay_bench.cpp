@@ -0,0 +1,282 @@
+// Restore throughput on a synthetic revision log.
+// Usage: desktop_replay_bench [--revisions N] [--selection N] [--jump N] [--db path] [--skip-restore 1]
+//                             [--script N]
+//   alloc:   --script AddKeyframe edits in batches of 1000 against a storage that keeps nothing;
+//            global operator new calls per edit with execute(make_unique) (heap) and with
+//            emplace with explicit (arena) and generated (arena_gen) ids, and operator delete calls
+//            per edit when the history is dropped
+//   parse:   command_from_diff over every revision (no storage)
+//   encode:  diffJson vs DiffWriter over the parsed commands; bytes per revision for each form
+//   decode:  command_from_blob over the binary log (compare with parse)
+//   move:    one MoveSelection of --selection uuid-keyed keys, JSON vs binary size and time
+//   restore: restore_from_revisions, one transaction and one new revision row per entry
+//   replay:  replay_revisions, every revision applied inside one transaction, no revision rows
+//            (replay_bin: the same from the binary log)
+//   undo1:   --jump entries undone with undo(), one transaction each (then redone with redoN)
+//   undoN:   the same entries undone with one undoN() call
+// The log mixes add_key (60%), move (30%, half in the legacy escaped-item form) and batches of
+// add_key + bulk_move (10%).
+#include "commands/add_keyframe.hpp"
+#include "commands/move_selection.hpp"
+#include "verity/db.hpp"
+#include "verity/diff_codec.hpp"
+#include "verity/keyframe_store.hpp"
+#include "verity/replay.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <sqlite3.h>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace verity;
+
+// Every global allocation is counted (read by the alloc section only)
+static std::atomic<size_t> g_allocs {0};
+static std::atomic<size_t> g_frees {0};
+
+void* operator new(size_t n) {
+    g_allocs.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(n ? n : 1)) return p;
+    throw std::bad_alloc();
+}
+void operator delete(void* p) noexcept {
+    if (p) g_frees.fetch_add(1, std::memory_order_relaxed);
+    std::free(p);
+}
+void operator delete(void* p, size_t) noexcept { operator delete(p); }
+// std::pmr::new_delete_resource allocates through the aligned forms
+void* operator new(size_t n, std::align_val_t al) {
+    g_allocs.fetch_add(1, std::memory_order_relaxed);
+    const size_t a = static_cast<size_t>(al);
+    if (void* p = std::aligned_alloc(a, (n + a - 1) / a * a)) return p;
+    throw std::bad_alloc();
+}
+void operator delete(void* p, std::align_val_t) noexcept { operator delete(p); }
+void operator delete(void* p, size_t, std::align_val_t) noexcept { operator delete(p); }
+
+static void exec(sqlite3* db, const char* sql) {
+    char* err = nullptr;
+    if (sqlite3_exec(db, sql, nullptr, nullptr, &err) != SQLITE_OK) {
+        std::cerr << "SQL error: " << (err ? err : "") << "\n";
+        sqlite3_free(err);
+        std::exit(1);
+    }
+}
+
+static void create_project(const std::string& path) {
+    std::filesystem::remove(path);
+    std::filesystem::remove(path + "-wal");
+    std::filesystem::remove(path + "-shm");
+    sqlite3* db = nullptr;
+    if (sqlite3_open(path.c_str(), &db) != SQLITE_OK) std::exit(1);
+    exec(db, "CREATE TABLE projects(id TEXT PRIMARY KEY, name TEXT, version INTEGER, created_at INTEGER, updated_at INTEGER);");
+    exec(db, "INSERT INTO projects VALUES('p1','bench',1,0,0);");
+    exec(db, "CREATE TABLE keyframes(id TEXT PRIMARY KEY, track_id TEXT NOT NULL, t_ms INTEGER NOT NULL, value_json TEXT NOT NULL, interp TEXT NOT NULL, created_at INTEGER, updated_at INTEGER);");
+    exec(db, "CREATE INDEX idx_keyframes_track_time ON keyframes(track_id, t_ms);");
+    exec(db, "CREATE TABLE revisions(id INTEGER PRIMARY KEY AUTOINCREMENT, project_id TEXT, user TEXT, label TEXT, diff_json TEXT, created_at INTEGER, diff_blob BLOB);");
+    sqlite3_close(db);
+}
+
+static std::string add_key(int key, int t_ms) {
+    return "{\"op\":\"add_key\",\"track_id\":\"track" + std::to_string(key % 32) + "\",\"t_ms\":" + std::to_string(t_ms) +
+           ",\"id\":\"k" + std::to_string(key) + "\",\"interp\":\"auto\",\"value_json\":\"{\\\"x\\\":" +
+           std::to_string(key) + "}\"}";
+}
+
+static std::vector<RevisionRecord> synthetic_log(int n) {
+    std::vector<RevisionRecord> log;
+    log.reserve(size_t(n));
+    int keys = 0;
+    for (int i = 0; i < n; ++i) {
+        const int slot = i % 10;
+        if (slot < 6 || keys == 0) {
+            log.push_back({"AddKeyframe", add_key(keys, keys * 10)});
+            ++keys;
+        } else if (slot < 9) {
+            const std::string id = "k" + std::to_string((i * 7919) % keys);
+            const std::string item = slot == 6 ? "{\\\"id\\\":\\\"" + id + "\\\",\\\"orig_t_ms\\\":100}"
+                                               : "{\"id\":\"" + id + "\",\"orig_t_ms\":100}";
+            log.push_back({"MoveSelection", "{\"op\":\"move\",\"delta\":5,\"items\":[" + item + "]}"});
+        } else {
+            const std::string moved = "\"k" + std::to_string(keys - 1) + "\",\"k" + std::to_string(keys) + "\"";
+            log.push_back({"Paste", "{\"op\":\"batch\",\"label\":\"Paste\",\"items\":[" + add_key(keys, keys * 10) +
+                                        ",{\"op\":\"bulk_move\",\"delta\":3,\"ids\":[" + moved + "]}]}"});
+            ++keys;
+        }
+    }
+    return log;
+}
+
+static double seconds_since(std::chrono::steady_clock::time_point t0) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+}
+
+static void report(const char* mode, size_t n, double seconds) {
+    std::printf("%-8s n=%-8zu seconds=%.3f per_s=%.0f\n", mode, n, seconds, seconds > 0 ? double(n) / seconds : 0.0);
+}
+
+static void report_size(const char* mode, size_t n, size_t bytes, double seconds) {
+    std::printf("%-8s n=%-8zu bytes=%-10zu per_rev=%.1f seconds=%.3f MB/s=%.1f\n", mode, n, bytes,
+                n ? double(bytes) / double(n) : 0.0, seconds, seconds > 0 ? double(bytes) / seconds / 1e6 : 0.0);
+}
+
+static std::string uuid_for(int i) {
+    char buf[37];
+    std::snprintf(buf, sizeof(buf), "%08x-%04x-%04x-%04x-%012x", unsigned(i) * 2654435761u, unsigned(i) & 0xffff,
+                  0x4000u | (unsigned(i) & 0xfff), 0x8000u | (unsigned(i) & 0x3fff), unsigned(i));
+    return buf;
+}
+
+// Binary revisions into nowhere: what remains is the command stack's own allocation
+class SinkStorage : public IStorage, public IKeyframeStore {
+public:
+    void begin() override {}
+    void commit() override {}
+    void rollback() override {}
+    void addRevision(const RevisionRecord& r) override { bytes += r.diff_blob.size(); }
+    bool storesDiffBlobs() const override { return true; }
+    void insertKeyframe(const KeyId&, std::string_view, int, std::string_view, std::string_view) override {}
+    void deleteKeyframe(const KeyId&) override {}
+    void updateKeyframeTime(const KeyId&, int) override {}
+    void insertKeyframes(const KeyframeBatch&) override {}
+    void shiftKeyframes(const KeyIdList&, int) override {}
+    KeyframeBatch deleteKeyframes(const KeyIdList&) override { return {}; }
+    size_t bytes {0};
+};
+
+static void run_alloc(int edits) {
+    const int per_batch = 1000;
+    const KeyId track = KeyId::generate();
+    KeyIdList ids;
+    std::vector<std::string> values;
+    for (int i = 0; i < edits; ++i) {
+        ids.push_back(KeyId::generate());
+        values.push_back("{\"x\":" + std::to_string(i) + ",\"in\":0.25,\"out\":0.25}");
+    }
+    // heap: execute(make_unique); arena: emplace with explicit ids; arena_gen: emplace, generated ids
+    for (const std::string_view mode : {"heap", "arena", "arena_gen"}) {
+        const bool arena = mode != "heap";
+        const bool generated = mode == "arena_gen";
+        SinkStorage sink;
+        auto stack = std::make_unique<CommandStack>(sink);
+        const size_t allocs0 = g_allocs.load();
+        const auto t0 = std::chrono::steady_clock::now();
+        for (int i = 0; i < edits; ++i) {
+            if (i % per_batch == 0) stack->beginBatch("Script");
+            if (generated) stack->emplace<AddKeyframeCommand>(track, i * 10, values[size_t(i)], "bezier");
+            else if (arena) stack->emplace<AddKeyframeCommand>(track, i * 10, values[size_t(i)], "bezier", ids[size_t(i)]);
+            else stack->execute(std::make_unique<AddKeyframeCommand>(track, i * 10, values[size_t(i)], "bezier", ids[size_t(i)]));
+            if (i % per_batch == per_batch - 1 || i + 1 == edits) stack->endBatch();
+        }
+        const double seconds = seconds_since(t0);
+        const size_t allocs = g_allocs.load() - allocs0;
+        const size_t frees0 = g_frees.load();
+        stack.reset();
+        const size_t frees = g_frees.load() - frees0;
+        std::printf("%-8s %-9s n=%-8d allocs/edit=%.2f frees/edit=%.2f seconds=%.3f\n", "alloc", mode.data(), edits,
+                    double(allocs) / edits, double(frees) / edits, seconds);
+    }
+}
+
+int main(int argc, char** argv) {
+    int revisions = 100000;
+    int selection = 10000;
+    int jump = 500;
+    int script = 20000;
+    bool skip_restore = false;
+    std::string path = "replay_bench.db";
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string flag = argv[i];
+        if (flag == "--revisions") revisions = std::atoi(argv[i + 1]);
+        else if (flag == "--selection") selection = std::atoi(argv[i + 1]);
+        else if (flag == "--jump") jump = std::atoi(argv[i + 1]);
+        else if (flag == "--db") path = argv[i + 1];
+        else if (flag == "--skip-restore") skip_restore = std::atoi(argv[i + 1]) != 0;
+        else if (flag == "--script") script = std::atoi(argv[i + 1]);
+    }
+    if (script > 0) run_alloc(script);
+    const auto log = synthetic_log(revisions);
+
+    auto t0 = std::chrono::steady_clock::now();
+    size_t built = 0;
+    for (const auto& r : log) built += command_from_diff(r.diff_json) ? 1 : 0;
+    report("parse", built, seconds_since(t0));
+
+    std::vector<std::unique_ptr<ICommand>> commands;
+    commands.reserve(log.size());
+    for (const auto& r : log) commands.push_back(command_from_diff(r.diff_json));
+    size_t json_bytes = 0;
+    t0 = std::chrono::steady_clock::now();
+    for (const auto& c : commands) json_bytes += c->diffJson()->size();
+    report_size("enc_json", commands.size(), json_bytes, seconds_since(t0));
+
+    std::vector<RevisionRecord> blob_log(log.size());
+    DiffWriter writer;
+    size_t blob_bytes = 0;
+    t0 = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < commands.size(); ++i) {
+        writer.reset();
+        commands[i]->encodeDiff(writer);
+        blob_log[i].diff_blob.assign(writer.finish());
+        blob_bytes += blob_log[i].diff_blob.size();
+    }
+    report_size("enc_bin", commands.size(), blob_bytes, seconds_since(t0));
+
+    t0 = std::chrono::steady_clock::now();
+    built = 0;
+    for (const auto& r : blob_log) built += command_from_blob(r.diff_blob) ? 1 : 0;
+    report_size("dec_bin", built, blob_bytes, seconds_since(t0));
+
+    std::vector<std::pair<std::string, int>> keys;
+    keys.reserve(size_t(selection));
+    for (int i = 0; i < selection; ++i) keys.emplace_back(uuid_for(i), i * 40);
+    const MoveSelectionCommand drag(std::move(keys), 25);
+    t0 = std::chrono::steady_clock::now();
+    const size_t drag_json = drag.diffJson()->size();
+    report_size("move_json", 1, drag_json, seconds_since(t0));
+    t0 = std::chrono::steady_clock::now();
+    writer.reset();
+    drag.encodeDiff(writer);
+    const std::string drag_blob(writer.finish());
+    report_size("move_bin", 1, drag_blob.size(), seconds_since(t0));
+
+    if (!skip_restore) {
+        create_project(path);
+        SqliteStorage storage(path);
+        CommandStack stack(storage);
+        t0 = std::chrono::steady_clock::now();
+        restore_from_revisions(stack, storage, log);
+        report("restore", log.size(), seconds_since(t0));
+    }
+
+    create_project(path);
+    SqliteStorage storage(path);
+    CommandStack stack(storage);
+    t0 = std::chrono::steady_clock::now();
+    const ReplayResult r = replay_revisions(stack, storage, log);
+    report("replay", r.revisions, seconds_since(t0));
+    if (r.skipped) std::printf("skipped=%zu\n", r.skipped);
+
+    create_project(path);
+    SqliteStorage bin_storage(path);
+    CommandStack bin_stack(bin_storage);
+    t0 = std::chrono::steady_clock::now();
+    const ReplayResult rb = replay_revisions(bin_stack, bin_storage, blob_log);
+    report("replay_bin", rb.revisions, seconds_since(t0));
+
+    t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < jump && bin_stack.canUndo(); ++i) bin_stack.undo();
+    report("undo1", size_t(jump), seconds_since(t0));
+    bin_stack.redoN(size_t(jump));
+    t0 = std::chrono::steady_clock::now();
+    const size_t undone = bin_stack.undoN(size_t(jump));
+    report("undoN", undone, seconds_since(t0));
+    return 0;
+}
@@ -0,0 +1,323 @@
+// Keyframe insert throughput through SqliteStorage versus the previous per-call
+// prepare/finalize path with SQLITE_TRANSIENT copies.
+// Usage: desktop_storage_bench [--rows N] [--commands N] [--db path]
+//   bulk:     N inserts inside one transaction (replay / bulk edit shape)
+//   commands: per-command BEGIN, insert, revision row, COMMIT (interactive edit shape)
+//   selection: N-key move/delete, per-key statements versus the set-based bulk path
+//   edits:    CommandStack edits/s: data and revision in separate commits (previous behaviour),
+//             one commit per edit, and group commit with a 5 ms window
+//   latency:  per-edit latency percentiles (caller thread) for SqliteStorage and WriteBehindStorage
+//   reads:    ReadPool range-query throughput by reader thread count while a writer keeps committing
+//   wal:      edit burst latency and WAL size with SQLite's commit-time auto-checkpoint versus WalPolicy
+#include "commands/add_keyframe.hpp"
+#include "verity/db.hpp"
+#include "verity/read_pool.hpp"
+#include "verity/wal_policy.hpp"
+#include "verity/write_behind.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <sqlite3.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace verity;
+
+static void exec(sqlite3* db, const char* sql) {
+    char* err = nullptr;
+    if (sqlite3_exec(db, sql, nullptr, nullptr, &err) != SQLITE_OK) {
+        std::cerr << "SQL error: " << (err ? err : "") << "\n";
+        sqlite3_free(err);
+        std::exit(1);
+    }
+}
+
+static void create_project(const std::string& path) {
+    std::filesystem::remove(path);
+    std::filesystem::remove(path + "-wal");
+    std::filesystem::remove(path + "-shm");
+    sqlite3* db = nullptr;
+    if (sqlite3_open(path.c_str(), &db) != SQLITE_OK) std::exit(1);
+    exec(db, "CREATE TABLE projects(id TEXT PRIMARY KEY, name TEXT, version INTEGER, created_at INTEGER, updated_at INTEGER);");
+    exec(db, "INSERT INTO projects VALUES('p1','bench',1,0,0);");
+    exec(db, "CREATE TABLE keyframes(id TEXT PRIMARY KEY, track_id TEXT NOT NULL, t_ms INTEGER NOT NULL, value_json TEXT NOT NULL, interp TEXT NOT NULL, created_at INTEGER, updated_at INTEGER);");
+    exec(db, "CREATE INDEX idx_keyframes_track_time ON keyframes(track_id, t_ms);");
+    exec(db, "CREATE TABLE revisions(id INTEGER PRIMARY KEY AUTOINCREMENT, project_id TEXT, user TEXT, label TEXT, diff_json TEXT, created_at INTEGER);");
+    sqlite3_close(db);
+}
+
+// The pre-cache implementation of insertKeyframe/addRevision, kept as the baseline.
+struct UncachedWriter {
+    sqlite3* db {nullptr};
+    explicit UncachedWriter(const std::string& path) {
+        if (sqlite3_open(path.c_str(), &db) != SQLITE_OK) std::exit(1);
+        exec(db, "PRAGMA journal_mode=WAL;");
+        exec(db, "PRAGMA synchronous=NORMAL;");
+    }
+    ~UncachedWriter() { sqlite3_close(db); }
+    void insertKeyframe(const KeyId& key_id, const std::string& track, int t_ms, const std::string& value,
+                        const std::string& interp) {
+        const std::string id = key_id.str();
+        sqlite3_stmt* st = nullptr;
+        sqlite3_prepare_v2(db,
+                           "INSERT INTO keyframes(id, track_id, t_ms, value_json, interp, created_at, updated_at)"
+                           " VALUES(?,?,?,?,?, CAST(strftime('%s','now') AS INTEGER), CAST(strftime('%s','now') AS INTEGER))",
+                           -1, &st, nullptr);
+        sqlite3_bind_text(st, 1, id.c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_text(st, 2, track.c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_int(st, 3, t_ms);
+        sqlite3_bind_text(st, 4, value.c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_text(st, 5, interp.c_str(), -1, SQLITE_TRANSIENT);
+        if (sqlite3_step(st) != SQLITE_DONE) std::exit(1);
+        sqlite3_finalize(st);
+    }
+    void addRevision(const RevisionRecord& r) {
+        sqlite3_stmt* st = nullptr;
+        sqlite3_prepare_v2(db,
+                           "INSERT INTO revisions(project_id, user, label, diff_json, created_at)"
+                           " VALUES((SELECT id FROM projects LIMIT 1), ?, ?, ?, CAST(strftime('%s','now') AS INTEGER))",
+                           -1, &st, nullptr);
+        sqlite3_bind_text(st, 1, "local", -1, SQLITE_TRANSIENT);
+        sqlite3_bind_text(st, 2, r.label.c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_text(st, 3, r.diff_json.c_str(), -1, SQLITE_TRANSIENT);
+        if (sqlite3_step(st) != SQLITE_DONE) std::exit(1);
+        sqlite3_finalize(st);
+    }
+    void begin() { exec(db, "BEGIN"); }
+    void commit() { exec(db, "COMMIT"); }
+};
+
+template <class Writer>
+static double run_bulk(Writer& w, int rows) {
+    const std::string track = "track-00001";
+    const std::string interp = "auto";
+    std::string id, value;
+    const auto t0 = std::chrono::steady_clock::now();
+    w.begin();
+    for (int k = 0; k < rows; ++k) {
+        id = "k-" + std::to_string(k);
+        value = "{\"x\":" + std::to_string(k) + "}";
+        w.insertKeyframe(KeyId::fromText(id), track, k * 40, value, interp);
+    }
+    w.commit();
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+}
+
+template <class Writer>
+static double run_commands(Writer& w, int commands) {
+    const std::string track = "track-00002";
+    const std::string interp = "auto";
+    std::string id, value;
+    const auto t0 = std::chrono::steady_clock::now();
+    for (int k = 0; k < commands; ++k) {
+        id = "c-" + std::to_string(k);
+        value = "{\"x\":" + std::to_string(k) + "}";
+        w.begin();
+        w.insertKeyframe(KeyId::fromText(id), track, k * 40, value, interp);
+        w.addRevision(RevisionRecord{"Add Keyframe", "{\"op\":\"add\",\"id\":\"" + id + "\"}"});
+        w.commit();
+    }
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+}
+
+static double seconds_since(std::chrono::steady_clock::time_point t0) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+}
+
+// Per-key statements (MoveSelectionCommand shape) versus one staged set-based statement
+static void run_selection(SqliteStorage& storage, int rows) {
+    KeyIdList ids;
+    for (int k = 0; k < rows; ++k) ids.push_back(KeyId::fromText("k-" + std::to_string(k)));
+    auto t0 = std::chrono::steady_clock::now();
+    storage.begin();
+    for (int k = 0; k < rows; ++k) storage.updateKeyframeTime(ids[k], k * 40 + 10);
+    storage.commit();
+    std::printf("%-8s %-9s n=%-8d seconds=%.3f\n", "move", "per-key", rows, seconds_since(t0));
+    t0 = std::chrono::steady_clock::now();
+    storage.begin();
+    storage.shiftKeyframes(ids, 10);
+    storage.commit();
+    std::printf("%-8s %-9s n=%-8d seconds=%.3f\n", "move", "set", rows, seconds_since(t0));
+    t0 = std::chrono::steady_clock::now();
+    storage.begin();
+    KeyframeBatch removed = storage.deleteKeyframes(ids);
+    storage.commit();
+    std::printf("%-8s %-9s n=%-8zu seconds=%.3f\n", "delete", "set", removed.size(), seconds_since(t0));
+    t0 = std::chrono::steady_clock::now();
+    storage.begin();
+    storage.insertKeyframes(removed);
+    storage.commit();
+    std::printf("%-8s %-9s n=%-8zu seconds=%.3f\n", "insert", "set", removed.size(), seconds_since(t0));
+}
+
+static void run_edits(SqliteStorage& storage, int edits) {
+    const std::string track = "track-edits";
+    auto t0 = std::chrono::steady_clock::now();
+    for (int k = 0; k < edits; ++k) {
+        const std::string id = "e0-" + std::to_string(k);
+        storage.begin();
+        storage.insertKeyframe(KeyId::fromText(id), track, k, "{}", "auto");
+        storage.commit();
+        storage.addRevision(RevisionRecord{"AddKeyframe", "{\"op\":\"add_key\",\"id\":\"" + id + "\"}"});
+    }
+    double s = seconds_since(t0);
+    std::printf("%-8s %-9s n=%-8d seconds=%.3f per_s=%.0f\n", "edits", "split", edits, s, edits / s);
+    for (int window_ms : {0, 5}) {
+        CommandStack stack(storage);
+        stack.setGroupCommitWindow(std::chrono::milliseconds(window_ms));
+        t0 = std::chrono::steady_clock::now();
+        for (int k = 0; k < edits; ++k) {
+            const std::string id = "e" + std::to_string(window_ms + 1) + "-" + std::to_string(k);
+            stack.execute(std::make_unique<AddKeyframeCommand>(track, k, "{}", "auto", id));
+        }
+        stack.flush();
+        s = seconds_since(t0);
+        std::printf("%-8s %-9s n=%-8d seconds=%.3f per_s=%.0f\n", "edits", window_ms ? "group5ms" : "single", edits,
+                    s, edits / s);
+    }
+}
+
+template <class Storage>
+static void run_latency(Storage& storage, const char* name, int edits) {
+    CommandStack stack(storage);
+    std::vector<double> us;
+    us.reserve(size_t(edits));
+    const auto start = std::chrono::steady_clock::now();
+    for (int k = 0; k < edits; ++k) {
+        const std::string id = std::string(name) + "-" + std::to_string(k);
+        const auto t0 = std::chrono::steady_clock::now();
+        stack.execute(std::make_unique<AddKeyframeCommand>("track-latency", k, "{\"x\":1}", "auto", id));
+        us.push_back(seconds_since(t0) * 1e6);
+    }
+    const double total = seconds_since(start);
+    std::sort(us.begin(), us.end());
+    auto pct = [&](double p) { return us[std::min(us.size() - 1, size_t(p * double(us.size())))]; };
+    std::printf("%-8s %-9s n=%-8d p50=%.1fus p99=%.1fus max=%.1fus caller_seconds=%.3f\n", "latency", name, edits,
+                pct(0.50), pct(0.99), us.back(), total);
+}
+
+// 1 s per reader count: each reader queries a 2 s window of a random track; one writer commits edits
+static void run_reads(const std::string& path, int rows) {
+    create_project(path);
+    constexpr int kTracks = 100;
+    {
+        SqliteStorage storage(path);
+        KeyframeBatch batch;
+        for (int k = 0; k < rows; ++k) {
+            batch.add("r-" + std::to_string(k), "track-" + std::to_string(k % kTracks), (k / kTracks) * 40, "{\"x\":1}",
+                      "auto");
+        }
+        storage.begin();
+        storage.insertKeyframes(batch);
+        storage.commit();
+    }
+    const unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+    for (unsigned readers : {1u, 2u, 4u, 8u}) {
+        if (readers > 2 * cores) break;
+        ReadPool pool(path, readers);
+        std::atomic<bool> done {false};
+        std::atomic<uint64_t> queries {0}, keys {0};
+        uint64_t edits = 0;
+        std::vector<std::thread> threads;
+        for (unsigned r = 0; r < readers; ++r) {
+            threads.emplace_back([&, r] {
+                uint32_t seed = 0x9e3779b9u * (r + 1);
+                while (!done.load(std::memory_order_relaxed)) {
+                    seed = seed * 1664525u + 1013904223u;
+                    const std::string track = "track-" + std::to_string(seed % kTracks);
+                    const int t0 = int((seed >> 8) % 1000) * 40;
+                    keys += pool.keyframesInRange(track, t0, t0 + 2000, [](const KeyframeRowView&) {});
+                    ++queries;
+                }
+            });
+        }
+        {
+            SqliteStorage writer(path);
+            CommandStack stack(writer);
+            const auto t0 = std::chrono::steady_clock::now();
+            while (seconds_since(t0) < 1.0) {
+                const std::string id = "w" + std::to_string(readers) + "-" + std::to_string(edits);
+                stack.execute(std::make_unique<AddKeyframeCommand>("track-writer", int(edits), "{}", "auto", id));
+                ++edits;
+            }
+        }
+        done = true;
+        for (auto& t : threads) t.join();
+        std::printf("%-8s readers=%-2u queries_per_s=%-8llu keys_per_s=%-9llu writer_edits_per_s=%llu\n", "reads",
+                    readers, (unsigned long long)queries.load(), (unsigned long long)keys.load(),
+                    (unsigned long long)edits);
+    }
+}
+
+// Edit burst, then an idle pause; WAL file size sampled at the end of the burst and after the pause
+static void run_wal(const std::string& path, bool policy_on, int edits) {
+    create_project(path);
+    SqliteStorage storage(path);
+    WalPolicy policy(path);
+    if (policy_on) {
+        policy.configure(storage);
+        policy.start();
+    }
+    run_latency(storage, policy_on ? "walpol" : "autockpt", edits);
+    std::error_code ec;
+    const auto burst_wal = std::filesystem::file_size(path + "-wal", ec);
+    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+    policy.stop();
+    const WalStats st = policy.stats();
+    std::printf("%-8s %-9s burst_wal_kib=%llu passive=%llu truncate=%llu busy=%llu max_ckpt_ms=%.2f total_ckpt_ms=%.2f\n",
+                "wal", policy_on ? "walpol" : "autockpt", (unsigned long long)(burst_wal / 1024),
+                (unsigned long long)st.passive_checkpoints, (unsigned long long)st.truncate_checkpoints,
+                (unsigned long long)st.busy_checkpoints, st.max_checkpoint_ms, st.total_checkpoint_ms);
+}
+
+static void report(const char* mode, const char* path, int n, double seconds) {
+    std::printf("%-8s %-9s n=%-8d seconds=%.3f per_s=%.0f\n", mode, path, n, seconds, seconds > 0 ? n / seconds : 0.0);
+}
+
+int main(int argc, char** argv) {
+    int rows = 200000;
+    int commands = 5000;
+    std::string path = "storage_bench.db";
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string flag = argv[i];
+        if (flag == "--rows") rows = std::atoi(argv[i + 1]);
+        else if (flag == "--commands") commands = std::atoi(argv[i + 1]);
+        else if (flag == "--db") path = argv[i + 1];
+    }
+
+    create_project(path);
+    {
+        UncachedWriter w(path);
+        report("bulk", "uncached", rows, run_bulk(w, rows));
+        report("commands", "uncached", commands, run_commands(w, commands));
+    }
+    create_project(path);
+    {
+        SqliteStorage storage(path);
+        report("bulk", "cached", rows, run_bulk(storage, rows));
+        report("commands", "cached", commands, run_commands(storage, commands));
+        run_selection(storage, rows);
+        run_edits(storage, commands);
+    }
+    {
+        SqliteStorage storage(path);
+        run_latency(storage, "sqlite", commands);
+    }
+    {
+        WriteBehindStorage storage(path);
+        run_latency(storage, "wb", commands);
+        const auto t0 = std::chrono::steady_clock::now();
+        storage.flush();
+        std::printf("%-8s %-9s flush_seconds=%.3f txns=%llu commits=%llu\n", "latency", "wb", seconds_since(t0),
+                    (unsigned long long)storage.transactionsWritten(), (unsigned long long)storage.sqliteCommits());
+    }
+    run_reads(path, rows);
+    run_wal(path, false, commands);
+    run_wal(path, true, commands);
+    return 0;
+}
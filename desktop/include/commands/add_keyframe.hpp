@@ -1,26 +1,40 @@
 #pragma once
 
 #include "verity/command.hpp"
+#include "verity/key_id.hpp"
+#include <memory>
+#include <memory_resource>
 #include <string>
+#include <string_view>
 
 namespace verity {
 
 class AddKeyframeCommand : public ICommand {
 public:
-    AddKeyframeCommand(std::string track_id, int t_ms, std::string value_json, std::string interp);
-    AddKeyframeCommand(std::string track_id, int t_ms, std::string value_json, std::string interp, std::string fixed_id);
+    // Without a key id, doAction assigns a generated one (kept for redo)
+    AddKeyframeCommand(KeyId track_id, int t_ms, std::string_view value_json, std::string_view interp, KeyId key_id = {});
+    // Text ids (UI, replayed JSON rows); converted once here. An empty fixed_id is a generated id.
+    AddKeyframeCommand(std::string_view track_id, int t_ms, std::string_view value_json, std::string_view interp,
+                       std::string_view fixed_id = {});
+    // Same, with value_json and interp copied into `payload` (CommandStack::emplace passes the batch arena)
+    AddKeyframeCommand(std::allocator_arg_t, std::pmr::memory_resource* payload, KeyId track_id, int t_ms,
+                       std::string_view value_json, std::string_view interp, KeyId key_id = {});
+    AddKeyframeCommand(std::allocator_arg_t, std::pmr::memory_resource* payload, std::string_view track_id, int t_ms,
+                       std::string_view value_json, std::string_view interp, std::string_view fixed_id = {});
     std::string label() const override { return "AddKeyframe"; }
     void doAction(IStorage& store) override;
     void undoAction(IStorage& store) override;
     std::optional<std::string> diffJson() const override;
+    bool encodeDiff(DiffWriter& out) const override;
+    size_t memoryBytes() const override;
+    const KeyId& keyId() const { return key_id_; }
 
 private:
-    std::string track_id_;
+    KeyId track_id_;
+    KeyId key_id_;
     int t_ms_;
-    std::string value_json_;
-    std::string interp_;
-    std::string key_id_;
+    std::pmr::string value_json_;
+    std::pmr::string interp_;
 };
 
 } // namespace verity
-
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "verity/command.hpp"
+#include "verity/keyframe_batch.hpp"
+#include <string>
+
+namespace verity {
+
+// Bulk variants of the keyframe commands. Each applies (and undoes) the whole selection with one
+// set-based statement through SqliteStorage instead of one round trip per key.
+
+class BulkInsertKeyframesCommand : public ICommand {
+public:
+    explicit BulkInsertKeyframesCommand(KeyframeBatch rows);
+    std::string label() const override { return "BulkInsertKeyframes"; }
+    void doAction(IStorage& store) override;
+    void undoAction(IStorage& store) override;
+    std::optional<std::string> diffJson() const override;
+    bool encodeDiff(DiffWriter& out) const override;
+    size_t memoryBytes() const override;
+
+private:
+    KeyframeBatch rows_;
+};
+
+class BulkMoveKeyframesCommand : public ICommand {
+public:
+    // Every key is shifted by delta_ms, so undo is the same shift negated (no per-key times kept)
+    BulkMoveKeyframesCommand(KeyIdList ids, int delta_ms);
+    std::string label() const override { return "BulkMoveKeyframes"; }
+    void doAction(IStorage& store) override;
+    void undoAction(IStorage& store) override;
+    std::optional<std::string> diffJson() const override;
+    bool encodeDiff(DiffWriter& out) const override;
+    size_t memoryBytes() const override;
+    // Shifts of the same id set accumulate (drag coalescing)
+    bool mergeWith(const ICommand& next) override;
+
+private:
+    KeyIdList ids_;
+    int delta_ms_;
+};
+
+class BulkDeleteKeyframesCommand : public ICommand {
+public:
+    explicit BulkDeleteKeyframesCommand(KeyIdList ids);
+    // Already applied, with the rows it removed (rehydrated history entries)
+    BulkDeleteKeyframesCommand(KeyIdList ids, KeyframeBatch removed);
+    std::string label() const override { return "BulkDeleteKeyframes"; }
+    void doAction(IStorage& store) override;
+    void undoAction(IStorage& store) override;
+    std::optional<std::string> diffJson() const override;
+    bool encodeDiff(DiffWriter& out) const override;
+    // Also carries the removed rows, which undo re-inserts
+    bool encodeSpill(DiffWriter& out) const override;
+    size_t memoryBytes() const override;
+
+private:
+    KeyIdList ids_;
+    KeyframeBatch removed_; // rows captured by doAction, re-inserted on undo
+};
+
+} // namespace verity
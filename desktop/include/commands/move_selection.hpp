@@ -1,6 +1,7 @@
 #pragma once
 
 #include "verity/command.hpp"
+#include "verity/key_id.hpp"
 #include <string>
 #include <utility>
 #include <vector>
@@ -9,17 +10,22 @@ namespace verity {
 
 class MoveSelectionCommand : public ICommand {
 public:
-    // pairs of key_id and original t_ms
-    MoveSelectionCommand(std::vector<std::pair<std::string, int>> selection, int delta_ms);
+    // pairs of key id and original t_ms
+    MoveSelectionCommand(std::vector<std::pair<KeyId, int>> selection, int delta_ms);
+    // Text ids (UI, replayed JSON rows); converted once here
+    MoveSelectionCommand(const std::vector<std::pair<std::string, int>>& selection, int delta_ms);
     std::string label() const override { return "MoveSelection"; }
     void doAction(IStorage& store) override;
     void undoAction(IStorage& store) override;
     std::optional<std::string> diffJson() const override;
+    bool encodeDiff(DiffWriter& out) const override;
+    size_t memoryBytes() const override;
+    // Merges a follow-up move of the same keys (drag coalescing)
+    bool mergeWith(const ICommand& next) override;
 
 private:
-    std::vector<std::pair<std::string, int>> selection_; // stores original t_ms for undo
+    std::vector<std::pair<KeyId, int>> selection_; // stores original t_ms for undo
     int delta_ms_;
 };
 
 } // namespace verity
-
@@ -1,40 +1,85 @@
 #pragma once
 
+#include "verity/snapshot_store.hpp"
 #include <atomic>
 #include <chrono>
+#include <condition_variable>
+#include <cstdint>
 #include <filesystem>
+#include <functional>
+#include <mutex>
 #include <string>
 #include <thread>
 
 namespace verity {
 
+// Periodic snapshots of <project>/project.db into <project>/snapshots/autosave-<time>-r<rev>.db,
+// keeping the newest `slots` files. Snapshots go through the SQLite online backup API a few pages
+// per step with a pause in between, so editing on other connections never waits on a snapshot and
+// a copy is never torn (a backup step that sees a concurrent write restarts; after a bounded number
+// of restarts the snapshot fails and the next tick retries). A scheduled tick is skipped when no
+// revision was recorded since the previous snapshot.
+// In incremental mode snapshots go into a SnapshotStore under snapshots/ instead: only chunks that
+// changed since an earlier snapshot are written, and each snapshot is a manifest
+// (SnapshotStore::restore reassembles one).
 class AutosaveScheduler {
 public:
-    AutosaveScheduler(std::string project_dir, std::chrono::seconds interval)
-        : project_dir_(std::move(project_dir)), interval_(interval) {}
+    AutosaveScheduler(std::string project_dir, std::chrono::seconds interval, size_t slots = 3)
+        : project_dir_(std::move(project_dir)), interval_(interval), slots_(slots ? slots : 1) {}
     ~AutosaveScheduler() { stop(); }
 
-    void start() {
-        if (running_.exchange(true)) return;
-        worker_ = std::thread([this] { run(); });
-    }
+    void start();
+    // Wakes the worker and joins it; an in-flight backup is abandoned after its current step
+    void stop();
+
+    // Trigger a snapshot immediately (safe to call whether running or not); true when one was written
+    bool snapshotNow();
+    // What each scheduled tick does: snapshot only if the revision log moved since the last one
+    bool snapshotIfChanged();
 
-    void stop() {
-        if (!running_.exchange(false)) return;
-        if (worker_.joinable()) worker_.join();
+    // Runs before each snapshot copy, e.g. to flush a write-behind storage so the file is current.
+    // Set before start().
+    void setBeforeSnapshot(std::function<void()> hook) { before_snapshot_ = std::move(hook); }
+    // Backup pacing: pages copied per step and the pause between steps. Set before start().
+    void setBackupPacing(int pages_per_step, std::chrono::milliseconds pause) {
+        pages_per_step_ = pages_per_step > 0 ? pages_per_step : -1;
+        step_pause_ = pause;
     }
 
-    // Trigger a snapshot immediately (safe to call whether running or not)
-    void snapshotNow();
+    // Incremental, deduplicated snapshots in `chunk_bytes` chunks (0 switches back to full copies).
+    // Set before start().
+    void setIncremental(size_t chunk_bytes) { chunk_bytes_ = chunk_bytes; }
+    // Newest snapshot written (empty before the first): a .db file, or a manifest name when incremental
+    std::string lastSnapshot() const;
+    // Chunk statistics of the newest incremental snapshot
+    SnapshotStats lastIncremental() const;
+    uint64_t snapshotsWritten() const { return written_.load(); }
+    uint64_t snapshotsSkipped() const { return skipped_.load(); }
 
 private:
     void run();
-    void snapshotOnce();
+    bool snapshotOnce(bool only_if_changed, bool from_worker);
+    bool snapshotIncremental(bool only_if_changed, bool from_worker);
+    void rotate(const std::filesystem::path& dir) const;
 
     std::string project_dir_;
     std::chrono::seconds interval_ {60};
+    size_t slots_ {3};
+    int pages_per_step_ {256};
+    std::chrono::milliseconds step_pause_ {2};
+    size_t chunk_bytes_ {0};
     std::atomic<bool> running_ {false};
+    std::mutex wake_mu_;
+    std::condition_variable wake_cv_;
     std::thread worker_;
+    std::function<void()> before_snapshot_;
+
+    mutable std::mutex snapshot_mu_; // one snapshot at a time (worker and snapshotNow)
+    int64_t last_revision_ {-1};
+    std::string last_snapshot_;
+    SnapshotStats last_stats_;
+    std::atomic<uint64_t> written_ {0};
+    std::atomic<uint64_t> skipped_ {0};
 };
 
 } // namespace verity
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "verity/command.hpp"
+#include "verity/db.hpp"
+#include "verity/replay.hpp"
+#include <chrono>
+#include <cstdint>
+
+namespace verity {
+
+// Restores into an empty keyframes table: loads the newest checkpoint (if any) and replays only
+// the revisions recorded after it, all in one transaction. Undo history covers the replayed tail.
+ReplayResult restore_latest(CommandStack& stack, SqliteStorage& storage);
+
+// Takes a checkpoint once `every_revisions` revisions have been recorded since the last one, or
+// once `interval` has passed with at least one new revision; a zero `every_revisions` or `interval`
+// disables that trigger, and with both zero only checkpointNow() checkpoints. With `compact`, each
+// checkpoint also squashes the revision log up to it, so the log and restore time stay bounded by
+// recent activity.
+// Poll from the editing thread's idle loop; grouped edits are flushed before a checkpoint and
+// nothing happens while a batch is open.
+class CheckpointScheduler {
+public:
+    CheckpointScheduler(CommandStack& stack, SqliteStorage& storage, int64_t every_revisions,
+                        std::chrono::seconds interval, bool compact = false);
+
+    // Returns the new checkpoint id, or 0 when none was due
+    int64_t poll();
+    int64_t checkpointNow();
+
+private:
+    CommandStack& stack_;
+    SqliteStorage& storage_;
+    int64_t every_revisions_;
+    std::chrono::seconds interval_;
+    bool compact_;
+    int64_t last_revision_ {0};
+    std::chrono::steady_clock::time_point last_time_;
+};
+
+} // namespace verity
@@ -1,17 +1,30 @@
 #pragma once
 
+#include "verity/diff_codec.hpp"
+#include "verity/history_spill.hpp"
+#include <chrono>
 #include <functional>
 #include <memory>
+#include <memory_resource>
 #include <optional>
 #include <string>
 #include <string_view>
+#include <type_traits>
 #include <vector>
 
 namespace verity {
 
+// Heap (or arena) bytes owned by a string (0 while it fits the small-string buffer); for memoryBytes()
+template <class Alloc>
+inline size_t heap_bytes(const std::basic_string<char, std::char_traits<char>, Alloc>& s) {
+    static const size_t inline_capacity = std::basic_string<char, std::char_traits<char>, Alloc>().capacity();
+    return s.capacity() > inline_capacity ? s.capacity() + 1 : 0;
+}
+
 struct RevisionRecord {
     std::string label;
     std::string diff_json; // serialized effect for persistence
+    std::string diff_blob {}; // binary form (diff_codec.hpp); when set, diff_json is left empty
 };
 
 // Abstract storage transaction API (SQLite-backed implementation optional)
@@ -22,6 +35,12 @@ public:
     virtual void commit() = 0;
     virtual void rollback() = 0;
     virtual void addRevision(const RevisionRecord& r) = 0; // persist revision
+    // True when addRevision persists RevisionRecord::diff_blob; CommandStack then writes binary diffs
+    virtual bool storesDiffBlobs() const { return false; }
+    // Nested scope inside an open transaction (used by group commit); no-ops by default
+    virtual void savepoint() {}
+    virtual void releaseSavepoint() {}
+    virtual void rollbackToSavepoint() {}
 };
 
 class NullStorage : public IStorage {
@@ -41,38 +60,189 @@ public:
     virtual void undoAction(IStorage& store) = 0;
     // Optional serialized diff for persistence
     virtual std::optional<std::string> diffJson() const { return std::nullopt; }
+    // Optional binary diff (decoded by command_from_blob). Return false when the command has no
+    // binary form; its JSON diff is stored instead.
+    virtual bool encodeDiff(DiffWriter& out) const {
+        (void)out;
+        return false;
+    }
+    // Everything undo/redo need, for history entries spilled to disk (decoded by command_from_blob).
+    // The revision diff suffices unless undo relies on state captured by doAction.
+    virtual bool encodeSpill(DiffWriter& out) const { return encodeDiff(out); }
+    // Bytes held by the command and its heap buffers, for the history budget (0: not accounted)
+    virtual size_t memoryBytes() const { return 0; }
+    // Coalescing: `next` has just been applied on top of this command. Return true after folding
+    // its effect into this command (undoAction then reverts both and diffJson describes both);
+    // `next` is then discarded. Default: never merges.
+    virtual bool mergeWith(const ICommand& next) {
+        (void)next;
+        return false;
+    }
+
+    // Commands can be placed in an arena with `new (arena) C(...)` (CommandStack::emplace inside a
+    // batch) and still be owned by unique_ptr<ICommand>: delete hands the block back to the resource
+    // it came from, which for a batch's monotonic arena is a no-op until the batch is released.
+    static void* operator new(size_t size);
+    static void* operator new(size_t size, std::pmr::memory_resource* arena);
+    static void operator delete(void* p);
+    static void operator delete(void* p, std::pmr::memory_resource* arena); // constructor threw
 };
 
-// Batch groups multiple commands as one unit for undo/redo labels
+// Runs child commands in order and undoes them in reverse (closed batches, replayed batch revisions)
+class CompositeCommand : public ICommand {
+public:
+    CompositeCommand(std::string label, std::vector<std::unique_ptr<ICommand>> commands);
+    // Closed batch: the commands may live in `arena`, which is released in one piece after they are
+    // destroyed
+    CompositeCommand(std::string label, std::vector<std::unique_ptr<ICommand>> commands,
+                     std::unique_ptr<std::pmr::memory_resource> arena);
+    std::string label() const override { return label_; }
+    void doAction(IStorage& store) override;
+    void undoAction(IStorage& store) override;
+    // {"op":"batch","label":...,"items":[child diffs]}; nullopt when no child has a diff
+    std::optional<std::string> diffJson() const override;
+    // Binary only when every child has a binary form
+    bool encodeDiff(DiffWriter& out) const override;
+    bool encodeSpill(DiffWriter& out) const override;
+    size_t memoryBytes() const override;
+    size_t size() const { return commands_.size(); }
+
+private:
+    bool encode(DiffWriter& out, bool spill) const;
+
+    std::unique_ptr<std::pmr::memory_resource> arena_; // declared first: outlives commands_
+    std::string label_;
+    std::vector<std::unique_ptr<ICommand>> commands_;
+};
+
+// Batch groups multiple commands as one unit for undo/redo labels. The arena is created by the
+// first emplace() and moves into the batch's CompositeCommand.
 struct CommandBatch {
+    std::unique_ptr<std::pmr::monotonic_buffer_resource> arena; // declared first: outlives commands
     std::string label;
     std::vector<std::unique_ptr<ICommand>> commands;
-    std::vector<std::string> diffs; // serialized diffs for revision coalescing
 };
 
 class CommandStack {
 public:
     explicit CommandStack(IStorage& storage);
+    ~CommandStack();
+    CommandStack(const CommandStack&) = delete;
+    CommandStack& operator=(const CommandStack&) = delete;
+
+    // Group commit: edits (execute/undo/redo) arriving within `window` of the first uncommitted
+    // edit share one transaction, each inside its own savepoint so a failing edit still rolls back
+    // alone. The group commits on the first edit past the window, on pollGroupCommit() once the
+    // window has elapsed (call it from the frame/idle loop), on flush(), and before a batch starts.
+    // A zero window (default) commits every edit immediately.
+    void setGroupCommitWindow(std::chrono::milliseconds window);
+    void pollGroupCommit();
+    void flush();
+
+    // Coalescing: a command executed within `window` of the previous one is offered to the top of
+    // the undo stack via ICommand::mergeWith, so an interactive drag becomes one undo entry and one
+    // revision. Runs share one transaction (as with group commit) and a run's revision is written
+    // once, when it ends: a command that does not merge starts the next run, while undo/redo, a
+    // batch, flush() and pollGroupCommit() once `window` has passed since the last merge also
+    // commit. A zero window (default) disables coalescing.
+    void setCoalesceWindow(std::chrono::milliseconds window);
 
     void beginBatch(std::string label);
     void endBatch();
     bool inBatch() const { return batch_.has_value(); }
 
     void execute(std::unique_ptr<ICommand> cmd);
+    // Constructs and executes a C. Inside a batch the command comes from the batch's monotonic
+    // arena, and so does its payload when C is constructible as C(std::allocator_arg, resource,
+    // args...) (the uses-allocator convention); the whole batch is freed at once when its history
+    // entry goes. Outside a batch: execute(make_unique).
+    template <class C, class... Args>
+    void emplace(Args&&... args) {
+        if (!batch_) {
+            execute(std::make_unique<C>(std::forward<Args>(args)...));
+            return;
+        }
+        std::pmr::memory_resource* arena = batchArena();
+        if constexpr (std::is_constructible_v<C, std::allocator_arg_t, std::pmr::memory_resource*, Args&&...>) {
+            execute(std::unique_ptr<ICommand>(new (arena) C(std::allocator_arg, arena, std::forward<Args>(args)...)));
+        } else {
+            execute(std::unique_ptr<ICommand>(new (arena) C(std::forward<Args>(args)...)));
+        }
+    }
     bool canUndo() const { return !undo_.empty(); }
     bool canRedo() const { return !redo_.empty(); }
     void undo();
     void redo();
+    // Multi-step travel: up to `n` entries are undone/redone inside one transaction (a savepoint
+    // of the open group under group commit), with their keyframe edits folded to the net effect
+    // per key first (NetEffectStore). Returns the number of entries moved. On failure the
+    // transaction is rolled back and the entries stay in the history (except a spilled entry that
+    // failed to decode, which is dropped as with undo()).
+    size_t undoN(size_t n);
+    size_t redoN(size_t n);
+    // Number of applied entries (0: the start of the history); jumpTo moves to such a position
+    size_t historyPosition() const { return undo_.size(); }
+    size_t jumpTo(size_t position);
+
+    // History budget: once resident undo/redo entries hold more than `bytes` (ICommand::memoryBytes),
+    // the oldest undo entries and the furthest redo entries are written to `spill` in their binary
+    // form (ICommand::encodeSpill) and dropped from memory. Undo/redo rebuild them with `decode`
+    // (normally command_from_blob) when they come back into reach. The newest undo entry and
+    // entries without a binary form stay resident. 0 (default) disables eviction; the spill must
+    // outlive the stack's spilled entries.
+    using SpillDecoder = std::function<std::unique_ptr<ICommand>(std::string_view)>;
+    void setHistoryBudget(size_t bytes, HistorySpill* spill, SpillDecoder decode);
+    size_t historyBytes() const { return history_bytes_; } // resident entries
+    size_t spilledEntries() const { return spilled_; }
 
     // Optional: restore undo stack from serialized revisions
     void pushRevision(const RevisionRecord& r);
+    // Appends a command whose effect is already in storage (bulk replay) to the undo history
+    void pushApplied(std::unique_ptr<ICommand> cmd);
 
 private:
+    bool sharedTransaction() const { return group_window_.count() > 0 || coalesce_window_.count() > 0; }
+    std::pmr::memory_resource* batchArena();
+    void beginEdit();
+    void commitEdit();
+    void abortEdit();
+    void writeRevision(const ICommand& cmd);
+    void sealMerge();
+    size_t travel(bool backwards, size_t n);
+
+    // One undo/redo slot; `cmd` is null while the entry lives in the spill file
+    struct HistoryEntry {
+        std::unique_ptr<ICommand> cmd;
+        size_t bytes {0};
+        HistorySpill::Ref spilled {};
+    };
+    void pushHistory(std::vector<HistoryEntry>& history, std::unique_ptr<ICommand> cmd);
+    std::unique_ptr<ICommand> popHistory(std::vector<HistoryEntry>& history, size_t& scan);
+    void clearRedo();
+    void enforceBudget();
+    bool spillFrom(std::vector<HistoryEntry>& history, size_t& scan, size_t end);
+
     IStorage& storage_;
     std::optional<CommandBatch> batch_;
-    std::vector<std::unique_ptr<ICommand>> undo_;
-    std::vector<std::unique_ptr<ICommand>> redo_;
+    std::vector<HistoryEntry> undo_;
+    std::vector<HistoryEntry> redo_;
     bool batch_failed_ {false};
+    std::chrono::milliseconds group_window_ {0};
+    bool group_open_ {false};
+    std::chrono::steady_clock::time_point group_start_ {};
+    std::chrono::milliseconds coalesce_window_ {0};
+    bool merge_open_ {false}; // undo_.back() may still absorb commands; its revision is pending
+    std::chrono::steady_clock::time_point merge_last_ {};
+    DiffWriter diff_writer_; // reused for every binary revision and spilled entry
+    RevisionRecord revision_; // reused for every revision row (keeps its buffers' capacity)
+    size_t history_budget_ {0};
+    HistorySpill* spill_ {nullptr};
+    SpillDecoder decode_;
+    size_t history_bytes_ {0};
+    size_t spilled_ {0};
+    size_t undo_scan_ {0}; // undo_[0, undo_scan_) are spilled or cannot be
+    size_t redo_scan_ {0};
+    std::string spill_scratch_;
 };
 
 } // namespace verity
@@ -1,44 +1,190 @@
 #pragma once
 
 #include "verity/command.hpp"
+#include "verity/keyframe_store.hpp"
+#include "verity/scene_index.hpp"
 #if VERITY_DESKTOP_SQLITE
+#include "verity/keyframe_cursor.hpp"
 #include <sqlite3.h>
 #endif
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <optional>
 #include <string>
+#include <string_view>
 
 namespace verity {
 
-class SqliteStorage : public IStorage {
-public:
+// One keyframe row as seen by streaming readers; views are only valid during the callback.
+struct KeyframeRowView {
+    std::string_view id;
+    std::string_view track_id;
+    int t_ms {0};
+    std::string_view value_json;
+    std::string_view interp;
+};
+
+// One row of revision_checkpoints (schema V0002)
+struct CheckpointInfo {
+    int64_t id {0};
+    int64_t revision_id {0}; // newest revision folded into the checkpoint
+    int64_t key_count {0};
+    int64_t created_at {0};
+};
+
+// Value_json fields packed into columnar track chunks (schema V0004)
+struct TrackPackOptions {
+    std::string channel {"x"};
+    std::string in_tangent {"in"};
+    std::string out_tangent {"out"};
+    size_t chunk_keys {4096}; // keys per chunk; chunks split a track into consecutive time ranges
+};
+
+// One row of track_chunks; views are only valid during the callback
+struct TrackChunkView {
+    std::string_view track_id;
+    int t0_ms {0};
+    int t1_ms {0};
+    size_t key_count {0};
+    std::string_view data; // see track_blob.hpp
+};
+
 #if VERITY_DESKTOP_SQLITE
+class SqliteStorage : public IStorage, public IKeyframeStore {
+public:
     explicit SqliteStorage(const std::string& db_path);
     ~SqliteStorage() override;
     void begin() override;
     void commit() override;
     void rollback() override;
     void addRevision(const RevisionRecord& r) override;
+    // revisions.diff_blob exists (migration V0003); without it rows stay JSON-only and a record
+    // carrying a blob is rejected
+    bool storesDiffBlobs() const override { return diff_blob_column_; }
+    void savepoint() override;
+    void releaseSavepoint() override;
+    void rollbackToSavepoint() override;
     std::vector<RevisionRecord> readRevisions() const;
+    // Revisions with id > after_id, oldest first
+    std::vector<RevisionRecord> readRevisionsAfter(int64_t after_id) const;
+    // Id of the newest revision row (0 when the log is empty)
+    int64_t latestRevisionId() const;
+    // Stream all keyframes ordered by (track_id, t_ms), served by idx_keyframes_track_time
+    void scanKeyframes(const std::function<void(const KeyframeRowView&)>& fn) const;
+    // Chunked reads of [t0_ms, t1_ms] on `tracks` (see KeyframeCursor); `channel` names the
+    // value_json field parsed into values. The cursor must not outlive the storage.
+    KeyframeCursor keyframeCursor(std::vector<std::string> tracks, int t0_ms, int t1_ms,
+                                  std::string channel = "x") const;
     // Command helpers
-    void insertKeyframe(const std::string& key_id,
-                        const std::string& track_id,
+    void insertKeyframe(const KeyId& key_id,
+                        std::string_view track_id,
                         int t_ms,
-                        const std::string& value_json,
-                        const std::string& interp);
-    void deleteKeyframe(const std::string& key_id);
-    void updateKeyframeTime(const std::string& key_id, int t_ms);
+                        std::string_view value_json,
+                        std::string_view interp) override;
+    void deleteKeyframe(const KeyId& key_id) override;
+    void updateKeyframeTime(const KeyId& key_id, int t_ms) override;
+    // Set-based bulk edits: ids/rows are staged into TEMP tables and applied with one statement
+    void insertKeyframes(const KeyframeBatch& rows) override;
+    void shiftKeyframes(const KeyIdList& ids, int delta_ms) override;
+    KeyframeBatch deleteKeyframes(const KeyIdList& ids) override;
+    // Checkpoints (call with no transaction open, e.g. after CommandStack::flush()). The checkpoint
+    // tables are created on first use for projects that predate migration V0002.
+    // createCheckpoint copies the keyframes table as of the newest revision, in one transaction.
+    int64_t createCheckpoint();
+    std::optional<CheckpointInfo> latestCheckpoint() const;
+    // Copies a checkpoint's keyframes into the (empty) keyframes table; joins the open transaction
+    void loadCheckpoint(int64_t checkpoint_id);
+    // Replaces every revision up to the checkpoint's revision_id with one summary row (same id,
+    // op "checkpoint") and drops older checkpoints. Returns the number of revision rows removed.
+    size_t compactRevisions(int64_t checkpoint_id);
+    // Columnar track chunks (schema V0004; created on first use for older projects): a copy of each
+    // track's keys packed as time/value/tangent arrays for whole-show loads. keyframes stays the
+    // source of truth; once anything is packed, triggers drop an edited track's chunks and list it
+    // in track_chunks_stale. packTrackChunks (no transaction open) repacks the stale tracks, or every
+    // track when the packed layout differs, in one transaction; returns the number of tracks packed.
+    size_t packTrackChunks(const TrackPackOptions& options = {});
+    // "channel,in,out" of the packed chunks; empty when nothing is packed
+    std::string trackChunkLayout() const;
+    // All chunks ordered by (track_id, time)
+    void scanTrackChunks(const std::function<void(const TrackChunkView&)>& fn) const;
+    // Tracks edited since they were packed
+    std::vector<std::string> staleTracks() const;
+    // Keyframes of one track in time order
+    void scanTrackKeyframes(std::string_view track_id, const std::function<void(const KeyframeRowView&)>& fn) const;
+    // Engine snapshot validity (schema V0005; created on first use): the token stored here is
+    // cleared by triggers on any keyframe insert, delete or update, including undo/redo, which write
+    // no revision. engineSnapshotToken() is nullopt once cleared (or before the first set).
+    void setEngineSnapshotToken(int64_t token);
+    std::optional<int64_t> engineSnapshotToken() const;
+    // Loads `scene` from the keyframes table and keeps it in sync with every keyframe mutation and
+    // transaction/savepoint made through this connection (nullptr detaches). Not owned.
+    void attachSceneIndex(SceneIndex* scene);
+    SceneIndex* sceneIndex() const { return scene_; }
+    // Connection tuning: memory-mapped I/O in bytes, page cache in KiB, how long a statement waits
+    // on another connection's lock, and SQLite's commit-time auto-checkpoint threshold in WAL pages
+    // (0 turns it off; see WalPolicy)
+    void setMmapSize(int64_t bytes);
+    void setCacheSize(int64_t kib);
+    void setBusyTimeout(std::chrono::milliseconds wait);
+    void setWalAutocheckpoint(int pages);
     // Utilities
     const std::string& dbPath() const { return db_path_; }
 private:
+    // Statements kept prepared for the lifetime of the connection (prepared on first use)
+    enum Stmt : size_t {
+        kStmtBegin,
+        kStmtCommit,
+        kStmtRollback,
+        kStmtSavepoint,
+        kStmtRelease,
+        kStmtRollbackTo,
+        kStmtInsertRevision,
+        kStmtSelectRevisions,
+        kStmtSelectRevisionsAfter,
+        kStmtLatestRevision,
+        kStmtInsertKeyframe,
+        kStmtDeleteKeyframe,
+        kStmtUpdateKeyframeTime,
+        kStmtStageId,
+        kStmtClearStagedIds,
+        kStmtStageRow,
+        kStmtClearStagedRows,
+        kStmtInsertStagedRows,
+        kStmtShiftStaged,
+        kStmtSelectStaged,
+        kStmtDeleteStaged,
+        kStmtCount
+    };
+    sqlite3_stmt* cached(Stmt id) const;
+    void runCached(Stmt id, const char* what);
+    void stageIds(const KeyIdList& ids);
+    void ensureStaging();
+    void ensureCheckpointTables();
+    void ensureTrackChunkTables();
+    void ensureEngineSnapshotTable();
+
     std::string db_path_;
     sqlite3* db_ {nullptr};
+    mutable std::array<sqlite3_stmt*, kStmtCount> stmts_ {};
+    bool staging_ready_ {false};
+    bool checkpoints_ready_ {false};
+    bool track_chunks_ready_ {false};
+    bool engine_snapshot_ready_ {false};
+    bool diff_blob_column_ {false};
+    SceneIndex* scene_ {nullptr};
+};
 #else
+class SqliteStorage : public IStorage {
+public:
     explicit SqliteStorage(const std::string&) {}
     void begin() override {}
     void commit() override {}
     void rollback() override {}
     void addRevision(const RevisionRecord&) override {}
     std::vector<RevisionRecord> readRevisions() const { return {}; }
-#endif
 };
+#endif
 
 } // namespace verity
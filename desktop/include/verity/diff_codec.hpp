@@ -0,0 +1,107 @@
+#pragma once
+
+#include "verity/key_id.hpp"
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace verity {
+
+// Binary revision diff, stored in revisions.diff_blob (schema V0003):
+//   u8 magic, u8 version, varint string count, string table, one command
+// Key ids, track ids, interp modes and batch labels are interned once per blob and referenced by
+// varint index; UUID ids are stored as their 16 raw bytes, other ids and strings as text. Signed
+// integers are zigzag varints, and the times inside one command are delta-coded against the
+// previous item.
+namespace diffcodec {
+constexpr uint8_t kMagic = 0xD1;
+constexpr uint8_t kVersion = 1;
+enum Op : uint8_t {
+    kAddKey = 1,
+    kMove = 2,
+    kBulkAdd = 3,
+    kBulkMove = 4,
+    kBulkDelete = 5,
+    kBatch = 6,
+    kBulkDeleteApplied = 7, // spilled history entries only: ids, then the removed rows
+};
+} // namespace diffcodec
+
+// Encoder for one blob at a time. reset() keeps every buffer's capacity (the string table's index
+// included), so a long-lived writer (CommandStack keeps one) stops allocating once it has seen its
+// largest diff.
+class DiffWriter {
+public:
+    void reset();
+    void op(uint8_t code) { body_.push_back(static_cast<char>(code)); }
+    void u(uint64_t v) { putVarint(body_, v); }
+    void i(int64_t v) { u((static_cast<uint64_t>(v) << 1) ^ static_cast<uint64_t>(v >> 63)); }
+    // Interned string reference; `s` must stay alive until finish(). Canonical UUID text is packed.
+    void ref(std::string_view s);
+    // Interned id reference (no text round trip for UUID ids)
+    void id(const KeyId& k);
+    // Length-prefixed bytes copied into the body (value_json payloads)
+    void bytes(std::string_view s);
+    // Header + string table + body; valid until the next reset()
+    std::string_view finish();
+
+private:
+    struct Entry {
+        KeyId id;              // UUID entries
+        std::string_view text; // everything else
+    };
+    static void putVarint(std::string& out, uint64_t v);
+    static size_t hashOf(const Entry& e);
+    static bool same(const Entry& a, const Entry& b);
+    void entry(const Entry& e);
+    void rebuildIndex(size_t slots);
+    static constexpr size_t kScanRefs = 8;
+
+    std::string body_;
+    std::string out_;
+    std::vector<Entry> strings_;
+    std::vector<uint32_t> index_; // open addressing over strings_ (position + 1, 0 = free) past kScanRefs
+};
+
+// Decoder over one blob. Text entries and byte fields are views into the blob (no copies); UUID
+// entries are read by id() without text, and expanded into the reader only when ref() asks. Reads
+// past the end or bad references clear ok() and return zero values, so callers check ok() once
+// after decoding.
+class DiffReader {
+public:
+    explicit DiffReader(std::string_view blob);
+    bool ok() const { return ok_; }
+    bool atEnd() const { return p_ == end_; }
+    size_t remaining() const { return static_cast<size_t>(end_ - p_); }
+    uint8_t op();
+    uint64_t u();
+    int64_t i() {
+        const uint64_t v = u();
+        return static_cast<int64_t>(v >> 1) ^ -static_cast<int64_t>(v & 1);
+    }
+    std::string_view ref();
+    KeyId id();
+    std::string_view bytes();
+
+private:
+    struct Entry {
+        std::string_view text; // for UUID entries, empty until first ref()
+        KeyId id;
+        bool packed {false};
+        bool has_id {false};
+    };
+    Entry* entry();
+
+    const char* p_;
+    const char* end_;
+    bool ok_ {true};
+    std::vector<Entry> strings_;
+    size_t packed_ {0};
+    std::string uuids_; // reserved for every packed entry on first use, so views stay valid
+};
+
+// Magic and version check only (cheap dispatch between blob and JSON rows)
+bool is_diff_blob(std::string_view blob);
+
+} // namespace verity
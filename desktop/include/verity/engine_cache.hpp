@@ -0,0 +1,20 @@
+#pragma once
+
+#include "verity/db.hpp"
+#include <string>
+
+namespace verity {
+
+// Binary engine snapshot kept in the project package next to project.db (<package>/engine.snap).
+// It is tagged with a token stored in the database that any keyframe insert, delete or update
+// clears (SqliteStorage::setEngineSnapshotToken), so every change since it was written, undo/redo
+// included, makes loadEngineSnapshot() fail and the caller rebuilds curves from keyframes instead.
+std::string engineSnapshotPath(const SqliteStorage& storage);
+
+// Restore engine curves from the package snapshot; false when missing or stale.
+bool loadEngineSnapshot(const SqliteStorage& storage);
+
+// Persist current engine curves under a fresh token. Call when the curves match the keyframes table.
+void saveEngineSnapshot(SqliteStorage& storage);
+
+} // namespace verity
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "verity/db.hpp"
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace verity {
+
+struct EngineLoadOptions {
+    std::string channel {"x"};   // numeric value_json field used as the curve value
+    std::string in_tangent {"in"};   // optional value_json fields for tangents (default 0)
+    std::string out_tangent {"out"};
+    unsigned threads {0};        // worker threads; 0 = hardware concurrency
+    bool constant_speed {false}; // build arc-length LUTs while loading
+    // Read packed track chunks (SqliteStorage::packTrackChunks) when their layout matches the fields
+    // above; tracks edited since packing still load from rows
+    bool use_track_chunks {true};
+};
+
+struct TrackCurve {
+    std::string track_id;
+    int curve_id {-1};
+    size_t key_count {0};
+};
+
+struct EngineLoadResult {
+    std::vector<TrackCurve> curves; // ordered by track_id; tracks with < 2 keys are skipped
+    size_t rows {0};
+    size_t malformed_rows {0};      // value_json that failed to scan or lacked the channel
+    size_t packed_chunks {0};       // track chunks read instead of rows
+    double seconds {0.0};
+};
+
+// Bulk keyframes -> engine loader. Rows are streamed in (track_id, t_ms) order on the calling
+// thread; each completed track is parsed into a Key array on a worker pool while streaming
+// continues. Curves are then created in one pass and filled (setKeys/LUTs) in parallel.
+// Curve kind follows the first key's interp: "bezier", "catmull"/"catmullrom", else Hermite.
+// Packed track chunks replace the row stream for every track they cover (see use_track_chunks).
+EngineLoadResult load_engine_curves(const SqliteStorage& storage, const EngineLoadOptions& options = {});
+
+} // namespace verity
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <string_view>
+
+namespace verity {
+
+// Scratch file for undo/redo entries evicted by CommandStack::setHistoryBudget. Records are
+// appended once and read back at most once; the file is truncated whenever no record is live and
+// removed on destruction. Editing thread only.
+class HistorySpill {
+public:
+    struct Ref {
+        uint64_t offset {0};
+        uint32_t size {0};
+    };
+
+    explicit HistorySpill(std::string path); // truncates an existing file
+    ~HistorySpill();
+    HistorySpill(const HistorySpill&) = delete;
+    HistorySpill& operator=(const HistorySpill&) = delete;
+
+    // Both throw std::runtime_error on I/O failure
+    Ref write(std::string_view record);
+    void read(Ref ref, std::string& out);
+    // The record is no longer needed (rehydrated or its history entry was dropped)
+    void release(Ref ref);
+
+    size_t liveRecords() const { return live_; }
+    uint64_t fileBytes() const { return end_; }
+
+private:
+    std::string path_;
+    std::fstream file_;
+    uint64_t end_ {0};
+    size_t live_ {0};
+};
+
+} // namespace verity
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <charconv>
+#include <string_view>
+
+namespace verity {
+
+// Non-allocating scanner for the flat objects stored in keyframes.value_json, e.g. {"x":1,"y":2.5}.
+// Calls on_field(name, number) for every numeric member; string/bool/null/nested values are
+// skipped. Names are returned raw (escape sequences are not decoded). Returns false on malformed
+// input; fields visited before the error have already been reported.
+template <class F>
+bool scan_numeric_fields(std::string_view json, F&& on_field) {
+    const char* p = json.data();
+    const char* end = p + json.size();
+    auto skip_ws = [&] {
+        while (p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r')) ++p;
+    };
+    auto skip_string = [&]() -> bool { // p at opening quote
+        for (++p; p < end; ++p) {
+            if (*p == '\\') {
+                ++p;
+            } else if (*p == '"') {
+                ++p;
+                return true;
+            }
+        }
+        return false;
+    };
+    auto skip_value = [&]() -> bool { // non-numeric value, possibly nested
+        if (p < end && *p == '"') return skip_string();
+        int depth = 0;
+        while (p < end) {
+            const char c = *p;
+            if (c == '"') {
+                if (!skip_string()) return false;
+                continue;
+            }
+            if (c == '{' || c == '[') ++depth;
+            if (c == '}' || c == ']') {
+                if (depth == 0) return true;
+                --depth;
+            }
+            if (c == ',' && depth == 0) return true;
+            ++p;
+        }
+        return depth == 0;
+    };
+
+    skip_ws();
+    if (p == end || *p != '{') return false;
+    ++p;
+    skip_ws();
+    if (p < end && *p == '}') return true;
+    while (p < end) {
+        skip_ws();
+        if (p == end || *p != '"') return false;
+        const char* name_begin = p + 1;
+        if (!skip_string()) return false;
+        const std::string_view name(name_begin, static_cast<size_t>(p - 1 - name_begin));
+        skip_ws();
+        if (p == end || *p != ':') return false;
+        ++p;
+        skip_ws();
+        if (p == end) return false;
+        if (*p == '-' || (*p >= '0' && *p <= '9')) {
+            double v = 0.0;
+            auto res = std::from_chars(p, end, v);
+            if (res.ec != std::errc()) return false;
+            p = res.ptr;
+            on_field(name, v);
+        } else if (!skip_value()) {
+            return false;
+        }
+        skip_ws();
+        if (p == end) return false;
+        if (*p == '}') return true;
+        if (*p != ',') return false;
+        ++p;
+    }
+    return false;
+}
+
+} // namespace verity
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace verity {
+
+// Text form of a KeyId without allocating: a UUID is formatted into the object, an interned id is
+// a view into the (process-lifetime) intern table. Keep it alive while the view is in use.
+class KeyIdText {
+public:
+    std::string_view view() const { return uuid_ ? std::string_view(buf_, sizeof(buf_)) : interned_; }
+    operator std::string_view() const { return view(); }
+    std::string str() const { return std::string(view()); }
+
+private:
+    friend class KeyId;
+    char buf_[36];
+    bool uuid_ {false};
+    std::string_view interned_;
+};
+
+// 128-bit keyframe/track id. Canonical lowercase UUIDs (8-4-4-4-12 hex, as generate() and
+// Python's uuid4 produce) are held as their 16 bytes; any other text is interned once per process
+// and held as its table index (high half 0, which no generated id has). Ids compare and hash as
+// two integers; text is produced only where it leaves the process (SQL, JSON, the scene index).
+class KeyId {
+public:
+    KeyId() = default; // empty id
+    // Random version-4 UUID; thread-safe (per-thread generator seeded from std::random_device)
+    static KeyId generate();
+    // Packs a canonical UUID, interns anything else; the empty string maps to the empty id
+    static KeyId fromText(std::string_view text);
+    // True (and `out` set) only for a canonical UUID; never interns
+    static bool parseUuid(std::string_view text, KeyId& out);
+    // Big-endian UUID bytes (the diff blob's 16-byte entries)
+    static KeyId fromBytes(const unsigned char* bytes);
+    void toBytes(unsigned char* out) const;
+
+    bool empty() const { return hi_ == 0 && lo_ == 0; }
+    bool isUuid() const { return hi_ != 0; }
+    uint64_t hi() const { return hi_; }
+    uint64_t lo() const { return lo_; }
+
+    KeyIdText text() const;
+    std::string str() const { return text().str(); }
+
+    friend bool operator==(const KeyId& a, const KeyId& b) { return a.hi_ == b.hi_ && a.lo_ == b.lo_; }
+    friend bool operator!=(const KeyId& a, const KeyId& b) { return !(a == b); }
+    friend bool operator<(const KeyId& a, const KeyId& b) { return a.hi_ != b.hi_ ? a.hi_ < b.hi_ : a.lo_ < b.lo_; }
+
+private:
+    KeyId(uint64_t hi, uint64_t lo) : hi_(hi), lo_(lo) {}
+
+    uint64_t hi_ {0};
+    uint64_t lo_ {0};
+};
+
+struct KeyIdHash {
+    size_t operator()(const KeyId& k) const {
+        // Generated ids are random in both halves; interned ones differ in lo only
+        uint64_t h = k.hi() * 0x9e3779b97f4a7c15ull ^ k.lo();
+        h ^= h >> 29;
+        return static_cast<size_t>(h * 0xbf58476d1ce4e5b9ull);
+    }
+};
+
+using KeyIdList = std::vector<KeyId>;
+
+} // namespace verity
+
+namespace std {
+template <>
+struct hash<verity::KeyId> : verity::KeyIdHash {};
+} // namespace std
@@ -0,0 +1,98 @@
+#pragma once
+
+#include "verity/key_id.hpp"
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace verity {
+
+// Strings stored back to back in one buffer (no allocation per entry); used for value_json columns.
+class PackedStrings {
+public:
+    void reserve(size_t count, size_t bytes) {
+        ends_.reserve(count);
+        data_.reserve(bytes);
+    }
+    void push_back(std::string_view s) {
+        data_.append(s.data(), s.size());
+        ends_.push_back(static_cast<uint32_t>(data_.size()));
+    }
+    size_t size() const { return ends_.size(); }
+    bool empty() const { return ends_.empty(); }
+    std::string_view operator[](size_t i) const {
+        const uint32_t b = i ? ends_[i - 1] : 0;
+        return std::string_view(data_.data() + b, ends_[i] - b);
+    }
+    size_t memoryBytes() const { return data_.capacity() + ends_.capacity() * sizeof(uint32_t); }
+
+private:
+    std::string data_;
+    std::vector<uint32_t> ends_;
+};
+
+// Column-wise keyframe rows for bulk insert/delete. Track ids and interp modes are interned, so a
+// pasted formation stores each track name once rather than once per key.
+class KeyframeBatch {
+public:
+    void reserve(size_t rows) {
+        ids_.reserve(rows);
+        t_ms_.reserve(rows);
+        track_.reserve(rows);
+        interp_.reserve(rows);
+    }
+    void add(const KeyId& id, std::string_view track_id, int t_ms, std::string_view value_json,
+             std::string_view interp) {
+        ids_.push_back(id);
+        values_.push_back(value_json);
+        t_ms_.push_back(t_ms);
+        track_.push_back(intern(tracks_, track_index_, track_id));
+        interp_.push_back(intern(interps_, interp_index_, interp));
+    }
+    // Text ids (SQL rows, JSON diffs)
+    void add(std::string_view id, std::string_view track_id, int t_ms, std::string_view value_json,
+             std::string_view interp) {
+        add(KeyId::fromText(id), track_id, t_ms, value_json, interp);
+    }
+    size_t size() const { return t_ms_.size(); }
+    bool empty() const { return t_ms_.empty(); }
+
+    const KeyIdList& ids() const { return ids_; }
+    const KeyId& id(size_t i) const { return ids_[i]; }
+    std::string_view trackId(size_t i) const { return tracks_[track_[i]]; }
+    int tMs(size_t i) const { return t_ms_[i]; }
+    std::string_view valueJson(size_t i) const { return values_[i]; }
+    std::string_view interp(size_t i) const { return interps_[interp_[i]]; }
+
+    size_t memoryBytes() const {
+        size_t bytes = ids_.capacity() * sizeof(KeyId) + values_.memoryBytes();
+        bytes += t_ms_.capacity() * sizeof(int32_t) + (track_.capacity() + interp_.capacity()) * sizeof(uint32_t);
+        for (const auto& s : tracks_) bytes += sizeof(std::string) + s.capacity();
+        for (const auto& s : interps_) bytes += sizeof(std::string) + s.capacity();
+        return bytes;
+    }
+
+private:
+    static uint32_t intern(std::vector<std::string>& names, std::unordered_map<std::string, uint32_t>& index,
+                           std::string_view s) {
+        // Rows usually arrive grouped by track, so check the most recent name first
+        if (!names.empty() && names.back() == s) return static_cast<uint32_t>(names.size() - 1);
+        auto [it, inserted] = index.try_emplace(std::string(s), static_cast<uint32_t>(names.size()));
+        if (inserted) names.emplace_back(s);
+        return it->second;
+    }
+
+    KeyIdList ids_;
+    PackedStrings values_;
+    std::vector<int32_t> t_ms_;
+    std::vector<uint32_t> track_;
+    std::vector<uint32_t> interp_;
+    std::vector<std::string> tracks_;
+    std::vector<std::string> interps_;
+    std::unordered_map<std::string, uint32_t> track_index_;
+    std::unordered_map<std::string, uint32_t> interp_index_;
+};
+
+} // namespace verity
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <sqlite3.h>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace verity {
+
+// Reusable output of KeyframeCursor::next: parallel arrays sized once to the capacity; rows
+// [0, size) are valid after each call.
+struct KeyframeChunk {
+    explicit KeyframeChunk(size_t capacity = 4096) : t_ms(capacity), values(capacity), track(capacity) {}
+    size_t capacity() const { return t_ms.size(); }
+
+    size_t size {0};
+    std::vector<int> t_ms;
+    std::vector<double> values;  // the cursor's value_json channel; NaN when absent or malformed
+    std::vector<uint32_t> track; // index into the cursor's track list
+};
+
+// Streams the keyframes of one or more tracks with t0_ms <= t_ms <= t1_ms: tracks in the given
+// order, keys by time within a track, each track one range scan of idx_keyframes_track_time. Only
+// t_ms and value_json are read, and value_json is scanned in place, so nothing is allocated per
+// row. The cursor owns a statement on the connection it was opened from (which must outlive it)
+// and reads within whatever transaction that connection is in.
+class KeyframeCursor {
+public:
+    KeyframeCursor(sqlite3* db, std::vector<std::string> tracks, int t0_ms, int t1_ms, std::string channel = "x");
+    ~KeyframeCursor();
+    KeyframeCursor(KeyframeCursor&& other) noexcept;
+    KeyframeCursor& operator=(KeyframeCursor&& other) noexcept;
+    KeyframeCursor(const KeyframeCursor&) = delete;
+    KeyframeCursor& operator=(const KeyframeCursor&) = delete;
+
+    // Fills up to `capacity` rows into the caller's arrays; returns the count (0 once exhausted)
+    size_t next(int* t_ms, double* values, uint32_t* track, size_t capacity);
+    size_t next(KeyframeChunk& chunk) {
+        return chunk.size = next(chunk.t_ms.data(), chunk.values.data(), chunk.track.data(), chunk.capacity());
+    }
+
+    bool done() const { return track_ >= tracks_.size(); }
+    const std::vector<std::string>& tracks() const { return tracks_; }
+    size_t rowsRead() const { return rows_; }
+    size_t malformedRows() const { return malformed_; }
+
+private:
+    sqlite3* db_ {nullptr};
+    sqlite3_stmt* stmt_ {nullptr};
+    std::vector<std::string> tracks_;
+    size_t track_ {0};
+    bool bound_ {false};
+    int t0_ms_ {0};
+    int t1_ms_ {0};
+    std::string channel_;
+    size_t rows_ {0};
+    size_t malformed_ {0};
+};
+
+} // namespace verity
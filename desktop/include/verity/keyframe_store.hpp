@@ -0,0 +1,28 @@
+#pragma once
+
+#include "verity/keyframe_batch.hpp"
+#include <string_view>
+
+namespace verity {
+
+// Keyframe mutations used by the built-in commands. Implemented by storages that hold keyframes
+// (SqliteStorage, WriteBehindStorage); commands dynamic_cast their IStorage to this interface.
+class IKeyframeStore {
+public:
+    virtual ~IKeyframeStore() = default;
+    // Ids are binary (key_id.hpp); storages turn them into text only where they write SQL
+    virtual void insertKeyframe(const KeyId& key_id,
+                                std::string_view track_id,
+                                int t_ms,
+                                std::string_view value_json,
+                                std::string_view interp) = 0;
+    virtual void deleteKeyframe(const KeyId& key_id) = 0;
+    virtual void updateKeyframeTime(const KeyId& key_id, int t_ms) = 0;
+    // Set-based bulk edits
+    virtual void insertKeyframes(const KeyframeBatch& rows) = 0;
+    virtual void shiftKeyframes(const KeyIdList& ids, int delta_ms) = 0;
+    // Deletes the given keys and returns the removed rows (for undo)
+    virtual KeyframeBatch deleteKeyframes(const KeyIdList& ids) = 0;
+};
+
+} // namespace verity
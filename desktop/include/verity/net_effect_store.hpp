@@ -0,0 +1,68 @@
+#pragma once
+
+#include "verity/command.hpp"
+#include "verity/keyframe_store.hpp"
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace verity {
+
+// Keyframe store that folds a run of edits into their net effect per key before touching the
+// underlying storage (multi-step undo/redo). Shifts of one key add up and vanish at zero, time
+// updates keep the last value, an insert followed by a delete vanishes, and a delete followed by an
+// insert becomes a replace. apply() writes what is left with one set-based call per kind.
+// deleteKeyframes must return the removed rows: when some of them are not pending here, pending
+// edits are applied first and the call goes straight to the storage. Transaction calls forward.
+class NetEffectStore : public IStorage, public IKeyframeStore {
+public:
+    // `inner` must implement IKeyframeStore
+    explicit NetEffectStore(IStorage& inner);
+
+    void begin() override { inner_.begin(); }
+    void commit() override { inner_.commit(); }
+    void rollback() override { inner_.rollback(); }
+    void addRevision(const RevisionRecord& r) override { inner_.addRevision(r); }
+
+    void insertKeyframe(const KeyId& key_id,
+                        std::string_view track_id,
+                        int t_ms,
+                        std::string_view value_json,
+                        std::string_view interp) override;
+    void deleteKeyframe(const KeyId& key_id) override;
+    void updateKeyframeTime(const KeyId& key_id, int t_ms) override;
+    void insertKeyframes(const KeyframeBatch& rows) override;
+    void shiftKeyframes(const KeyIdList& ids, int delta_ms) override;
+    KeyframeBatch deleteKeyframes(const KeyIdList& ids) override;
+
+    // Writes the pending net effect to the underlying storage
+    void apply();
+    size_t pendingKeys() const { return net_.size(); }
+    // Keyframe edits received / keys written by apply() so far
+    size_t editsSeen() const { return edits_; }
+    size_t keysWritten() const { return written_; }
+
+private:
+    struct Net {
+        enum Kind : uint8_t { Shift, SetTime, Delete, Insert, Replace } kind {Shift};
+        int t {0}; // Shift: delta; otherwise the key's time
+        std::string track_id;
+        std::string value_json;
+        std::string interp;
+    };
+    Net* find(const KeyId& id);
+    Net& add(const KeyId& id, Net::Kind kind, int t);
+    void insertOne(const KeyId& id, std::string_view track_id, int t_ms, std::string_view value_json,
+                   std::string_view interp);
+    void deleteOne(const KeyId& id);
+    void erase(const KeyId& id);
+
+    IStorage& inner_;
+    IKeyframeStore& keys_;
+    std::unordered_map<KeyId, Net, KeyIdHash> net_;
+    KeyIdList order_; // first-touch order, so apply() is deterministic
+    size_t edits_ {0};
+    size_t written_ {0};
+};
+
+} // namespace verity
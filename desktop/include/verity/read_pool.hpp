@@ -0,0 +1,77 @@
+#pragma once
+
+#include "verity/command.hpp"
+#include "verity/db.hpp"
+#include <array>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace verity {
+
+// A read-only connection leased from a ReadPool. Statements stay prepared for the connection's
+// lifetime, and only the thread holding the lease uses them.
+class ReadConnection {
+public:
+    explicit ReadConnection(const std::string& db_path);
+    ~ReadConnection();
+    ReadConnection(const ReadConnection&) = delete;
+    ReadConnection& operator=(const ReadConnection&) = delete;
+
+    // Keyframes of `track_id` with t0_ms <= t_ms <= t1_ms in time order (idx_keyframes_track_time);
+    // views are only valid during the callback. Returns the row count.
+    size_t keyframesInRange(std::string_view track_id, int t0_ms, int t1_ms,
+                            const std::function<void(const KeyframeRowView&)>& fn);
+    // Up to `limit` revisions with id > after_id, oldest first. Returns the id of the last row
+    // (after_id when there is none), i.e. where the next page starts.
+    int64_t revisionsPage(int64_t after_id, size_t limit,
+                          const std::function<void(int64_t id, const RevisionRecord&)>& fn);
+    int64_t latestRevisionId();
+    // Chunked reads (see KeyframeCursor); use and drop the cursor within the read() callback
+    KeyframeCursor keyframeCursor(std::vector<std::string> tracks, int t0_ms, int t1_ms, std::string channel = "x") {
+        return KeyframeCursor(db_, std::move(tracks), t0_ms, t1_ms, std::move(channel));
+    }
+
+private:
+    friend class ReadPool;
+    enum Stmt : size_t { kStmtBegin, kStmtCommit, kStmtKeyRange, kStmtRevisionPage, kStmtLatestRevision, kStmtCount };
+    sqlite3_stmt* cached(Stmt id);
+
+    sqlite3* db_ {nullptr};
+    std::array<sqlite3_stmt*, kStmtCount> stmts_ {};
+    bool diff_blob_column_ {false};
+};
+
+// Pool of read-only connections for queries that run alongside the editing connection (timeline
+// and graph panels, exports, validators). In WAL mode readers never wait on the writer and the
+// writer never waits on them; each read() works on one committed snapshot.
+class ReadPool {
+public:
+    // connections == 0 opens one per core
+    explicit ReadPool(const std::string& db_path, size_t connections = 0);
+
+    // Runs `fn` on an idle connection inside one read transaction, so every query it makes sees the
+    // same committed snapshot. Blocks while all connections are leased. Safe from any thread.
+    void read(const std::function<void(ReadConnection&)>& fn);
+
+    // Single-query shortcuts
+    size_t keyframesInRange(std::string_view track_id, int t0_ms, int t1_ms,
+                            const std::function<void(const KeyframeRowView&)>& fn);
+    int64_t revisionsPage(int64_t after_id, size_t limit,
+                          const std::function<void(int64_t id, const RevisionRecord&)>& fn);
+
+    size_t size() const { return connections_.size(); }
+
+private:
+    std::vector<std::unique_ptr<ReadConnection>> connections_;
+    std::vector<ReadConnection*> idle_; // LIFO, so a busy thread keeps getting a warm connection
+    std::mutex mu_;
+    std::condition_variable cv_;
+};
+
+} // namespace verity
@@ -1,13 +1,48 @@
 #pragma once
 
 #include "verity/command.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
 #include <vector>
 
 namespace verity {
 
+struct ReplayResult {
+    size_t revisions {0}; // records read
+    size_t commands {0};  // top-level commands rebuilt (a batch counts once)
+    size_t skipped {0};   // unknown op or malformed diff
+    int64_t checkpoint_id {0}; // checkpoint loaded before the replay (restore_latest; 0: none)
+};
+
+// Rebuilds the built-in command described by one revision diff (batches become a
+// CompositeCommand). Returns nullptr for unknown ops and malformed JSON.
+std::unique_ptr<ICommand> command_from_diff(std::string_view diff_json);
+// Same for a binary diff (diff_codec.hpp), including spilled history entries
+// (CommandStack::setHistoryBudget); nullptr for unknown versions and truncated blobs
+std::unique_ptr<ICommand> command_from_blob(std::string_view diff_blob);
+// Uses diff_blob when the row has one, otherwise diff_json
+std::unique_ptr<ICommand> command_from_revision(const RevisionRecord& r);
+// JSON form of a revision for debugging and export: diff_json as stored, or the decoded blob
+// re-serialized. nullopt for an undecodable blob.
+std::optional<std::string> revision_diff_json(const RevisionRecord& r);
+
 // Rehydrate undo stack from stored revisions (best-effort for built-in commands)
-// Appends reconstructed commands to the CommandStack's undo history.
+// Appends reconstructed commands to the CommandStack's undo history. Every entry goes through
+// CommandStack::execute, so each one is a transaction of its own and writes a new revision row.
 void restore_from_revisions(CommandStack& stack, IStorage& store, const std::vector<RevisionRecord>& records);
 
-} // namespace verity
+// Bulk restore: applies every revision inside one storage transaction without writing revision
+// rows, then appends the rebuilt commands to the undo history. On failure the transaction is
+// rolled back, the stack is left unchanged and the error is rethrown.
+ReplayResult replay_revisions(CommandStack& stack, IStorage& store, const std::vector<RevisionRecord>& records);
 
+// Building block of the above: applies revisions inside the caller's open transaction and appends
+// the applied commands to `out` (hand them to CommandStack::pushApplied once committed).
+ReplayResult apply_revisions(IStorage& store, const std::vector<RevisionRecord>& records,
+                             std::vector<std::unique_ptr<ICommand>>& out);
+
+} // namespace verity
@@ -0,0 +1,121 @@
+#pragma once
+
+#include "verity/engine.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace verity {
+
+// In-memory scene model: per-track keyframe arrays sorted by time plus an id -> slot hash table.
+// Storages that own one (SqliteStorage::attachSceneIndex, WriteBehindStorage) update it with every
+// keyframe mutation and drive its transaction journal from begin/commit/rollback/savepoints, so
+// timeline, graph and engine consumers can read it without touching SQL or reloading.
+class SceneIndex {
+public:
+    struct KeyRef {
+        std::string_view id;
+        std::string_view track_id;
+        int t_ms {0};
+        std::string_view value_json;
+        std::string_view interp;
+    };
+
+    // Mutations; false when the id already exists (insert) or is unknown (erase/setTime)
+    bool insert(std::string_view id, std::string_view track_id, int t_ms, std::string_view value_json,
+                std::string_view interp);
+    bool erase(std::string_view id);
+    bool setTime(std::string_view id, int t_ms);
+    void clear();
+
+    // Journal: mutations between begin and commit are undone by rollback; savepoints nest inside
+    void begin();
+    void commit();
+    void rollback();
+    void savepoint();
+    void releaseSavepoint();
+    void rollbackToSavepoint();
+
+    size_t keyCount() const { return live_; }
+    size_t trackCount() const { return tracks_.size(); }
+    bool contains(std::string_view id) const { return findSlot(id) != kNone; }
+    std::optional<KeyRef> find(std::string_view id) const;
+    std::vector<std::string_view> trackIds() const;
+
+    // Sorted key times of a track (empty when unknown); parallel to the keys visited below
+    const std::vector<int32_t>& trackTimes(std::string_view track_id) const;
+
+    // Visits the track's keys with t0 <= t_ms < t1 in time order
+    template <class F>
+    void forEachInRange(std::string_view track_id, int t0, int t1, F&& fn) const {
+        const Track* tr = findTrack(track_id);
+        if (!tr) return;
+        size_t i = lowerBound(*tr, t0);
+        for (; i < tr->times.size() && tr->times[i] < t1; ++i) fn(ref(tr->slots[i]));
+    }
+
+    // Engine keys for a track from numeric value_json fields, parsed like load_engine_curves (tangents
+    // default to 0). Returns the number of keys whose channel field was missing or malformed.
+    size_t buildEngineKeys(std::string_view track_id, std::vector<Key>& out, std::string_view channel = "x",
+                           std::string_view in_tangent = "in", std::string_view out_tangent = "out") const;
+
+private:
+    static constexpr uint32_t kNone = 0xffffffffu;
+    static constexpr uint32_t kTombstone = 0xfffffffeu;
+
+    struct Slot {
+        std::string id;
+        std::string value_json;
+        uint32_t track {0};
+        int32_t t_ms {0};
+        uint16_t interp {0};
+        bool live {false};
+    };
+    struct Track {
+        std::string id;
+        std::vector<int32_t> times; // sorted; ties keep insertion order
+        std::vector<uint32_t> slots;
+    };
+    struct JournalEntry {
+        enum Op : uint8_t { Inserted, Erased, Retimed } op;
+        std::string id;
+        std::string track_id;   // Erased
+        std::string value_json; // Erased
+        std::string interp;     // Erased
+        int t_ms {0};           // Erased / Retimed (previous time)
+    };
+
+    uint32_t findSlot(std::string_view id) const;
+    const Track* findTrack(std::string_view track_id) const;
+    uint32_t trackFor(std::string_view track_id);
+    uint16_t internInterp(std::string_view interp);
+    static size_t lowerBound(const Track& tr, int t);
+    size_t position(const Track& tr, uint32_t slot) const;
+    void placeInTrack(uint32_t slot);
+    void removeFromTrack(uint32_t slot);
+    void tableInsert(uint32_t slot);
+    void tableErase(std::string_view id);
+    void rehash(size_t capacity);
+    KeyRef ref(uint32_t slot) const;
+    void undoTo(size_t mark);
+
+    std::vector<Slot> slots_;
+    std::vector<uint32_t> free_;
+    std::vector<uint32_t> table_; // open addressing (linear probing) over slot indices
+    size_t table_used_ {0};       // live entries + tombstones
+    size_t live_ {0};
+    std::vector<Track> tracks_;
+    std::unordered_map<std::string, uint32_t> track_index_;
+    std::vector<std::string> interps_;
+
+    bool in_txn_ {false};
+    bool replaying_ {false};
+    std::vector<JournalEntry> journal_;
+    std::vector<size_t> savepoints_;
+};
+
+} // namespace verity
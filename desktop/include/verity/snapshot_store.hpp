@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace verity {
+
+// Outcome of SnapshotStore::put
+struct SnapshotStats {
+    size_t chunks {0};
+    size_t new_chunks {0};   // chunks not yet in the store (the only ones written)
+    uint64_t bytes {0};      // size of the snapshotted file
+    uint64_t new_bytes {0};
+    double seconds {0.0};
+};
+
+// Content-addressed, deduplicated snapshot store (normally <project>/snapshots):
+//   chunks/<2 hex>/<sha256 hex>  fixed-size chunk bodies, written once and shared by snapshots
+//   manifests/<name>.manifest     header lines, then "<sha256 hex> <length>" per chunk in order
+// A snapshot of a file that changed in a few pages writes only the chunks holding those pages plus
+// a manifest. Chunks and manifests are written to a temporary name and renamed, so a crash never
+// leaves a partial object under its final name. Not thread-safe; one writer per directory.
+class SnapshotStore {
+public:
+    // chunk_bytes should be a multiple of the database page size; threads == 0 picks one per core
+    explicit SnapshotStore(std::string dir, size_t chunk_bytes = 256 * 1024, unsigned threads = 0);
+
+    // Fills `out` with up to `size` bytes at `offset` and returns the count (0 past the end)
+    using Reader = std::function<size_t(char* out, size_t size, uint64_t offset)>;
+
+    // Reads the source sequentially, hashes chunks in parallel, stores the new ones and writes the
+    // manifest `name` (replacing one of the same name). `revision` is recorded in the manifest.
+    // Throws std::runtime_error on I/O failure.
+    SnapshotStats put(const std::string& name, const Reader& read, int64_t revision = -1);
+    SnapshotStats put(const std::string& name, const std::string& file, int64_t revision = -1);
+    // Reassembles snapshot `name` into `out_file` chunk by chunk (via out_file.partial + rename),
+    // verifying every chunk's hash. Throws std::runtime_error when a chunk is missing or corrupt.
+    void restore(const std::string& name, const std::string& out_file) const;
+
+    // Manifest names, sorted (autosave names sort oldest first)
+    std::vector<std::string> list() const;
+    int64_t revisionOf(const std::string& name) const; // -1 when unknown
+    // Removes a manifest; chunks are reclaimed by collectGarbage()
+    void remove(const std::string& name);
+    // Deletes chunks no manifest references; returns the number deleted
+    size_t collectGarbage();
+
+    const std::string& dir() const { return dir_; }
+
+private:
+    std::string dir_;
+    size_t chunk_bytes_;
+    unsigned threads_;
+};
+
+// SHA-256 of `size` bytes as 64 lowercase hex digits (chunk addresses)
+std::string sha256_hex(const void* data, size_t size);
+
+} // namespace verity
@@ -0,0 +1,34 @@
+#pragma once
+
+#include "verity/engine.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace verity {
+
+// Columnar keyframe chunk, stored in track_chunks.data (schema V0004):
+//   u8 magic, u8 version, varint key count, varint malformed count, varint interp length + bytes,
+//   zigzag varint t_ms deltas, then the value, in-tangent and out-tangent columns as f32 (LE)
+// `interp` is the chunk's first key's mode; `malformed` counts keys whose value_json failed to scan
+// or lacked the channel when the chunk was packed (they hold 0, as in the row loader).
+namespace trackblob {
+constexpr uint8_t kMagic = 0xC1;
+constexpr uint8_t kVersion = 1;
+} // namespace trackblob
+
+struct TrackChunkHeader {
+    size_t keys {0};
+    size_t malformed {0};
+    std::string_view interp; // view into the blob
+};
+
+// Appends one chunk for keys[0, n) (times taken from t_ms) to `out`
+void encode_track_chunk(const int* t_ms, const Key* keys, size_t n, size_t malformed, std::string_view interp,
+                        std::string& out);
+// Appends the chunk's keys to `keys`; false (with `keys` unchanged) on a malformed blob
+bool decode_track_chunk(std::string_view blob, std::vector<Key>& keys, TrackChunkHeader* header = nullptr);
+
+} // namespace verity
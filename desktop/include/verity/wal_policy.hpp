@@ -0,0 +1,79 @@
+#pragma once
+
+#include "verity/db.hpp"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace verity {
+
+struct WalPolicyOptions {
+    std::chrono::milliseconds poll {100};
+    // PASSIVE checkpoint once no connection has committed for this long
+    std::chrono::milliseconds idle_after {250};
+    // TRUNCATE checkpoint once the -wal file grows past this, even mid-burst
+    uint64_t wal_budget_bytes {64ull << 20};
+    // How long a TRUNCATE waits on the writer and readers before giving up until the next poll
+    std::chrono::milliseconds truncate_wait {100};
+    // Busy timeout configure() gives the editing connection, which a TRUNCATE briefly locks out
+    std::chrono::milliseconds writer_wait {2000};
+    // Applied to the editing connection by configure(); negative leaves SQLite's default
+    int64_t mmap_bytes {256ll << 20};
+    int64_t cache_kib {64 * 1024};
+};
+
+struct WalStats {
+    uint64_t wal_bytes {0}; // -wal file size at the last poll
+    int64_t wal_pages {-1}; // frames in the WAL as of the last checkpoint (-1 before the first)
+    uint64_t passive_checkpoints {0};
+    uint64_t truncate_checkpoints {0};
+    uint64_t busy_checkpoints {0}; // checkpoints that could not finish (readers or a writer in the way)
+    double last_checkpoint_ms {0.0};
+    double max_checkpoint_ms {0.0};
+    double total_checkpoint_ms {0.0};
+};
+
+// Checkpoint policy for a project database in WAL mode. A background thread polls the database on
+// its own connection: a PASSIVE checkpoint runs once commits have stopped for `idle_after`, and a
+// TRUNCATE runs whenever the WAL file exceeds the budget, so heavy edit bursts cannot balloon the
+// WAL and slow every read. Commits are noticed through PRAGMA data_version, so any storage writing
+// the file (SqliteStorage, WriteBehindStorage, other processes) is covered.
+class WalPolicy {
+public:
+    explicit WalPolicy(std::string db_path, WalPolicyOptions options = {});
+    ~WalPolicy();
+
+    // Applies mmap_size/cache_size and the busy timeout to `storage` and turns off its commit-time
+    // auto-checkpoint, so committing never pays for a checkpoint while the policy runs
+    void configure(SqliteStorage& storage) const;
+
+    void start();
+    void stop();
+    // One policy step (what the worker runs each poll); true when a checkpoint ran
+    bool poll();
+
+    WalStats stats() const;
+
+private:
+    void run();
+
+    std::string db_path_;
+    WalPolicyOptions options_;
+    sqlite3* db_ {nullptr};
+    int64_t data_version_ {-1};
+    bool dirty_ {true}; // commits not yet fully checkpointed
+    std::chrono::steady_clock::time_point last_change_;
+    WalStats stats_;
+
+    std::atomic<bool> running_ {false};
+    std::mutex wake_mu_;
+    std::condition_variable wake_cv_;
+    std::thread worker_;
+    mutable std::mutex mu_; // poll() and stats()
+};
+
+} // namespace verity
@@ -0,0 +1,117 @@
+#pragma once
+
+#include "verity/command.hpp"
+#include "verity/db.hpp"
+#include "verity/keyframe_store.hpp"
+#include "verity/scene_index.hpp"
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace verity {
+
+// Write-behind storage: commands mutate an in-memory SceneIndex on the calling (UI) thread and
+// return immediately; the SQL for each committed transaction is queued to a dedicated writer thread
+// through a lock-free MPSC queue and applied in FIFO order, several transactions per SQLite commit.
+//
+// - Ordering: transactions reach the database in commit() order, each atomically.
+// - flush(): blocks until everything committed before the call is durable in the database (use it
+//   before copying the project file, e.g. as the autosave pre-snapshot hook). Safe from any thread.
+// - Errors: a failed write poisons the storage (the model and database have diverged); the error is
+//   rethrown from the next begin()/flush()/autocommit edit so CommandStack surfaces it to the caller.
+// - Threading: begin/commit/rollback and the keyframe mutations belong to one editing thread.
+class WriteBehindStorage : public IStorage, public IKeyframeStore {
+public:
+    // Opens the database, loads the keyframe model and starts the writer thread.
+    explicit WriteBehindStorage(const std::string& db_path);
+    ~WriteBehindStorage() override; // drains the queue, then joins the writer
+
+    void begin() override;
+    void commit() override;
+    void rollback() override;
+    void addRevision(const RevisionRecord& r) override;
+    bool storesDiffBlobs() const override { return diff_blobs_; }
+    void savepoint() override;
+    void releaseSavepoint() override;
+    void rollbackToSavepoint() override;
+
+    void insertKeyframe(const KeyId& key_id,
+                        std::string_view track_id,
+                        int t_ms,
+                        std::string_view value_json,
+                        std::string_view interp) override;
+    void deleteKeyframe(const KeyId& key_id) override;
+    void updateKeyframeTime(const KeyId& key_id, int t_ms) override;
+    void insertKeyframes(const KeyframeBatch& rows) override;
+    void shiftKeyframes(const KeyIdList& ids, int delta_ms) override;
+    KeyframeBatch deleteKeyframes(const KeyIdList& ids) override;
+
+    void flush();
+
+    // In-memory model (editing thread)
+    const SceneIndex& scene() const { return scene_; }
+    size_t keyframeCount() const { return scene_.keyCount(); }
+
+    // Writer statistics
+    uint64_t transactionsWritten() const { return txns_written_.load(std::memory_order_relaxed); }
+    uint64_t sqliteCommits() const { return commits_.load(std::memory_order_relaxed); }
+
+private:
+    using WriteOp = std::function<void(SqliteStorage&)>;
+
+    // Queue node: one committed transaction, or a flush barrier when `barrier` is set
+    struct Node {
+        std::atomic<Node*> next {nullptr};
+        std::vector<WriteOp> ops;
+        std::function<void(std::exception_ptr)> barrier;
+    };
+
+    // Vyukov intrusive MPSC queue: push is one atomic exchange; pop is single-consumer
+    class MpscQueue {
+    public:
+        MpscQueue() : head_(&stub_), tail_(&stub_) {}
+        void push(Node* n);
+        Node* pop();         // nullptr when empty or when a producer is mid-push
+        bool idle() const;   // consumer side: nothing pushed and nothing in flight
+    private:
+        Node stub_;
+        std::atomic<Node*> head_;
+        Node* tail_;
+    };
+
+    void throwIfFailed() const;
+    void emit(WriteOp op);
+    void enqueue(Node* n);
+    void writerLoop();
+    void applyBatch(std::vector<Node*>& nodes);
+
+    std::unique_ptr<SqliteStorage> db_; // owned by the writer thread after construction
+    SceneIndex scene_; // journals its own changes for rollback
+    bool diff_blobs_ {false}; // db_->storesDiffBlobs(), read before the writer starts
+
+    // Editing-thread transaction state
+    bool in_txn_ {false};
+    std::vector<WriteOp> pending_;
+    std::vector<size_t> savepoints_; // pending_ size at each savepoint
+
+    MpscQueue queue_;
+    std::mutex park_mu_;
+    std::condition_variable park_cv_;
+    std::atomic<bool> parked_ {false};
+    std::atomic<bool> stop_ {false};
+    std::atomic<bool> failed_ {false};
+    mutable std::mutex error_mu_;
+    std::exception_ptr error_;
+    std::atomic<uint64_t> txns_written_ {0};
+    std::atomic<uint64_t> commits_ {0};
+    std::thread writer_;
+};
+
+} // namespace verity
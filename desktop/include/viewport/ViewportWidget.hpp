@@ -48,6 +48,7 @@ private:
     void drawGrid(QPainter& p);
     void drawHud(QPainter& p);
     void updateFps();
+    void updateEngineStats();
     void buildBaseCurves();
     void scheduleBuildNext();
     void updateGpuPath();
@@ -60,6 +61,10 @@ private:
     std::deque<double> frameTimesMs_;
     double fps_ {0.0};
     double tAnim_ {0.0}; // seconds
+    // Engine counters for the HUD (evaluations are reported per frame)
+    verity::EngineStats engineStats_;
+    uint64_t lastEngineEvals_ {0};
+    uint64_t evalsLastFrame_ {0};
     float firstOffsetX_ {0.0f};
     bool showGlInfo_ {false};
     // 2D mode state
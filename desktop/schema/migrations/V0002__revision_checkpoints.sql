@@ -0,0 +1,25 @@
+-- Migration V0002: revision checkpoints
+-- A checkpoint materializes the keyframes table as of revision `revision_id`; restore loads the
+-- newest one and replays only later revisions. Compaction squashes revisions up to a checkpoint.
+BEGIN;
+CREATE TABLE IF NOT EXISTS revision_checkpoints (
+  id INTEGER PRIMARY KEY AUTOINCREMENT,
+  revision_id INTEGER NOT NULL,
+  key_count INTEGER NOT NULL,
+  created_at INTEGER NOT NULL
+);
+
+CREATE TABLE IF NOT EXISTS checkpoint_keyframes (
+  checkpoint_id INTEGER NOT NULL,
+  id TEXT NOT NULL,
+  track_id TEXT NOT NULL,
+  t_ms INTEGER NOT NULL,
+  value_json TEXT NOT NULL,
+  interp TEXT NOT NULL,
+  PRIMARY KEY (checkpoint_id, id),
+  FOREIGN KEY (checkpoint_id) REFERENCES revision_checkpoints(id) ON DELETE CASCADE
+) WITHOUT ROWID;
+
+INSERT OR IGNORE INTO schema_migrations(version, applied_at)
+VALUES (2, CAST(strftime('%s','now') AS INTEGER));
+COMMIT;
@@ -0,0 +1,9 @@
+-- Migration V0003: binary revision diffs
+-- New revisions store their diff in diff_blob (desktop/include/verity/diff_codec.hpp) and leave
+-- diff_json NULL; older rows keep their JSON. Commands without a binary form still write JSON.
+BEGIN;
+ALTER TABLE revisions ADD COLUMN diff_blob BLOB;
+
+INSERT OR IGNORE INTO schema_migrations(version, applied_at)
+VALUES (3, CAST(strftime('%s','now') AS INTEGER));
+COMMIT;
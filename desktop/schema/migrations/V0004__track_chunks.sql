@@ -0,0 +1,43 @@
+-- Migration V0004: columnar track chunks
+-- A read-optimised copy of the keyframes table for whole-show loads: each track's keys packed into
+-- blobs of times, values and tangents (desktop/include/verity/track_blob.hpp), split by time range.
+-- keyframes stays authoritative: once anything is packed, the triggers drop an edited track's
+-- chunks and list it in track_chunks_stale until SqliteStorage::packTrackChunks repacks it.
+BEGIN;
+CREATE TABLE IF NOT EXISTS track_chunks (
+  track_id TEXT NOT NULL,
+  seq INTEGER NOT NULL,
+  t0_ms INTEGER NOT NULL,
+  t1_ms INTEGER NOT NULL,
+  key_count INTEGER NOT NULL,
+  layout TEXT NOT NULL, -- value_json fields packed: "channel,in,out"
+  data BLOB NOT NULL,
+  PRIMARY KEY (track_id, seq)
+);
+
+CREATE TABLE IF NOT EXISTS track_chunks_stale (
+  track_id TEXT PRIMARY KEY
+) WITHOUT ROWID;
+
+CREATE TRIGGER IF NOT EXISTS trg_keyframes_chunks_insert AFTER INSERT ON keyframes
+WHEN EXISTS (SELECT 1 FROM track_chunks) BEGIN
+  INSERT OR IGNORE INTO track_chunks_stale(track_id) VALUES (NEW.track_id);
+  DELETE FROM track_chunks WHERE track_id = NEW.track_id;
+END;
+
+CREATE TRIGGER IF NOT EXISTS trg_keyframes_chunks_delete AFTER DELETE ON keyframes
+WHEN EXISTS (SELECT 1 FROM track_chunks) BEGIN
+  INSERT OR IGNORE INTO track_chunks_stale(track_id) VALUES (OLD.track_id);
+  DELETE FROM track_chunks WHERE track_id = OLD.track_id;
+END;
+
+CREATE TRIGGER IF NOT EXISTS trg_keyframes_chunks_update AFTER UPDATE OF track_id, t_ms, value_json, interp ON keyframes
+WHEN EXISTS (SELECT 1 FROM track_chunks) BEGIN
+  INSERT OR IGNORE INTO track_chunks_stale(track_id) VALUES (OLD.track_id);
+  INSERT OR IGNORE INTO track_chunks_stale(track_id) VALUES (NEW.track_id);
+  DELETE FROM track_chunks WHERE track_id IN (OLD.track_id, NEW.track_id);
+END;
+
+INSERT OR IGNORE INTO schema_migrations(version, applied_at)
+VALUES (4, CAST(strftime('%s','now') AS INTEGER));
+COMMIT;
@@ -0,0 +1,28 @@
+-- Migration V0005: engine snapshot validity token
+-- saveEngineSnapshot (desktop/include/verity/engine_cache.hpp) stores the token it tagged
+-- <package>/engine.snap with; any keyframe insert, delete or update clears it, so undo/redo and
+-- jumps (which write no revision) invalidate the snapshot too. Once the row is gone the triggers
+-- cost one check of an empty table per row.
+BEGIN;
+CREATE TABLE IF NOT EXISTS engine_snapshot_token (
+  token INTEGER NOT NULL
+);
+
+CREATE TRIGGER IF NOT EXISTS trg_keyframes_snapshot_insert AFTER INSERT ON keyframes
+WHEN EXISTS (SELECT 1 FROM engine_snapshot_token) BEGIN
+  DELETE FROM engine_snapshot_token;
+END;
+
+CREATE TRIGGER IF NOT EXISTS trg_keyframes_snapshot_delete AFTER DELETE ON keyframes
+WHEN EXISTS (SELECT 1 FROM engine_snapshot_token) BEGIN
+  DELETE FROM engine_snapshot_token;
+END;
+
+CREATE TRIGGER IF NOT EXISTS trg_keyframes_snapshot_update AFTER UPDATE OF track_id, t_ms, value_json, interp ON keyframes
+WHEN EXISTS (SELECT 1 FROM engine_snapshot_token) BEGIN
+  DELETE FROM engine_snapshot_token;
+END;
+
+INSERT OR IGNORE INTO schema_migrations(version, applied_at)
+VALUES (5, CAST(strftime('%s','now') AS INTEGER));
+COMMIT;
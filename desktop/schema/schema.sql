@@ -79,6 +79,7 @@ CREATE TABLE IF NOT EXISTS revisions (
   label TEXT,
   diff_json TEXT,
   created_at INTEGER NOT NULL,
+  diff_blob BLOB, -- V0003: binary diff (added by ALTER TABLE, hence last)
   FOREIGN KEY (project_id) REFERENCES projects(id) ON DELETE CASCADE
 );
 
@@ -103,3 +104,77 @@ CREATE TABLE IF NOT EXISTS events (
   FOREIGN KEY (project_id) REFERENCES projects(id) ON DELETE CASCADE
 );
 
+
+-- Revision checkpoints: keyframes materialized as of revisions.id = revision_id
+CREATE TABLE IF NOT EXISTS revision_checkpoints (
+  id INTEGER PRIMARY KEY AUTOINCREMENT,
+  revision_id INTEGER NOT NULL,
+  key_count INTEGER NOT NULL,
+  created_at INTEGER NOT NULL
+);
+
+CREATE TABLE IF NOT EXISTS checkpoint_keyframes (
+  checkpoint_id INTEGER NOT NULL,
+  id TEXT NOT NULL,
+  track_id TEXT NOT NULL,
+  t_ms INTEGER NOT NULL,
+  value_json TEXT NOT NULL,
+  interp TEXT NOT NULL,
+  PRIMARY KEY (checkpoint_id, id),
+  FOREIGN KEY (checkpoint_id) REFERENCES revision_checkpoints(id) ON DELETE CASCADE
+) WITHOUT ROWID;
+
+-- Columnar track chunks: read-optimised copy of keyframes, kept honest by the triggers below
+CREATE TABLE IF NOT EXISTS track_chunks (
+  track_id TEXT NOT NULL,
+  seq INTEGER NOT NULL,
+  t0_ms INTEGER NOT NULL,
+  t1_ms INTEGER NOT NULL,
+  key_count INTEGER NOT NULL,
+  layout TEXT NOT NULL, -- value_json fields packed: "channel,in,out"
+  data BLOB NOT NULL,
+  PRIMARY KEY (track_id, seq)
+);
+
+CREATE TABLE IF NOT EXISTS track_chunks_stale (
+  track_id TEXT PRIMARY KEY
+) WITHOUT ROWID;
+
+CREATE TRIGGER IF NOT EXISTS trg_keyframes_chunks_insert AFTER INSERT ON keyframes
+WHEN EXISTS (SELECT 1 FROM track_chunks) BEGIN
+  INSERT OR IGNORE INTO track_chunks_stale(track_id) VALUES (NEW.track_id);
+  DELETE FROM track_chunks WHERE track_id = NEW.track_id;
+END;
+
+CREATE TRIGGER IF NOT EXISTS trg_keyframes_chunks_delete AFTER DELETE ON keyframes
+WHEN EXISTS (SELECT 1 FROM track_chunks) BEGIN
+  INSERT OR IGNORE INTO track_chunks_stale(track_id) VALUES (OLD.track_id);
+  DELETE FROM track_chunks WHERE track_id = OLD.track_id;
+END;
+
+CREATE TRIGGER IF NOT EXISTS trg_keyframes_chunks_update AFTER UPDATE OF track_id, t_ms, value_json, interp ON keyframes
+WHEN EXISTS (SELECT 1 FROM track_chunks) BEGIN
+  INSERT OR IGNORE INTO track_chunks_stale(track_id) VALUES (OLD.track_id);
+  INSERT OR IGNORE INTO track_chunks_stale(track_id) VALUES (NEW.track_id);
+  DELETE FROM track_chunks WHERE track_id IN (OLD.track_id, NEW.track_id);
+END;
+
+-- Engine snapshot validity: the token engine.snap was tagged with, cleared by any keyframe edit
+CREATE TABLE IF NOT EXISTS engine_snapshot_token (
+  token INTEGER NOT NULL
+);
+
+CREATE TRIGGER IF NOT EXISTS trg_keyframes_snapshot_insert AFTER INSERT ON keyframes
+WHEN EXISTS (SELECT 1 FROM engine_snapshot_token) BEGIN
+  DELETE FROM engine_snapshot_token;
+END;
+
+CREATE TRIGGER IF NOT EXISTS trg_keyframes_snapshot_delete AFTER DELETE ON keyframes
+WHEN EXISTS (SELECT 1 FROM engine_snapshot_token) BEGIN
+  DELETE FROM engine_snapshot_token;
+END;
+
+CREATE TRIGGER IF NOT EXISTS trg_keyframes_snapshot_update AFTER UPDATE OF track_id, t_ms, value_json, interp ON keyframes
+WHEN EXISTS (SELECT 1 FROM engine_snapshot_token) BEGIN
+  DELETE FROM engine_snapshot_token;
+END;
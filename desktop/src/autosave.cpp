@@ -1,7 +1,10 @@
 #include "verity/autosave.hpp"
-#include <fstream>
+#include <algorithm>
+#include <ctime>
 #include <iomanip>
 #include <sstream>
+#include <stdexcept>
+#include <vector>
 #if VERITY_DESKTOP_SQLITE
 #include <sqlite3.h>
 #endif
@@ -10,38 +13,290 @@ namespace fs = std::filesystem;
 
 namespace verity {
 
-void AutosaveScheduler::snapshotOnce() {
+namespace {
+
+constexpr const char* kPrefix = "autosave-";
+constexpr const char* kSuffix = ".db";
+// Backup steps that restart (a concurrent write) or find the source busy before a full copy gives
+// up; the next tick tries again instead of holding snapshot_mu_ under continuous edits
+constexpr int kMaxBackupRetries = 16;
+
+// Snapshot files in `dir`, oldest first (names start with a UTC timestamp)
+std::vector<fs::path> list_snapshots(const fs::path& dir) {
+    std::vector<fs::path> out;
+    std::error_code ec;
+    for (const auto& entry : fs::directory_iterator(dir, ec)) {
+        const std::string name = entry.path().filename().string();
+        if (name.rfind(kPrefix, 0) == 0 && name.size() > 3 && name.compare(name.size() - 3, 3, kSuffix) == 0) {
+            out.push_back(entry.path());
+        }
+    }
+    std::sort(out.begin(), out.end());
+    return out;
+}
+
+// The r<rev> part of a snapshot name; -1 when absent
+int64_t snapshot_revision(const fs::path& file) {
+    const std::string stem = file.stem().string();
+    const size_t pos = stem.rfind("-r");
+    if (pos == std::string::npos) return -1;
+    try {
+        return std::stoll(stem.substr(pos + 2));
+    } catch (...) {
+        return -1;
+    }
+}
+
+std::string snapshot_name(int64_t revision, const char* suffix = kSuffix) {
+    const auto now = std::chrono::system_clock::now();
+    const std::time_t secs = std::chrono::system_clock::to_time_t(now);
+    const auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(now.time_since_epoch()).count() % 1000;
+    std::ostringstream ss;
+    ss << kPrefix << std::put_time(std::gmtime(&secs), "%Y%m%d-%H%M%S") << "-" << std::setw(3) << std::setfill('0')
+       << ms << "-r" << revision << suffix;
+    return ss.str();
+}
+
+#if VERITY_DESKTOP_SQLITE
+int64_t read_revision(sqlite3* db) {
+    int64_t revision = -1;
+    sqlite3_stmt* st = nullptr;
+    if (sqlite3_prepare_v2(db, "SELECT COALESCE(MAX(id), 0) FROM revisions", -1, &st, nullptr) == SQLITE_OK &&
+        sqlite3_step(st) == SQLITE_ROW) {
+        revision = sqlite3_column_int64(st, 0);
+    }
+    sqlite3_finalize(st);
+    return revision;
+}
+#endif
+
+} // namespace
+
+void AutosaveScheduler::start() {
+    if (running_.exchange(true)) return;
+    worker_ = std::thread([this] { run(); });
+}
+
+void AutosaveScheduler::stop() {
+    {
+        std::lock_guard<std::mutex> lock(wake_mu_);
+        if (!running_.exchange(false)) return;
+    }
+    wake_cv_.notify_all();
+    if (worker_.joinable()) worker_.join();
+}
+
+std::string AutosaveScheduler::lastSnapshot() const {
+    std::lock_guard<std::mutex> lock(snapshot_mu_);
+    return last_snapshot_;
+}
+
+SnapshotStats AutosaveScheduler::lastIncremental() const {
+    std::lock_guard<std::mutex> lock(snapshot_mu_);
+    return last_stats_;
+}
+
+void AutosaveScheduler::rotate(const fs::path& dir) const {
+    const auto files = list_snapshots(dir);
+    std::error_code ec;
+    for (size_t i = 0; i + slots_ < files.size(); ++i) fs::remove(files[i], ec);
+}
+
+bool AutosaveScheduler::snapshotOnce(bool only_if_changed, bool from_worker) {
+    std::lock_guard<std::mutex> lock(snapshot_mu_);
+    if (before_snapshot_) before_snapshot_();
+    if (chunk_bytes_) return snapshotIncremental(only_if_changed, from_worker);
     fs::path root(project_dir_);
     fs::path db = root / "project.db";
     fs::path snaps = root / "snapshots";
     std::error_code ec;
     fs::create_directories(snaps, ec);
+    if (last_revision_ < 0) {
+        // First snapshot of this session: compare against the newest one on disk
+        const auto files = list_snapshots(snaps);
+        if (!files.empty()) last_revision_ = snapshot_revision(files.back());
+    }
 
 #if VERITY_DESKTOP_SQLITE
-    // Ensure WAL data is checkpointed before copying the file, best-effort.
-    sqlite3* sdb = nullptr;
-    if (sqlite3_open(db.string().c_str(), &sdb) == SQLITE_OK) {
-        sqlite3_exec(sdb, "PRAGMA wal_checkpoint(FULL);", nullptr, nullptr, nullptr);
+    sqlite3* src = nullptr;
+    if (sqlite3_open_v2(db.string().c_str(), &src, SQLITE_OPEN_READONLY, nullptr) != SQLITE_OK) {
+        sqlite3_close(src);
+        return false;
+    }
+    const int64_t revision = read_revision(src);
+    if (only_if_changed && revision >= 0 && revision == last_revision_) {
+        sqlite3_close(src);
+        skipped_.fetch_add(1);
+        return false;
+    }
+
+    const fs::path target = snaps / snapshot_name(revision);
+    const fs::path partial = fs::path(target.string() + ".partial");
+    fs::remove(partial, ec);
+    sqlite3* dst = nullptr;
+    bool ok = sqlite3_open(partial.string().c_str(), &dst) == SQLITE_OK;
+    if (ok) {
+        // Copies the last committed state (WAL included) without a checkpoint; writers on other
+        // connections proceed during the pauses, and a step that sees their changes restarts
+        sqlite3_backup* backup = sqlite3_backup_init(dst, "main", src, "main");
+        int rc = backup ? SQLITE_OK : SQLITE_ERROR;
+        int retries = 0;
+        int remaining = -1;
+        while (backup) {
+            rc = sqlite3_backup_step(backup, pages_per_step_);
+            if (rc != SQLITE_OK && rc != SQLITE_BUSY && rc != SQLITE_LOCKED) break;
+            if (from_worker && !running_.load()) break; // stop() requested
+            const int left = sqlite3_backup_remaining(backup);
+            if (rc != SQLITE_OK || (remaining >= 0 && left > remaining)) {
+                if (++retries > kMaxBackupRetries) break;
+            }
+            remaining = left;
+            std::this_thread::sleep_for(step_pause_);
+        }
+        if (backup) sqlite3_backup_finish(backup);
+        ok = rc == SQLITE_DONE;
+    }
+    sqlite3_close(dst);
+    sqlite3_close(src);
+#else
+    // Without SQLite the file modification time stands in for the revision
+    const auto stamp = fs::last_write_time(db, ec).time_since_epoch().count();
+    const int64_t revision = ec ? -1 : static_cast<int64_t>(stamp & 0x7fffffffffffffffLL);
+    if (only_if_changed && revision >= 0 && revision == last_revision_) {
+        skipped_.fetch_add(1);
+        return false;
     }
-    if (sdb) sqlite3_close(sdb);
+    const fs::path target = snaps / snapshot_name(revision);
+    const fs::path partial = fs::path(target.string() + ".partial");
+    const bool ok = fs::copy_file(db, partial, fs::copy_options::overwrite_existing, ec);
 #endif
 
-    std::stringstream ss;
-    ss << "slot1.db"; // single slot for simplicity; could rotate by timestamp
-    fs::copy_file(db, snaps / ss.str(), fs::copy_options::overwrite_existing, ec);
+    if (!ok) {
+        fs::remove(partial, ec);
+        return false;
+    }
+    fs::rename(partial, target, ec);
+    if (ec) return false;
+    rotate(snaps);
+    last_revision_ = revision;
+    last_snapshot_ = target.string();
+    written_.fetch_add(1);
+    return true;
+}
+
+bool AutosaveScheduler::snapshotIncremental(bool only_if_changed, bool from_worker) {
+    const fs::path root(project_dir_);
+    const std::string db = (root / "project.db").string();
+    SnapshotStore store((root / "snapshots").string(), chunk_bytes_);
+    std::vector<std::string> names = store.list();
+    if (last_revision_ < 0 && !names.empty()) last_revision_ = store.revisionOf(names.back());
+
+    int64_t revision = -1;
+    std::string name;
+    SnapshotStats stats;
+    bool ok = false;
+#if VERITY_DESKTOP_SQLITE
+    // The database file is a consistent image once every WAL frame the reader sees has been
+    // checkpointed into it; while the read transaction stays open no checkpoint can write past it,
+    // so the file holds still without blocking writers. Pages are read through SQLite's own file
+    // handle: closing another descriptor on the file would drop this process's POSIX locks.
+    sqlite3* reader = nullptr;
+    sqlite3* checkpointer = nullptr;
+    const bool opened = sqlite3_open_v2(db.c_str(), &reader, SQLITE_OPEN_READONLY, nullptr) == SQLITE_OK &&
+                        sqlite3_open_v2(db.c_str(), &checkpointer, SQLITE_OPEN_READWRITE, nullptr) == SQLITE_OK;
+    sqlite3_file* file = nullptr;
+    if (opened) sqlite3_file_control(reader, "main", SQLITE_FCNTL_FILE_POINTER, &file);
+    bool failed = !opened || !file;
+    for (int attempt = 0; !failed && !ok && attempt < 8; ++attempt) {
+        if (attempt > 0) {
+            if (from_worker && !running_.load()) break; // stop() requested
+            std::this_thread::sleep_for(step_pause_ * (attempt + 1));
+        }
+        sqlite3_exec(reader, "BEGIN", nullptr, nullptr, nullptr);
+        revision = read_revision(reader); // starts the read transaction
+        if (only_if_changed && revision >= 0 && revision == last_revision_) {
+            sqlite3_exec(reader, "COMMIT", nullptr, nullptr, nullptr);
+            sqlite3_close(checkpointer);
+            sqlite3_close(reader);
+            skipped_.fetch_add(1);
+            return false;
+        }
+        int log = -1, backfilled = -1;
+        sqlite3_stmt* st = nullptr;
+        if (sqlite3_prepare_v2(checkpointer, "PRAGMA wal_checkpoint(PASSIVE)", -1, &st, nullptr) == SQLITE_OK &&
+            sqlite3_step(st) == SQLITE_ROW) {
+            log = sqlite3_column_int(st, 1);
+            backfilled = sqlite3_column_int(st, 2);
+        }
+        sqlite3_finalize(st);
+        if (log == backfilled) { // -1/-1 outside WAL mode, where the shared lock already holds writers off
+            sqlite3_int64 size = 0;
+            file->pMethods->xFileSize(file, &size);
+            const SnapshotStore::Reader read = [&](char* out, size_t n, uint64_t offset) -> size_t {
+                if (offset >= static_cast<uint64_t>(size)) return 0;
+                n = static_cast<size_t>(std::min<uint64_t>(n, static_cast<uint64_t>(size) - offset));
+                if (file->pMethods->xRead(file, out, static_cast<int>(n), static_cast<sqlite3_int64>(offset)) !=
+                    SQLITE_OK) {
+                    throw std::runtime_error("snapshot read failed: " + db);
+                }
+                return n;
+            };
+            name = snapshot_name(revision, "");
+            try {
+                stats = store.put(name, read, revision);
+                ok = true;
+            } catch (const std::exception&) {
+                failed = true;
+            }
+        }
+        sqlite3_exec(reader, "COMMIT", nullptr, nullptr, nullptr);
+    }
+    sqlite3_close(checkpointer);
+    sqlite3_close(reader);
+#else
+    (void)from_worker;
+    std::error_code ec;
+    const auto stamp = fs::last_write_time(db, ec).time_since_epoch().count();
+    revision = ec ? -1 : static_cast<int64_t>(stamp & 0x7fffffffffffffffLL);
+    if (only_if_changed && revision >= 0 && revision == last_revision_) {
+        skipped_.fetch_add(1);
+        return false;
+    }
+    name = snapshot_name(revision, "");
+    try {
+        stats = store.put(name, db, revision);
+        ok = true;
+    } catch (const std::exception&) {
+    }
+#endif
+    if (!ok) return false;
+
+    names = store.list();
+    for (size_t i = 0; i + slots_ < names.size(); ++i) store.remove(names[i]);
+    if (names.size() > slots_) store.collectGarbage();
+    last_revision_ = revision;
+    last_snapshot_ = name;
+    last_stats_ = stats;
+    written_.fetch_add(1);
+    return true;
 }
 
 void AutosaveScheduler::run() {
+    std::unique_lock<std::mutex> lock(wake_mu_);
     while (running_.load()) {
-        snapshotOnce();
-        for (int i = 0; i < interval_.count() && running_.load(); ++i) {
-            std::this_thread::sleep_for(std::chrono::seconds(1));
-        }
+        lock.unlock();
+        snapshotOnce(true, true);
+        lock.lock();
+        wake_cv_.wait_for(lock, interval_, [this] { return !running_.load(); });
     }
 }
 
-void AutosaveScheduler::snapshotNow() {
-    snapshotOnce();
+bool AutosaveScheduler::snapshotNow() {
+    return snapshotOnce(false, false);
+}
+
+bool AutosaveScheduler::snapshotIfChanged() {
+    return snapshotOnce(true, false);
 }
 
 } // namespace verity
@@ -0,0 +1,56 @@
+#include "verity/checkpoint.hpp"
+#include <memory>
+#include <vector>
+
+namespace verity {
+
+ReplayResult restore_latest(CommandStack& stack, SqliteStorage& storage) {
+    stack.flush();
+    const auto checkpoint = storage.latestCheckpoint();
+    const auto tail = storage.readRevisionsAfter(checkpoint ? checkpoint->revision_id : 0);
+    std::vector<std::unique_ptr<ICommand>> applied;
+    ReplayResult result;
+    storage.begin();
+    try {
+        if (checkpoint) storage.loadCheckpoint(checkpoint->id);
+        result = apply_revisions(storage, tail, applied);
+        storage.commit();
+    } catch (...) {
+        storage.rollback();
+        throw;
+    }
+    result.checkpoint_id = checkpoint ? checkpoint->id : 0;
+    for (auto& cmd : applied) stack.pushApplied(std::move(cmd));
+    return result;
+}
+
+CheckpointScheduler::CheckpointScheduler(CommandStack& stack, SqliteStorage& storage, int64_t every_revisions,
+                                         std::chrono::seconds interval, bool compact)
+    : stack_(stack),
+      storage_(storage),
+      every_revisions_(every_revisions),
+      interval_(interval),
+      compact_(compact),
+      last_time_(std::chrono::steady_clock::now()) {
+    if (auto cp = storage_.latestCheckpoint()) last_revision_ = cp->revision_id;
+}
+
+int64_t CheckpointScheduler::poll() {
+    if (stack_.inBatch()) return 0;
+    const int64_t fresh = storage_.latestRevisionId() - last_revision_;
+    if (fresh <= 0) return 0;
+    const bool due = (every_revisions_ > 0 && fresh >= every_revisions_) ||
+                     (interval_.count() > 0 && std::chrono::steady_clock::now() - last_time_ >= interval_);
+    return due ? checkpointNow() : 0;
+}
+
+int64_t CheckpointScheduler::checkpointNow() {
+    stack_.flush();
+    const int64_t id = storage_.createCheckpoint();
+    if (compact_) storage_.compactRevisions(id);
+    last_revision_ = storage_.latestRevisionId();
+    last_time_ = std::chrono::steady_clock::now();
+    return id;
+}
+
+} // namespace verity
@@ -1,15 +1,288 @@
 #include "verity/command.hpp"
+#include "verity/net_effect_store.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <new>
 #include <stdexcept>
 
 namespace verity {
 
+namespace {
+
+// Placed before every command: the resource it came from (null: the global heap) and the block size
+struct CommandBlock {
+    std::pmr::memory_resource* arena;
+    size_t bytes;
+};
+constexpr size_t kBlockAlign = alignof(std::max_align_t);
+constexpr size_t kBlockHeader = (sizeof(CommandBlock) + kBlockAlign - 1) & ~(kBlockAlign - 1);
+
+void* place_block(void* base, std::pmr::memory_resource* arena, size_t bytes) {
+    ::new (base) CommandBlock {arena, bytes};
+    return static_cast<char*>(base) + kBlockHeader;
+}
+
+} // namespace
+
+void* ICommand::operator new(size_t size) {
+    const size_t bytes = size + kBlockHeader;
+    return place_block(::operator new(bytes), nullptr, bytes);
+}
+
+void* ICommand::operator new(size_t size, std::pmr::memory_resource* arena) {
+    const size_t bytes = size + kBlockHeader;
+    return place_block(arena->allocate(bytes, kBlockAlign), arena, bytes);
+}
+
+void ICommand::operator delete(void* p) {
+    if (!p) return;
+    void* base = static_cast<char*>(p) - kBlockHeader;
+    const CommandBlock block = *static_cast<CommandBlock*>(base);
+    if (block.arena) block.arena->deallocate(base, block.bytes, kBlockAlign);
+    else ::operator delete(base);
+}
+
+void ICommand::operator delete(void* p, std::pmr::memory_resource*) { operator delete(p); }
+
+CompositeCommand::CompositeCommand(std::string label, std::vector<std::unique_ptr<ICommand>> commands)
+    : label_(std::move(label)), commands_(std::move(commands)) {}
+
+CompositeCommand::CompositeCommand(std::string label, std::vector<std::unique_ptr<ICommand>> commands,
+                                   std::unique_ptr<std::pmr::memory_resource> arena)
+    : arena_(std::move(arena)), label_(std::move(label)), commands_(std::move(commands)) {}
+
+void CompositeCommand::doAction(IStorage& store) {
+    for (auto& c : commands_) c->doAction(store);
+}
+
+void CompositeCommand::undoAction(IStorage& store) {
+    for (auto it = commands_.rbegin(); it != commands_.rend(); ++it) (*it)->undoAction(store);
+}
+
+std::optional<std::string> CompositeCommand::diffJson() const {
+    std::string items;
+    for (const auto& c : commands_) {
+        auto diff = c->diffJson();
+        if (!diff) continue;
+        if (!items.empty()) items += ",";
+        items += *diff;
+    }
+    if (items.empty()) return std::nullopt;
+    std::string s = "{\"op\":\"batch\",\"label\":\"";
+    for (char c : label_) {
+        if (c == '"' || c == '\\') s += '\\';
+        s += c;
+    }
+    s += "\",\"items\":[" + items + "]}";
+    return s;
+}
+
+bool CompositeCommand::encodeDiff(DiffWriter& out) const { return encode(out, false); }
+
+bool CompositeCommand::encodeSpill(DiffWriter& out) const { return encode(out, true); }
+
+bool CompositeCommand::encode(DiffWriter& out, bool spill) const {
+    out.op(diffcodec::kBatch);
+    out.ref(label_);
+    out.u(commands_.size());
+    for (const auto& c : commands_) {
+        if (!(spill ? c->encodeSpill(out) : c->encodeDiff(out))) return false;
+    }
+    return true;
+}
+
+size_t CompositeCommand::memoryBytes() const {
+    size_t bytes = sizeof(*this) + heap_bytes(label_) + commands_.capacity() * sizeof(commands_[0]);
+    for (const auto& c : commands_) bytes += c->memoryBytes();
+    return bytes;
+}
+
 CommandStack::CommandStack(IStorage& storage) : storage_(storage) {}
 
+CommandStack::~CommandStack() {
+    try {
+        flush();
+    } catch (...) {
+        // Destructors must not throw; an unflushed group is rolled back by SQLite on close
+    }
+}
+
+void CommandStack::setGroupCommitWindow(std::chrono::milliseconds window) {
+    if (window.count() <= 0) flush();
+    group_window_ = window;
+}
+
+void CommandStack::setCoalesceWindow(std::chrono::milliseconds window) {
+    if (window.count() <= 0) flush();
+    coalesce_window_ = window;
+}
+
+void CommandStack::setHistoryBudget(size_t bytes, HistorySpill* spill, SpillDecoder decode) {
+    history_budget_ = bytes;
+    spill_ = spill;
+    decode_ = std::move(decode);
+    enforceBudget();
+}
+
+void CommandStack::pushHistory(std::vector<HistoryEntry>& history, std::unique_ptr<ICommand> cmd) {
+    const size_t bytes = cmd->memoryBytes();
+    history_bytes_ += bytes;
+    history.push_back(HistoryEntry{std::move(cmd), bytes, {}});
+}
+
+// Takes the newest entry, reading it back from the spill file when it was evicted
+std::unique_ptr<ICommand> CommandStack::popHistory(std::vector<HistoryEntry>& history, size_t& scan) {
+    HistoryEntry e = std::move(history.back());
+    history.pop_back();
+    if (scan > history.size()) scan = history.size();
+    if (e.cmd) {
+        history_bytes_ -= e.bytes;
+        return std::move(e.cmd);
+    }
+    spill_->read(e.spilled, spill_scratch_);
+    spill_->release(e.spilled);
+    --spilled_;
+    auto cmd = decode_ ? decode_(spill_scratch_) : nullptr;
+    if (!cmd) throw std::runtime_error("spilled history entry could not be decoded");
+    return cmd;
+}
+
+void CommandStack::clearRedo() {
+    for (auto& e : redo_) {
+        if (e.cmd) {
+            history_bytes_ -= e.bytes;
+        } else {
+            spill_->release(e.spilled);
+            --spilled_;
+        }
+    }
+    redo_.clear();
+    redo_scan_ = 0;
+}
+
+void CommandStack::enforceBudget() {
+    if (history_budget_ == 0 || !spill_) return;
+    // Redo entries furthest from the present go first, then the oldest undo entries
+    while (history_bytes_ > history_budget_) {
+        if (spillFrom(redo_, redo_scan_, redo_.size())) continue;
+        if (undo_.empty() || !spillFrom(undo_, undo_scan_, undo_.size() - 1)) break;
+    }
+}
+
+// Evicts the first resident entry in [scan, end) that has a binary form; false when none is left
+bool CommandStack::spillFrom(std::vector<HistoryEntry>& history, size_t& scan, size_t end) {
+    for (; scan < end; ++scan) {
+        HistoryEntry& e = history[scan];
+        if (!e.cmd) continue;
+        diff_writer_.reset();
+        if (!e.cmd->encodeSpill(diff_writer_)) continue;
+        e.spilled = spill_->write(diff_writer_.finish());
+        e.cmd.reset();
+        history_bytes_ -= e.bytes;
+        ++spilled_;
+        ++scan;
+        return true;
+    }
+    return false;
+}
+
+void CommandStack::pollGroupCommit() {
+    const auto now = std::chrono::steady_clock::now();
+    if (merge_open_ && now - merge_last_ < coalesce_window_) return; // the run is still live
+    if (!group_open_) return;
+    if (merge_open_ || now - group_start_ >= group_window_) flush();
+}
+
+void CommandStack::flush() {
+    if (!group_open_) return;
+    try {
+        sealMerge();
+        group_open_ = false;
+        storage_.commit();
+    } catch (...) {
+        group_open_ = false;
+        merge_open_ = false;
+        storage_.rollback();
+        throw;
+    }
+}
+
+void CommandStack::writeRevision(const ICommand& cmd) {
+    // Same transaction as the data change: no torn revision log
+    if (storage_.storesDiffBlobs()) {
+        diff_writer_.reset();
+        if (cmd.encodeDiff(diff_writer_)) {
+            revision_.label = cmd.label();
+            revision_.diff_json.clear();
+            revision_.diff_blob.assign(diff_writer_.finish());
+            storage_.addRevision(revision_);
+            return;
+        }
+    }
+    if (auto diff = cmd.diffJson()) {
+        revision_.label = cmd.label();
+        revision_.diff_json.swap(*diff);
+        revision_.diff_blob.clear();
+        storage_.addRevision(revision_);
+    }
+}
+
+std::pmr::memory_resource* CommandStack::batchArena() {
+    if (!batch_->arena) {
+        // Small first block (a batch of one edit stays small); monotonic growth after that
+        batch_->arena = std::make_unique<std::pmr::monotonic_buffer_resource>(1024);
+    }
+    return batch_->arena.get();
+}
+
+// Writes the pending revision of a coalescing run; the shared transaction is still open.
+void CommandStack::sealMerge() {
+    if (!merge_open_) return;
+    writeRevision(*undo_.back().cmd);
+    merge_open_ = false;
+}
+
+// Opens the transaction scope for one edit: a savepoint inside the open group when group commit
+// or coalescing is on, otherwise a transaction of its own.
+void CommandStack::beginEdit() {
+    if (!sharedTransaction()) {
+        storage_.begin();
+        return;
+    }
+    if (!group_open_) {
+        storage_.begin();
+        group_open_ = true;
+        group_start_ = std::chrono::steady_clock::now();
+    }
+    storage_.savepoint();
+}
+
+void CommandStack::commitEdit() {
+    if (!group_open_) {
+        storage_.commit();
+        return;
+    }
+    storage_.releaseSavepoint();
+}
+
+void CommandStack::abortEdit() {
+    if (!group_open_) {
+        storage_.rollback();
+        return;
+    }
+    // Earlier edits of the group stay pending
+    storage_.rollbackToSavepoint();
+    storage_.releaseSavepoint();
+}
+
 void CommandStack::beginBatch(std::string label) {
     if (batch_.has_value()) {
         throw std::runtime_error("Batch already in progress");
     }
-    batch_ = CommandBatch{std::move(label), {}, {}};
+    // Pending grouped edits commit first; the batch then owns a transaction of its own
+    flush();
+    batch_.emplace();
+    batch_->label = std::move(label);
     batch_failed_ = false;
     // Begin a single transaction for the whole batch
     storage_.begin();
@@ -29,107 +302,160 @@ void CommandStack::endBatch() {
         batch_.reset();
         return;
     }
-    // Collapse into a single composite command by capturing the batch commands
-    struct Composite : public ICommand {
-        std::string lbl;
-        std::vector<std::unique_ptr<ICommand>> cmds;
-        std::string label() const override { return lbl; }
-        void doAction(IStorage& store) override {
-            for (auto& c : cmds) c->doAction(store);
-        }
-        void undoAction(IStorage& store) override {
-            for (auto it = cmds.rbegin(); it != cmds.rend(); ++it) {
-                (*it)->undoAction(store);
-            }
-        }
-    };
-    auto composite = std::make_unique<Composite>();
-    composite->lbl = batch_->label;
-    composite->cmds = std::move(batch_->commands);
-    // Commit the batch transaction
-    storage_.commit();
-
-    // Write a single coalesced revision for the batch
-    if (!batch_->diffs.empty()) {
-        std::string items;
-        for (size_t i = 0; i < batch_->diffs.size(); ++i) {
-            items += batch_->diffs[i];
-            if (i + 1 < batch_->diffs.size()) items += ",";
-        }
-        std::string diff = std::string("{\"op\":\"batch\",\"label\":\"") + composite->lbl +
-                           "\",\"items\":[" + items + "]}";
-        storage_.addRevision(RevisionRecord{composite->lbl, diff});
+    // Collapse into a single composite command with one coalesced revision, in the batch transaction
+    auto composite = std::make_unique<CompositeCommand>(std::move(batch_->label), std::move(batch_->commands),
+                                                        std::move(batch_->arena));
+    try {
+        writeRevision(*composite);
+        storage_.commit();
+    } catch (...) {
+        storage_.rollback();
+        batch_.reset();
+        throw;
     }
 
     batch_.reset();
-    undo_.push_back(std::move(composite));
-    redo_.clear();
+    pushHistory(undo_, std::move(composite));
+    clearRedo();
+    enforceBudget();
 }
 
 void CommandStack::execute(std::unique_ptr<ICommand> cmd) {
-    const bool batched = batch_.has_value();
-    if (!batched) storage_.begin();
-    try {
-        cmd->doAction(storage_);
-        if (!batched) storage_.commit();
-    } catch (...) {
-        if (batched) {
+    if (batch_.has_value()) {
+        try {
+            cmd->doAction(storage_);
+        } catch (...) {
             storage_.rollback();
             batch_failed_ = true;
-        } else {
-            storage_.rollback();
+            throw;
         }
-        throw;
+        batch_->commands.push_back(std::move(cmd));
+        return;
     }
 
-    if (auto diff = cmd->diffJson()) {
-        if (batched) {
-            batch_->diffs.push_back(*diff);
-        } else {
-            storage_.addRevision(RevisionRecord{cmd->label(), *diff});
+    const auto now = std::chrono::steady_clock::now();
+    if (merge_open_ && now - merge_last_ >= coalesce_window_) pollGroupCommit(); // run went stale
+    beginEdit();
+    bool merged = false;
+    try {
+        cmd->doAction(storage_);
+        if (merge_open_) merged = undo_.back().cmd->mergeWith(*cmd);
+        if (!merged) {
+            // The previous run ends here; its revision shares this edit's savepoint
+            if (merge_open_) writeRevision(*undo_.back().cmd);
+            if (coalesce_window_.count() <= 0) writeRevision(*cmd);
         }
+        commitEdit();
+    } catch (...) {
+        abortEdit();
+        throw;
     }
 
-    if (batched) {
-        batch_->commands.push_back(std::move(cmd));
+    if (!merged) {
+        pushHistory(undo_, std::move(cmd));
+        merge_open_ = coalesce_window_.count() > 0;
     } else {
-        undo_.push_back(std::move(cmd));
-        redo_.clear();
+        HistoryEntry& top = undo_.back();
+        history_bytes_ -= top.bytes;
+        top.bytes = top.cmd->memoryBytes();
+        history_bytes_ += top.bytes;
     }
+    merge_last_ = now;
+    clearRedo();
+    enforceBudget();
+    pollGroupCommit();
 }
 
 void CommandStack::undo() {
     if (undo_.empty()) return;
-    auto cmd = std::move(undo_.back());
-    undo_.pop_back();
-    storage_.begin();
+    if (merge_open_) flush();
+    auto cmd = popHistory(undo_, undo_scan_);
+    beginEdit();
     try {
         cmd->undoAction(storage_);
-        storage_.commit();
+        commitEdit();
     } catch (...) {
-        storage_.rollback();
+        abortEdit();
         throw;
     }
-    redo_.push_back(std::move(cmd));
+    pushHistory(redo_, std::move(cmd));
+    enforceBudget();
+    pollGroupCommit();
 }
 
 void CommandStack::redo() {
     if (redo_.empty()) return;
-    auto cmd = std::move(redo_.back());
-    redo_.pop_back();
-    storage_.begin();
+    if (merge_open_) flush();
+    auto cmd = popHistory(redo_, redo_scan_);
+    beginEdit();
     try {
         cmd->doAction(storage_);
-        storage_.commit();
+        commitEdit();
     } catch (...) {
-        storage_.rollback();
+        abortEdit();
         throw;
     }
-    undo_.push_back(std::move(cmd));
+    pushHistory(undo_, std::move(cmd));
+    enforceBudget();
+    pollGroupCommit();
+}
+
+size_t CommandStack::undoN(size_t n) { return travel(true, n); }
+
+size_t CommandStack::redoN(size_t n) { return travel(false, n); }
+
+size_t CommandStack::jumpTo(size_t position) {
+    const size_t here = undo_.size();
+    return position < here ? undoN(here - position) : redoN(position - here);
+}
+
+size_t CommandStack::travel(bool backwards, size_t n) {
+    std::vector<HistoryEntry>& from = backwards ? undo_ : redo_;
+    n = std::min(n, from.size());
+    if (n == 0) return 0;
+    if (merge_open_) flush();
+    std::vector<std::unique_ptr<ICommand>> steps;
+    steps.reserve(n);
+    // On failure the popped entries go back where they were, newest on top
+    auto restore = [&] {
+        for (auto it = steps.rbegin(); it != steps.rend(); ++it) pushHistory(from, std::move(*it));
+    };
+    try {
+        for (size_t i = 0; i < n; ++i) steps.push_back(popHistory(from, backwards ? undo_scan_ : redo_scan_));
+    } catch (...) {
+        restore();
+        throw;
+    }
+    beginEdit();
+    try {
+        if (dynamic_cast<IKeyframeStore*>(&storage_)) {
+            NetEffectStore net(storage_);
+            for (auto& cmd : steps) backwards ? cmd->undoAction(net) : cmd->doAction(net);
+            net.apply();
+        } else {
+            for (auto& cmd : steps) backwards ? cmd->undoAction(storage_) : cmd->doAction(storage_);
+        }
+        commitEdit();
+    } catch (...) {
+        abortEdit();
+        restore();
+        throw;
+    }
+    for (auto& cmd : steps) pushHistory(backwards ? redo_ : undo_, std::move(cmd));
+    enforceBudget();
+    pollGroupCommit();
+    return n;
 }
 
 void CommandStack::pushRevision(const RevisionRecord& r) {
     storage_.addRevision(r);
 }
 
+void CommandStack::pushApplied(std::unique_ptr<ICommand> cmd) {
+    flush();
+    pushHistory(undo_, std::move(cmd));
+    clearRedo();
+    enforceBudget();
+}
+
 } // namespace verity
@@ -1,50 +1,46 @@
 #include "commands/add_keyframe.hpp"
-#include "verity/db.hpp"
-#include <random>
+#include "verity/keyframe_store.hpp"
 
 namespace verity {
 
-static std::string make_uuid_like() {
-    // simple pseudo-uuid for demo purposes
-    static std::mt19937_64 rng{12345};
-    uint64_t a = rng();
-    uint64_t b = rng();
-    char buf[37];
-    snprintf(buf, sizeof(buf), "%08x-%04x-%04x-%04x-%012llx",
-             (unsigned)(a & 0xffffffff), (unsigned)((a >> 32) & 0xffff), (unsigned)((a >> 48) & 0xffff),
-             (unsigned)(b & 0xffff), (unsigned long long)((b >> 16) & 0xffffffffffffull));
-    return std::string(buf);
-}
+AddKeyframeCommand::AddKeyframeCommand(KeyId track_id, int t_ms, std::string_view value_json, std::string_view interp,
+                                       KeyId key_id)
+    : AddKeyframeCommand(std::allocator_arg, std::pmr::get_default_resource(), track_id, t_ms, value_json, interp,
+                         key_id) {}
+
+AddKeyframeCommand::AddKeyframeCommand(std::string_view track_id, int t_ms, std::string_view value_json,
+                                       std::string_view interp, std::string_view fixed_id)
+    : AddKeyframeCommand(std::allocator_arg, std::pmr::get_default_resource(), track_id, t_ms, value_json, interp,
+                         fixed_id) {}
 
-AddKeyframeCommand::AddKeyframeCommand(std::string track_id, int t_ms, std::string value_json, std::string interp)
-    : track_id_(std::move(track_id)), t_ms_(t_ms), value_json_(std::move(value_json)), interp_(std::move(interp)) {}
+AddKeyframeCommand::AddKeyframeCommand(std::allocator_arg_t, std::pmr::memory_resource* payload, KeyId track_id,
+                                       int t_ms, std::string_view value_json, std::string_view interp, KeyId key_id)
+    : track_id_(track_id), key_id_(key_id), t_ms_(t_ms), value_json_(value_json, payload), interp_(interp, payload) {}
 
-AddKeyframeCommand::AddKeyframeCommand(std::string track_id, int t_ms, std::string value_json, std::string interp, std::string fixed_id)
-    : track_id_(std::move(track_id)), t_ms_(t_ms), value_json_(std::move(value_json)), interp_(std::move(interp)), key_id_(std::move(fixed_id)) {}
+AddKeyframeCommand::AddKeyframeCommand(std::allocator_arg_t, std::pmr::memory_resource* payload,
+                                       std::string_view track_id, int t_ms, std::string_view value_json,
+                                       std::string_view interp, std::string_view fixed_id)
+    : AddKeyframeCommand(std::allocator_arg, payload, KeyId::fromText(track_id), t_ms, value_json, interp,
+                         KeyId::fromText(fixed_id)) {}
 
 void AddKeyframeCommand::doAction(IStorage& store) {
-    if (key_id_.empty()) key_id_ = make_uuid_like();
-#if VERITY_DESKTOP_SQLITE
-    if (auto* sql = dynamic_cast<verity::SqliteStorage*>(&store)) {
-        sql->insertKeyframe(key_id_, track_id_, t_ms_, value_json_, interp_);
+    if (key_id_.empty()) key_id_ = KeyId::generate();
+    if (auto* sql = dynamic_cast<verity::IKeyframeStore*>(&store)) {
+        sql->insertKeyframe(key_id_, track_id_.text(), t_ms_, value_json_, interp_);
         return;
     }
-#endif
     // NullStorage path: do nothing (in-memory only)
 }
 
 void AddKeyframeCommand::undoAction(IStorage& store) {
-    (void)store;
-#if VERITY_DESKTOP_SQLITE
-    if (auto* sql = dynamic_cast<verity::SqliteStorage*>(&store)) {
+    if (auto* sql = dynamic_cast<verity::IKeyframeStore*>(&store)) {
         sql->deleteKeyframe(key_id_);
         return;
     }
-#endif
 }
 
 std::optional<std::string> AddKeyframeCommand::diffJson() const {
-    auto escape = [](const std::string& s) {
+    auto escape = [](std::string_view s) {
         std::string out;
         out.reserve(s.size() + 8);
         for (char c : s) {
@@ -59,9 +55,27 @@ std::optional<std::string> AddKeyframeCommand::diffJson() const {
         }
         return out;
     };
-    return std::string("{\"op\":\"add_key\",\"track_id\":\"") + track_id_ + "\",\"t_ms\":" +
-           std::to_string(t_ms_) + ",\"id\":\"" + key_id_ + "\",\"interp\":\"" + interp_ +
-           "\",\"value_json\":\"" + escape(value_json_) + "\"}";
+    std::string json = "{\"op\":\"add_key\",\"track_id\":\"";
+    json += track_id_.text().view();
+    json += "\",\"t_ms\":" + std::to_string(t_ms_) + ",\"id\":\"";
+    json += key_id_.text().view();
+    json += "\",\"interp\":\"";
+    json += interp_;
+    return json + "\",\"value_json\":\"" + escape(value_json_) + "\"}";
+}
+
+bool AddKeyframeCommand::encodeDiff(DiffWriter& out) const {
+    out.op(diffcodec::kAddKey);
+    out.id(track_id_);
+    out.i(t_ms_);
+    out.id(key_id_);
+    out.ref(interp_);
+    out.bytes(value_json_);
+    return true;
+}
+
+size_t AddKeyframeCommand::memoryBytes() const {
+    return sizeof(*this) + heap_bytes(value_json_) + heap_bytes(interp_);
 }
 
 } // namespace verity
@@ -0,0 +1,178 @@
+#include "commands/bulk_keyframes.hpp"
+#include "verity/keyframe_store.hpp"
+
+namespace verity {
+
+static void append_escaped(std::string& out, std::string_view s) {
+    for (char c : s) {
+        switch (c) {
+        case '"': out += "\\\""; break;
+        case '\\': out += "\\\\"; break;
+        case '\n': out += "\\n"; break;
+        case '\r': out += "\\r"; break;
+        case '\t': out += "\\t"; break;
+        default: out += c; break;
+        }
+    }
+}
+
+static void append_id_array(std::string& out, const KeyIdList& ids) {
+    out += "\"ids\":[";
+    for (size_t i = 0; i < ids.size(); ++i) {
+        if (i) out += ",";
+        out += "\"";
+        append_escaped(out, ids[i].text());
+        out += "\"";
+    }
+    out += "]";
+}
+
+static void encode_ids(DiffWriter& out, const KeyIdList& ids) {
+    out.u(ids.size());
+    for (const KeyId& id : ids) out.id(id);
+}
+
+static void encode_rows(DiffWriter& out, const KeyframeBatch& rows) {
+    out.u(rows.size());
+    int prev = 0;
+    for (size_t i = 0; i < rows.size(); ++i) {
+        out.id(rows.id(i));
+        out.ref(rows.trackId(i));
+        out.i(int64_t(rows.tMs(i)) - prev);
+        out.ref(rows.interp(i));
+        out.bytes(rows.valueJson(i));
+        prev = rows.tMs(i);
+    }
+}
+
+BulkInsertKeyframesCommand::BulkInsertKeyframesCommand(KeyframeBatch rows) : rows_(std::move(rows)) {}
+
+void BulkInsertKeyframesCommand::doAction(IStorage& store) {
+    if (auto* sql = dynamic_cast<verity::IKeyframeStore*>(&store)) {
+        sql->insertKeyframes(rows_);
+        return;
+    }
+}
+
+void BulkInsertKeyframesCommand::undoAction(IStorage& store) {
+    if (auto* sql = dynamic_cast<verity::IKeyframeStore*>(&store)) {
+        sql->deleteKeyframes(rows_.ids());
+        return;
+    }
+}
+
+std::optional<std::string> BulkInsertKeyframesCommand::diffJson() const {
+    // Items use the add_key field names so replay can share the row parser
+    std::string s = "{\"op\":\"bulk_add\",\"items\":[";
+    for (size_t i = 0; i < rows_.size(); ++i) {
+        if (i) s += ",";
+        s += "{\"track_id\":\"";
+        append_escaped(s, rows_.trackId(i));
+        s += "\",\"t_ms\":" + std::to_string(rows_.tMs(i)) + ",\"id\":\"";
+        append_escaped(s, rows_.id(i).text());
+        s += "\",\"interp\":\"";
+        append_escaped(s, rows_.interp(i));
+        s += "\",\"value_json\":\"";
+        append_escaped(s, rows_.valueJson(i));
+        s += "\"}";
+    }
+    s += "]}";
+    return s;
+}
+
+bool BulkInsertKeyframesCommand::encodeDiff(DiffWriter& out) const {
+    out.op(diffcodec::kBulkAdd);
+    encode_rows(out, rows_);
+    return true;
+}
+
+size_t BulkInsertKeyframesCommand::memoryBytes() const { return sizeof(*this) + rows_.memoryBytes(); }
+
+BulkMoveKeyframesCommand::BulkMoveKeyframesCommand(KeyIdList ids, int delta_ms)
+    : ids_(std::move(ids)), delta_ms_(delta_ms) {}
+
+void BulkMoveKeyframesCommand::doAction(IStorage& store) {
+    if (auto* sql = dynamic_cast<verity::IKeyframeStore*>(&store)) {
+        sql->shiftKeyframes(ids_, delta_ms_);
+        return;
+    }
+}
+
+void BulkMoveKeyframesCommand::undoAction(IStorage& store) {
+    if (auto* sql = dynamic_cast<verity::IKeyframeStore*>(&store)) {
+        sql->shiftKeyframes(ids_, -delta_ms_);
+        return;
+    }
+}
+
+bool BulkMoveKeyframesCommand::mergeWith(const ICommand& next) {
+    const auto* m = dynamic_cast<const BulkMoveKeyframesCommand*>(&next);
+    if (!m || m->ids_.size() != ids_.size()) return false;
+    for (size_t i = 0; i < ids_.size(); ++i) {
+        if (m->ids_[i] != ids_[i]) return false;
+    }
+    delta_ms_ += m->delta_ms_;
+    return true;
+}
+
+std::optional<std::string> BulkMoveKeyframesCommand::diffJson() const {
+    std::string s = "{\"op\":\"bulk_move\",\"delta\":" + std::to_string(delta_ms_) + ",";
+    append_id_array(s, ids_);
+    s += "}";
+    return s;
+}
+
+bool BulkMoveKeyframesCommand::encodeDiff(DiffWriter& out) const {
+    out.op(diffcodec::kBulkMove);
+    out.i(delta_ms_);
+    encode_ids(out, ids_);
+    return true;
+}
+
+size_t BulkMoveKeyframesCommand::memoryBytes() const { return sizeof(*this) + ids_.capacity() * sizeof(KeyId); }
+
+BulkDeleteKeyframesCommand::BulkDeleteKeyframesCommand(KeyIdList ids) : ids_(std::move(ids)) {}
+
+BulkDeleteKeyframesCommand::BulkDeleteKeyframesCommand(KeyIdList ids, KeyframeBatch removed)
+    : ids_(std::move(ids)), removed_(std::move(removed)) {}
+
+void BulkDeleteKeyframesCommand::doAction(IStorage& store) {
+    if (auto* sql = dynamic_cast<verity::IKeyframeStore*>(&store)) {
+        removed_ = sql->deleteKeyframes(ids_);
+        return;
+    }
+}
+
+void BulkDeleteKeyframesCommand::undoAction(IStorage& store) {
+    if (auto* sql = dynamic_cast<verity::IKeyframeStore*>(&store)) {
+        sql->insertKeyframes(removed_);
+        removed_ = KeyframeBatch{};
+        return;
+    }
+}
+
+std::optional<std::string> BulkDeleteKeyframesCommand::diffJson() const {
+    std::string s = "{\"op\":\"bulk_delete\",";
+    append_id_array(s, ids_);
+    s += "}";
+    return s;
+}
+
+bool BulkDeleteKeyframesCommand::encodeDiff(DiffWriter& out) const {
+    out.op(diffcodec::kBulkDelete);
+    encode_ids(out, ids_);
+    return true;
+}
+
+bool BulkDeleteKeyframesCommand::encodeSpill(DiffWriter& out) const {
+    out.op(diffcodec::kBulkDeleteApplied);
+    encode_ids(out, ids_);
+    encode_rows(out, removed_);
+    return true;
+}
+
+size_t BulkDeleteKeyframesCommand::memoryBytes() const {
+    return sizeof(*this) + ids_.capacity() * sizeof(KeyId) + removed_.memoryBytes();
+}
+
+} // namespace verity
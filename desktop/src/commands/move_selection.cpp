@@ -1,44 +1,89 @@
 #include "commands/move_selection.hpp"
-#include "verity/db.hpp"
+#include "verity/keyframe_store.hpp"
 
 namespace verity {
 
-MoveSelectionCommand::MoveSelectionCommand(std::vector<std::pair<std::string, int>> selection, int delta_ms)
+MoveSelectionCommand::MoveSelectionCommand(std::vector<std::pair<KeyId, int>> selection, int delta_ms)
     : selection_(std::move(selection)), delta_ms_(delta_ms) {}
 
+MoveSelectionCommand::MoveSelectionCommand(const std::vector<std::pair<std::string, int>>& selection, int delta_ms)
+    : delta_ms_(delta_ms) {
+    selection_.reserve(selection.size());
+    for (const auto& kv : selection) selection_.emplace_back(KeyId::fromText(kv.first), kv.second);
+}
+
 void MoveSelectionCommand::doAction(IStorage& store) {
-    (void)store;
-#if VERITY_DESKTOP_SQLITE
-    if (auto* sql = dynamic_cast<verity::SqliteStorage*>(&store)) {
+    if (auto* sql = dynamic_cast<verity::IKeyframeStore*>(&store)) {
         for (const auto& kv : selection_) {
             sql->updateKeyframeTime(kv.first, kv.second + delta_ms_);
         }
         return;
     }
-#endif
 }
 
 void MoveSelectionCommand::undoAction(IStorage& store) {
-    (void)store;
-#if VERITY_DESKTOP_SQLITE
-    if (auto* sql = dynamic_cast<verity::SqliteStorage*>(&store)) {
+    if (auto* sql = dynamic_cast<verity::IKeyframeStore*>(&store)) {
         for (const auto& kv : selection_) {
             sql->updateKeyframeTime(kv.first, kv.second);
         }
         return;
     }
-#endif
+}
+
+bool MoveSelectionCommand::mergeWith(const ICommand& next) {
+    const auto* m = dynamic_cast<const MoveSelectionCommand*>(&next);
+    if (!m || m->selection_.size() != selection_.size()) return false;
+    // Incremental drags start where this move left the keys; absolute drags restate the originals
+    bool incremental = true;
+    bool absolute = true;
+    for (size_t i = 0; i < selection_.size(); ++i) {
+        if (m->selection_[i].first != selection_[i].first) return false;
+        incremental = incremental && m->selection_[i].second == selection_[i].second + delta_ms_;
+        absolute = absolute && m->selection_[i].second == selection_[i].second;
+    }
+    if (incremental) {
+        delta_ms_ += m->delta_ms_;
+    } else if (absolute) {
+        delta_ms_ = m->delta_ms_;
+    } else {
+        return false;
+    }
+    return true;
 }
 
 std::optional<std::string> MoveSelectionCommand::diffJson() const {
+    // Rows written before ids were escaped used \" for the item quotes; replay still accepts them
     std::string s = "{\"op\":\"move\",\"delta\":" + std::to_string(delta_ms_) + ",\"items\":[";
     for (size_t i = 0; i < selection_.size(); ++i) {
         const auto& it = selection_[i];
-        s += "{\\\"id\\\":\\\"" + it.first + "\\\",\\\"orig_t_ms\\\":" + std::to_string(it.second) + "}";
+        s += "{\"id\":\"";
+        const KeyIdText id = it.first.text(); // owns a UUID's characters; keep it alive over the loop
+        for (char c : id.view()) {
+            if (c == '"' || c == '\\') s += '\\';
+            s += c;
+        }
+        s += "\",\"orig_t_ms\":" + std::to_string(it.second) + "}";
         if (i + 1 < selection_.size()) s += ",";
     }
     s += "]}";
     return s;
 }
 
+bool MoveSelectionCommand::encodeDiff(DiffWriter& out) const {
+    out.op(diffcodec::kMove);
+    out.i(delta_ms_);
+    out.u(selection_.size());
+    int prev = 0;
+    for (const auto& it : selection_) {
+        out.id(it.first);
+        out.i(int64_t(it.second) - prev);
+        prev = it.second;
+    }
+    return true;
+}
+
+size_t MoveSelectionCommand::memoryBytes() const {
+    return sizeof(*this) + selection_.capacity() * sizeof(selection_[0]);
+}
+
 } // namespace verity
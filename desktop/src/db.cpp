@@ -1,7 +1,10 @@
 #include "verity/db.hpp"
 #if VERITY_DESKTOP_SQLITE
+#include "verity/json_scan.hpp"
+#include "verity/track_blob.hpp"
 #include <stdexcept>
 #include <string>
+#include <string_view>
 
 namespace verity {
 
@@ -21,102 +24,700 @@ SqliteStorage::SqliteStorage(const std::string& db_path) : db_path_(db_path) {
     exec_or_throw(db_, "PRAGMA foreign_keys=ON;");
     exec_or_throw(db_, "PRAGMA journal_mode=WAL;");
     exec_or_throw(db_, "PRAGMA synchronous=NORMAL;");
+    sqlite3_stmt* info = nullptr;
+    if (sqlite3_prepare_v2(db_, "SELECT 1 FROM pragma_table_info('revisions') WHERE name = 'diff_blob'", -1, &info,
+                           nullptr) == SQLITE_OK) {
+        diff_blob_column_ = sqlite3_step(info) == SQLITE_ROW;
+    }
+    sqlite3_finalize(info);
+}
+
+void SqliteStorage::setMmapSize(int64_t bytes) {
+    exec_or_throw(db_, ("PRAGMA mmap_size=" + std::to_string(bytes) + ";").c_str());
+}
+
+void SqliteStorage::setCacheSize(int64_t kib) {
+    // Negative cache_size is in KiB rather than pages
+    exec_or_throw(db_, ("PRAGMA cache_size=-" + std::to_string(kib) + ";").c_str());
+}
+
+void SqliteStorage::setBusyTimeout(std::chrono::milliseconds wait) {
+    sqlite3_busy_timeout(db_, static_cast<int>(wait.count()));
+}
+
+void SqliteStorage::setWalAutocheckpoint(int pages) {
+    sqlite3_wal_autocheckpoint(db_, pages);
 }
 
 SqliteStorage::~SqliteStorage() {
+    for (sqlite3_stmt* st : stmts_) sqlite3_finalize(st);
     if (db_) sqlite3_close(db_);
 }
 
-void SqliteStorage::begin() { exec_or_throw(db_, "BEGIN"); }
-void SqliteStorage::commit() { exec_or_throw(db_, "COMMIT"); }
-void SqliteStorage::rollback() { exec_or_throw(db_, "ROLLBACK"); }
+// Resets a cached statement and drops its bindings on scope exit (including error paths), so the
+// next call starts clean and no SQLITE_STATIC binding outlives the caller's strings.
+namespace {
+struct StmtScope {
+    sqlite3_stmt* stmt;
+    ~StmtScope() {
+        sqlite3_reset(stmt);
+        sqlite3_clear_bindings(stmt);
+    }
+};
 
-void SqliteStorage::addRevision(const RevisionRecord& r) {
-    sqlite3_stmt* stmt = nullptr;
-    const char* sql = "INSERT INTO revisions(project_id, user, label, diff_json, created_at)"
-                      " VALUES((SELECT id FROM projects LIMIT 1), ?, ?, ?, CAST(strftime('%s','now') AS INTEGER))";
-    if (sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr) != SQLITE_OK) {
-        throw std::runtime_error("prepare failed for insert revision");
+// Bound without a copy: every caller steps the statement before `s` goes out of scope.
+void bind_text(sqlite3_stmt* stmt, int idx, std::string_view s) {
+    sqlite3_bind_text(stmt, idx, s.data(), static_cast<int>(s.size()), SQLITE_STATIC);
+}
+
+std::string_view column_text(sqlite3_stmt* stmt, int col) {
+    const auto* p = reinterpret_cast<const char*>(sqlite3_column_text(stmt, col));
+    return p ? std::string_view(p, static_cast<size_t>(sqlite3_column_bytes(stmt, col))) : std::string_view();
+}
+
+// Statement for rarely run maintenance SQL (checkpoints); finalized on scope exit.
+struct OwnedStmt {
+    sqlite3_stmt* stmt {nullptr};
+    OwnedStmt(sqlite3* db, const char* sql) {
+        if (sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr) != SQLITE_OK) {
+            throw std::runtime_error(std::string("prepare failed: ") + sqlite3_errmsg(db));
+        }
     }
-    sqlite3_bind_text(stmt, 1, "local", -1, SQLITE_TRANSIENT);
-    sqlite3_bind_text(stmt, 2, r.label.c_str(), -1, SQLITE_TRANSIENT);
-    sqlite3_bind_text(stmt, 3, r.diff_json.c_str(), -1, SQLITE_TRANSIENT);
-    if (sqlite3_step(stmt) != SQLITE_DONE) {
-        sqlite3_finalize(stmt);
-        throw std::runtime_error("insert revision failed");
+    ~OwnedStmt() { sqlite3_finalize(stmt); }
+    OwnedStmt(const OwnedStmt&) = delete;
+    OwnedStmt& operator=(const OwnedStmt&) = delete;
+};
+
+// Same tables as schema/migrations/V0002__revision_checkpoints.sql
+constexpr const char* kCheckpointSchema =
+    "CREATE TABLE IF NOT EXISTS revision_checkpoints(id INTEGER PRIMARY KEY AUTOINCREMENT,"
+    " revision_id INTEGER NOT NULL, key_count INTEGER NOT NULL, created_at INTEGER NOT NULL);"
+    "CREATE TABLE IF NOT EXISTS checkpoint_keyframes(checkpoint_id INTEGER NOT NULL, id TEXT NOT NULL,"
+    " track_id TEXT NOT NULL, t_ms INTEGER NOT NULL, value_json TEXT NOT NULL, interp TEXT NOT NULL,"
+    " PRIMARY KEY (checkpoint_id, id),"
+    " FOREIGN KEY (checkpoint_id) REFERENCES revision_checkpoints(id) ON DELETE CASCADE) WITHOUT ROWID;";
+
+// Same tables and triggers as schema/migrations/V0004__track_chunks.sql
+constexpr const char* kTrackChunkSchema =
+    "CREATE TABLE IF NOT EXISTS track_chunks(track_id TEXT NOT NULL, seq INTEGER NOT NULL, t0_ms INTEGER NOT NULL,"
+    " t1_ms INTEGER NOT NULL, key_count INTEGER NOT NULL, layout TEXT NOT NULL, data BLOB NOT NULL,"
+    " PRIMARY KEY (track_id, seq));"
+    "CREATE TABLE IF NOT EXISTS track_chunks_stale(track_id TEXT PRIMARY KEY) WITHOUT ROWID;"
+    "CREATE TRIGGER IF NOT EXISTS trg_keyframes_chunks_insert AFTER INSERT ON keyframes"
+    " WHEN EXISTS (SELECT 1 FROM track_chunks) BEGIN"
+    " INSERT OR IGNORE INTO track_chunks_stale(track_id) VALUES (NEW.track_id);"
+    " DELETE FROM track_chunks WHERE track_id = NEW.track_id; END;"
+    "CREATE TRIGGER IF NOT EXISTS trg_keyframes_chunks_delete AFTER DELETE ON keyframes"
+    " WHEN EXISTS (SELECT 1 FROM track_chunks) BEGIN"
+    " INSERT OR IGNORE INTO track_chunks_stale(track_id) VALUES (OLD.track_id);"
+    " DELETE FROM track_chunks WHERE track_id = OLD.track_id; END;"
+    "CREATE TRIGGER IF NOT EXISTS trg_keyframes_chunks_update AFTER UPDATE OF track_id, t_ms, value_json, interp"
+    " ON keyframes WHEN EXISTS (SELECT 1 FROM track_chunks) BEGIN"
+    " INSERT OR IGNORE INTO track_chunks_stale(track_id) VALUES (OLD.track_id);"
+    " INSERT OR IGNORE INTO track_chunks_stale(track_id) VALUES (NEW.track_id);"
+    " DELETE FROM track_chunks WHERE track_id IN (OLD.track_id, NEW.track_id); END;";
+
+// Same table and triggers as schema/migrations/V0005__engine_snapshot_token.sql
+constexpr const char* kEngineSnapshotSchema =
+    "CREATE TABLE IF NOT EXISTS engine_snapshot_token(token INTEGER NOT NULL);"
+    "CREATE TRIGGER IF NOT EXISTS trg_keyframes_snapshot_insert AFTER INSERT ON keyframes"
+    " WHEN EXISTS (SELECT 1 FROM engine_snapshot_token) BEGIN DELETE FROM engine_snapshot_token; END;"
+    "CREATE TRIGGER IF NOT EXISTS trg_keyframes_snapshot_delete AFTER DELETE ON keyframes"
+    " WHEN EXISTS (SELECT 1 FROM engine_snapshot_token) BEGIN DELETE FROM engine_snapshot_token; END;"
+    "CREATE TRIGGER IF NOT EXISTS trg_keyframes_snapshot_update AFTER UPDATE OF track_id, t_ms, value_json, interp"
+    " ON keyframes WHEN EXISTS (SELECT 1 FROM engine_snapshot_token) BEGIN DELETE FROM engine_snapshot_token; END;";
+
+std::string pack_layout(const TrackPackOptions& options) {
+    return options.channel + "," + options.in_tangent + "," + options.out_tangent;
+}
+} // namespace
+
+sqlite3_stmt* SqliteStorage::cached(Stmt id) const {
+    static const char* const kSql[kStmtCount] = {
+        "BEGIN",
+        "COMMIT",
+        "ROLLBACK",
+        "SAVEPOINT verity_edit",
+        "RELEASE verity_edit",
+        "ROLLBACK TO verity_edit",
+        "INSERT INTO revisions(project_id, user, label, diff_json, diff_blob, created_at)"
+        " VALUES((SELECT id FROM projects LIMIT 1), 'local', ?, ?, ?, CAST(strftime('%s','now') AS INTEGER))",
+        "SELECT label, diff_json, diff_blob FROM revisions ORDER BY id ASC",
+        "SELECT label, diff_json, diff_blob FROM revisions WHERE id > ? ORDER BY id ASC",
+        "SELECT COALESCE(MAX(id), 0) FROM revisions",
+        "INSERT INTO keyframes(id, track_id, t_ms, value_json, interp, created_at, updated_at)"
+        " VALUES(?,?,?,?,?, CAST(strftime('%s','now') AS INTEGER), CAST(strftime('%s','now') AS INTEGER))",
+        "DELETE FROM keyframes WHERE id = ?",
+        "UPDATE keyframes SET t_ms = ?, updated_at = CAST(strftime('%s','now') AS INTEGER) WHERE id = ?",
+        "INSERT OR IGNORE INTO temp.verity_stage_ids(id) VALUES(?)",
+        "DELETE FROM temp.verity_stage_ids",
+        "INSERT INTO temp.verity_stage_rows(id, track_id, t_ms, value_json, interp) VALUES(?,?,?,?,?)",
+        "DELETE FROM temp.verity_stage_rows",
+        "INSERT INTO keyframes(id, track_id, t_ms, value_json, interp, created_at, updated_at)"
+        " SELECT id, track_id, t_ms, value_json, interp, CAST(strftime('%s','now') AS INTEGER),"
+        " CAST(strftime('%s','now') AS INTEGER) FROM temp.verity_stage_rows",
+        "UPDATE keyframes SET t_ms = t_ms + ?, updated_at = CAST(strftime('%s','now') AS INTEGER)"
+        " WHERE id IN (SELECT id FROM temp.verity_stage_ids)",
+        "SELECT id, track_id, t_ms, value_json, interp FROM keyframes"
+        " WHERE id IN (SELECT id FROM temp.verity_stage_ids) ORDER BY track_id, t_ms",
+        "DELETE FROM keyframes WHERE id IN (SELECT id FROM temp.verity_stage_ids)",
+    };
+    // Projects that predate migration V0003 have no diff_blob column
+    static const char* const kJsonOnlySql[] = {
+        "INSERT INTO revisions(project_id, user, label, diff_json, created_at)"
+        " VALUES((SELECT id FROM projects LIMIT 1), 'local', ?, ?, CAST(strftime('%s','now') AS INTEGER))",
+        "SELECT label, diff_json, NULL FROM revisions ORDER BY id ASC",
+        "SELECT label, diff_json, NULL FROM revisions WHERE id > ? ORDER BY id ASC",
+    };
+    const char* sql = kSql[id];
+    if (!diff_blob_column_ && id >= kStmtInsertRevision && id <= kStmtSelectRevisionsAfter) {
+        sql = kJsonOnlySql[id - kStmtInsertRevision];
     }
-    sqlite3_finalize(stmt);
+    sqlite3_stmt*& st = stmts_[id];
+    if (!st && sqlite3_prepare_v3(db_, sql, -1, SQLITE_PREPARE_PERSISTENT, &st, nullptr) != SQLITE_OK) {
+        st = nullptr;
+        throw std::runtime_error(std::string("prepare failed: ") + sqlite3_errmsg(db_));
+    }
+    return st;
 }
 
-std::vector<RevisionRecord> SqliteStorage::readRevisions() const {
-    std::vector<RevisionRecord> out;
-    sqlite3_stmt* stmt = nullptr;
-    const char* sql = "SELECT label, diff_json FROM revisions ORDER BY id ASC";
-    if (sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr) != SQLITE_OK) {
-        throw std::runtime_error("prepare failed for select revisions");
+void SqliteStorage::runCached(Stmt id, const char* what) {
+    StmtScope scope {cached(id)};
+    if (sqlite3_step(scope.stmt) != SQLITE_DONE) throw std::runtime_error(std::string(what) + ": " + sqlite3_errmsg(db_));
+}
+
+void SqliteStorage::begin() {
+    runCached(kStmtBegin, "begin failed");
+    if (scene_) scene_->begin();
+}
+
+void SqliteStorage::commit() {
+    runCached(kStmtCommit, "commit failed");
+    if (scene_) scene_->commit();
+}
+
+void SqliteStorage::rollback() {
+    if (scene_) scene_->rollback();
+    runCached(kStmtRollback, "rollback failed");
+}
+
+void SqliteStorage::savepoint() {
+    runCached(kStmtSavepoint, "savepoint failed");
+    if (scene_) scene_->savepoint();
+}
+
+void SqliteStorage::releaseSavepoint() {
+    runCached(kStmtRelease, "release savepoint failed");
+    if (scene_) scene_->releaseSavepoint();
+}
+
+void SqliteStorage::rollbackToSavepoint() {
+    if (scene_) scene_->rollbackToSavepoint();
+    runCached(kStmtRollbackTo, "rollback to savepoint failed");
+}
+
+void SqliteStorage::attachSceneIndex(SceneIndex* scene) {
+    scene_ = nullptr;
+    if (!scene) return;
+    scene->clear();
+    scanKeyframes([scene](const KeyframeRowView& row) {
+        scene->insert(row.id, row.track_id, row.t_ms, row.value_json, row.interp);
+    });
+    if (sqlite3_get_autocommit(db_) == 0) scene->begin(); // attached mid-transaction
+    scene_ = scene;
+}
+
+void SqliteStorage::addRevision(const RevisionRecord& r) {
+    StmtScope scope {cached(kStmtInsertRevision)};
+    bind_text(scope.stmt, 1, r.label);
+    // Empty diff fields are stored as NULL
+    if (!r.diff_json.empty()) bind_text(scope.stmt, 2, r.diff_json);
+    if (!r.diff_blob.empty()) {
+        if (!diff_blob_column_) throw std::runtime_error("insert revision failed: no diff_blob column (migration V0003)");
+        sqlite3_bind_blob(scope.stmt, 3, r.diff_blob.data(), static_cast<int>(r.diff_blob.size()), SQLITE_STATIC);
     }
+    if (sqlite3_step(scope.stmt) != SQLITE_DONE) throw std::runtime_error("insert revision failed");
+}
+
+static std::vector<RevisionRecord> read_revision_rows(sqlite3_stmt* stmt) {
+    std::vector<RevisionRecord> out;
     while (sqlite3_step(stmt) == SQLITE_ROW) {
-        const unsigned char* lbl = sqlite3_column_text(stmt, 0);
-        const unsigned char* diff = sqlite3_column_text(stmt, 1);
         RevisionRecord r;
-        r.label = lbl ? reinterpret_cast<const char*>(lbl) : "";
-        r.diff_json = diff ? reinterpret_cast<const char*>(diff) : "";
+        r.label = column_text(stmt, 0);
+        r.diff_json = column_text(stmt, 1);
+        if (const void* blob = sqlite3_column_blob(stmt, 2)) {
+            r.diff_blob.assign(static_cast<const char*>(blob), static_cast<size_t>(sqlite3_column_bytes(stmt, 2)));
+        }
         out.emplace_back(std::move(r));
     }
-    sqlite3_finalize(stmt);
     return out;
 }
 
-void SqliteStorage::insertKeyframe(const std::string& key_id,
-                                   const std::string& track_id,
-                                   int t_ms,
-                                   const std::string& value_json,
-                                   const std::string& interp) {
+std::vector<RevisionRecord> SqliteStorage::readRevisions() const {
+    StmtScope scope {cached(kStmtSelectRevisions)};
+    return read_revision_rows(scope.stmt);
+}
+
+std::vector<RevisionRecord> SqliteStorage::readRevisionsAfter(int64_t after_id) const {
+    StmtScope scope {cached(kStmtSelectRevisionsAfter)};
+    sqlite3_bind_int64(scope.stmt, 1, after_id);
+    return read_revision_rows(scope.stmt);
+}
+
+int64_t SqliteStorage::latestRevisionId() const {
+    StmtScope scope {cached(kStmtLatestRevision)};
+    int64_t id = 0;
+    if (sqlite3_step(scope.stmt) == SQLITE_ROW) id = sqlite3_column_int64(scope.stmt, 0);
+    return id;
+}
+
+void SqliteStorage::scanKeyframes(const std::function<void(const KeyframeRowView&)>& fn) const {
     sqlite3_stmt* stmt = nullptr;
-    const char* sql = "INSERT INTO keyframes(id, track_id, t_ms, value_json, interp, created_at, updated_at)"
-                      " VALUES(?,?,?,?,?, CAST(strftime('%s','now') AS INTEGER), CAST(strftime('%s','now') AS INTEGER))";
+    const char* sql = "SELECT id, track_id, t_ms, value_json, interp FROM keyframes ORDER BY track_id, t_ms";
     if (sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr) != SQLITE_OK) {
-        throw std::runtime_error("prepare failed for insert keyframe");
-    }
-    sqlite3_bind_text(stmt, 1, key_id.c_str(), -1, SQLITE_TRANSIENT);
-    sqlite3_bind_text(stmt, 2, track_id.c_str(), -1, SQLITE_TRANSIENT);
-    sqlite3_bind_int(stmt, 3, t_ms);
-    sqlite3_bind_text(stmt, 4, value_json.c_str(), -1, SQLITE_TRANSIENT);
-    sqlite3_bind_text(stmt, 5, interp.c_str(), -1, SQLITE_TRANSIENT);
-    if (sqlite3_step(stmt) != SQLITE_DONE) {
+        throw std::runtime_error("prepare failed for scan keyframes");
+    }
+    auto text = [stmt](int col) { return column_text(stmt, col); };
+    int rc = SQLITE_OK;
+    try {
+        while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+            KeyframeRowView row;
+            row.id = text(0);
+            row.track_id = text(1);
+            row.t_ms = sqlite3_column_int(stmt, 2);
+            row.value_json = text(3);
+            row.interp = text(4);
+            fn(row);
+        }
+    } catch (...) {
         sqlite3_finalize(stmt);
-        throw std::runtime_error("insert keyframe failed");
+        throw;
     }
     sqlite3_finalize(stmt);
+    if (rc != SQLITE_DONE) throw std::runtime_error("scan keyframes failed");
 }
 
-void SqliteStorage::deleteKeyframe(const std::string& key_id) {
-    sqlite3_stmt* stmt = nullptr;
-    const char* sql = "DELETE FROM keyframes WHERE id = ?";
-    if (sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr) != SQLITE_OK) {
-        throw std::runtime_error("prepare failed for delete keyframe");
+KeyframeCursor SqliteStorage::keyframeCursor(std::vector<std::string> tracks, int t0_ms, int t1_ms,
+                                             std::string channel) const {
+    return KeyframeCursor(db_, std::move(tracks), t0_ms, t1_ms, std::move(channel));
+}
+
+void SqliteStorage::insertKeyframe(const KeyId& key_id,
+                                   std::string_view track_id,
+                                   int t_ms,
+                                   std::string_view value_json,
+                                   std::string_view interp) {
+    const KeyIdText id = key_id.text();
+    StmtScope scope {cached(kStmtInsertKeyframe)};
+    bind_text(scope.stmt, 1, id);
+    bind_text(scope.stmt, 2, track_id);
+    sqlite3_bind_int(scope.stmt, 3, t_ms);
+    bind_text(scope.stmt, 4, value_json);
+    bind_text(scope.stmt, 5, interp);
+    if (sqlite3_step(scope.stmt) != SQLITE_DONE) throw std::runtime_error("insert keyframe failed");
+    if (scene_) scene_->insert(id, track_id, t_ms, value_json, interp);
+}
+
+void SqliteStorage::deleteKeyframe(const KeyId& key_id) {
+    const KeyIdText id = key_id.text();
+    StmtScope scope {cached(kStmtDeleteKeyframe)};
+    bind_text(scope.stmt, 1, id);
+    if (sqlite3_step(scope.stmt) != SQLITE_DONE) throw std::runtime_error("delete keyframe failed");
+    if (scene_) scene_->erase(id);
+}
+
+void SqliteStorage::updateKeyframeTime(const KeyId& key_id, int t_ms) {
+    const KeyIdText id = key_id.text();
+    StmtScope scope {cached(kStmtUpdateKeyframeTime)};
+    sqlite3_bind_int(scope.stmt, 1, t_ms);
+    bind_text(scope.stmt, 2, id);
+    if (sqlite3_step(scope.stmt) != SQLITE_DONE) throw std::runtime_error("update keyframe failed");
+    if (scene_) scene_->setTime(id, t_ms);
+}
+
+void SqliteStorage::ensureStaging() {
+    if (staging_ready_) return;
+    // TEMP tables live in the connection's temp schema; writes join the caller's transaction
+    exec_or_throw(db_, "CREATE TEMP TABLE IF NOT EXISTS verity_stage_ids(id TEXT PRIMARY KEY) WITHOUT ROWID;");
+    exec_or_throw(db_, "CREATE TEMP TABLE IF NOT EXISTS verity_stage_rows(id TEXT, track_id TEXT, t_ms INTEGER,"
+                       " value_json TEXT, interp TEXT);");
+    staging_ready_ = true;
+}
+
+void SqliteStorage::stageIds(const KeyIdList& ids) {
+    ensureStaging();
+    runCached(kStmtClearStagedIds, "clear staged ids failed");
+    StmtScope scope {cached(kStmtStageId)};
+    for (size_t i = 0; i < ids.size(); ++i) {
+        const KeyIdText id = ids[i].text();
+        bind_text(scope.stmt, 1, id);
+        if (sqlite3_step(scope.stmt) != SQLITE_DONE) throw std::runtime_error("stage key id failed");
+        sqlite3_reset(scope.stmt);
     }
-    sqlite3_bind_text(stmt, 1, key_id.c_str(), -1, SQLITE_TRANSIENT);
-    if (sqlite3_step(stmt) != SQLITE_DONE) {
-        sqlite3_finalize(stmt);
-        throw std::runtime_error("delete keyframe failed");
+}
+
+void SqliteStorage::insertKeyframes(const KeyframeBatch& rows) {
+    if (rows.empty()) return;
+    ensureStaging();
+    runCached(kStmtClearStagedRows, "clear staged rows failed");
+    {
+        StmtScope scope {cached(kStmtStageRow)};
+        for (size_t i = 0; i < rows.size(); ++i) {
+            const KeyIdText id = rows.id(i).text();
+            bind_text(scope.stmt, 1, id);
+            bind_text(scope.stmt, 2, rows.trackId(i));
+            sqlite3_bind_int(scope.stmt, 3, rows.tMs(i));
+            bind_text(scope.stmt, 4, rows.valueJson(i));
+            bind_text(scope.stmt, 5, rows.interp(i));
+            if (sqlite3_step(scope.stmt) != SQLITE_DONE) throw std::runtime_error("stage keyframe failed");
+            sqlite3_reset(scope.stmt);
+        }
+    }
+    runCached(kStmtInsertStagedRows, "bulk insert keyframes failed");
+    runCached(kStmtClearStagedRows, "clear staged rows failed");
+    if (scene_) {
+        for (size_t i = 0; i < rows.size(); ++i) {
+            scene_->insert(rows.id(i).text(), rows.trackId(i), rows.tMs(i), rows.valueJson(i), rows.interp(i));
+        }
     }
-    sqlite3_finalize(stmt);
 }
 
-void SqliteStorage::updateKeyframeTime(const std::string& key_id, int t_ms) {
-    sqlite3_stmt* stmt = nullptr;
-    const char* sql = "UPDATE keyframes SET t_ms = ?, updated_at = CAST(strftime('%s','now') AS INTEGER) WHERE id = ?";
-    if (sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr) != SQLITE_OK) {
-        throw std::runtime_error("prepare failed for update keyframe time");
+void SqliteStorage::shiftKeyframes(const KeyIdList& ids, int delta_ms) {
+    if (ids.empty()) return;
+    stageIds(ids);
+    {
+        StmtScope scope {cached(kStmtShiftStaged)};
+        sqlite3_bind_int(scope.stmt, 1, delta_ms);
+        if (sqlite3_step(scope.stmt) != SQLITE_DONE) throw std::runtime_error("bulk move keyframes failed");
     }
-    sqlite3_bind_int(stmt, 1, t_ms);
-    sqlite3_bind_text(stmt, 2, key_id.c_str(), -1, SQLITE_TRANSIENT);
-    if (sqlite3_step(stmt) != SQLITE_DONE) {
-        sqlite3_finalize(stmt);
-        throw std::runtime_error("update keyframe failed");
+    runCached(kStmtClearStagedIds, "clear staged ids failed");
+    if (scene_) {
+        for (size_t i = 0; i < ids.size(); ++i) {
+            const KeyIdText id = ids[i].text();
+            if (auto k = scene_->find(id)) scene_->setTime(id, k->t_ms + delta_ms);
+        }
     }
-    sqlite3_finalize(stmt);
+}
+
+KeyframeBatch SqliteStorage::deleteKeyframes(const KeyIdList& ids) {
+    KeyframeBatch removed;
+    if (ids.empty()) return removed;
+    stageIds(ids);
+    {
+        StmtScope scope {cached(kStmtSelectStaged)};
+        removed.reserve(ids.size());
+        int rc;
+        while ((rc = sqlite3_step(scope.stmt)) == SQLITE_ROW) {
+            removed.add(column_text(scope.stmt, 0), column_text(scope.stmt, 1), sqlite3_column_int(scope.stmt, 2),
+                        column_text(scope.stmt, 3), column_text(scope.stmt, 4));
+        }
+        if (rc != SQLITE_DONE) throw std::runtime_error("read keyframes for delete failed");
+    }
+    runCached(kStmtDeleteStaged, "bulk delete keyframes failed");
+    runCached(kStmtClearStagedIds, "clear staged ids failed");
+    if (scene_) {
+        for (size_t i = 0; i < removed.size(); ++i) scene_->erase(removed.id(i).text());
+    }
+    return removed;
+}
+
+// ---- Checkpoints ----
+
+void SqliteStorage::ensureCheckpointTables() {
+    if (checkpoints_ready_) return;
+    exec_or_throw(db_, kCheckpointSchema);
+    checkpoints_ready_ = true;
+}
+
+int64_t SqliteStorage::createCheckpoint() {
+    if (sqlite3_get_autocommit(db_) == 0) throw std::logic_error("createCheckpoint inside an open transaction");
+    ensureCheckpointTables();
+    begin();
+    try {
+        {
+            OwnedStmt st(db_, "INSERT INTO revision_checkpoints(revision_id, key_count, created_at)"
+                              " VALUES((SELECT COALESCE(MAX(id), 0) FROM revisions), (SELECT COUNT(*) FROM keyframes),"
+                              " CAST(strftime('%s','now') AS INTEGER))");
+            if (sqlite3_step(st.stmt) != SQLITE_DONE) throw std::runtime_error("insert checkpoint failed");
+        }
+        const int64_t id = sqlite3_last_insert_rowid(db_);
+        {
+            OwnedStmt st(db_, "INSERT INTO checkpoint_keyframes(checkpoint_id, id, track_id, t_ms, value_json, interp)"
+                              " SELECT ?, id, track_id, t_ms, value_json, interp FROM keyframes");
+            sqlite3_bind_int64(st.stmt, 1, id);
+            if (sqlite3_step(st.stmt) != SQLITE_DONE) throw std::runtime_error("copy checkpoint keyframes failed");
+        }
+        commit();
+        return id;
+    } catch (...) {
+        rollback();
+        throw;
+    }
+}
+
+std::optional<CheckpointInfo> SqliteStorage::latestCheckpoint() const {
+    sqlite3_stmt* st = nullptr;
+    const char* sql = "SELECT id, revision_id, key_count, created_at FROM revision_checkpoints ORDER BY id DESC LIMIT 1";
+    if (sqlite3_prepare_v2(db_, sql, -1, &st, nullptr) != SQLITE_OK) return std::nullopt; // pre-V0002 project
+    std::optional<CheckpointInfo> out;
+    if (sqlite3_step(st) == SQLITE_ROW) {
+        out = CheckpointInfo {sqlite3_column_int64(st, 0), sqlite3_column_int64(st, 1), sqlite3_column_int64(st, 2),
+                              sqlite3_column_int64(st, 3)};
+    }
+    sqlite3_finalize(st);
+    return out;
+}
+
+void SqliteStorage::loadCheckpoint(int64_t checkpoint_id) {
+    {
+        OwnedStmt st(db_, "INSERT INTO keyframes(id, track_id, t_ms, value_json, interp, created_at, updated_at)"
+                          " SELECT id, track_id, t_ms, value_json, interp, CAST(strftime('%s','now') AS INTEGER),"
+                          " CAST(strftime('%s','now') AS INTEGER) FROM checkpoint_keyframes WHERE checkpoint_id = ?");
+        sqlite3_bind_int64(st.stmt, 1, checkpoint_id);
+        if (sqlite3_step(st.stmt) != SQLITE_DONE) {
+            throw std::runtime_error(std::string("load checkpoint failed: ") + sqlite3_errmsg(db_));
+        }
+    }
+    if (!scene_) return;
+    OwnedStmt st(db_, "SELECT id, track_id, t_ms, value_json, interp FROM checkpoint_keyframes"
+                      " WHERE checkpoint_id = ? ORDER BY track_id, t_ms");
+    sqlite3_bind_int64(st.stmt, 1, checkpoint_id);
+    while (sqlite3_step(st.stmt) == SQLITE_ROW) {
+        scene_->insert(column_text(st.stmt, 0), column_text(st.stmt, 1), sqlite3_column_int(st.stmt, 2),
+                       column_text(st.stmt, 3), column_text(st.stmt, 4));
+    }
+}
+
+size_t SqliteStorage::compactRevisions(int64_t checkpoint_id) {
+    if (sqlite3_get_autocommit(db_) == 0) throw std::logic_error("compactRevisions inside an open transaction");
+    ensureCheckpointTables();
+    begin();
+    try {
+        int64_t through = -1;
+        {
+            OwnedStmt st(db_, "SELECT revision_id FROM revision_checkpoints WHERE id = ?");
+            sqlite3_bind_int64(st.stmt, 1, checkpoint_id);
+            if (sqlite3_step(st.stmt) == SQLITE_ROW) through = sqlite3_column_int64(st.stmt, 0);
+        }
+        if (through < 0) throw std::runtime_error("unknown checkpoint");
+        size_t removed = 0;
+        {
+            OwnedStmt st(db_, "DELETE FROM revisions WHERE id <= ?");
+            sqlite3_bind_int64(st.stmt, 1, through);
+            if (sqlite3_step(st.stmt) != SQLITE_DONE) throw std::runtime_error("compact revisions failed");
+            removed = size_t(sqlite3_changes(db_));
+        }
+        if (removed > 0) {
+            // The summary keeps the squashed range's last id so later revisions stay ordered after it
+            const std::string diff = "{\"op\":\"checkpoint\",\"checkpoint_id\":" + std::to_string(checkpoint_id) +
+                                     ",\"through\":" + std::to_string(through) + "}";
+            OwnedStmt st(db_, "INSERT INTO revisions(id, project_id, user, label, diff_json, created_at)"
+                              " VALUES(?, (SELECT id FROM projects LIMIT 1), 'local', 'Checkpoint', ?,"
+                              " CAST(strftime('%s','now') AS INTEGER))");
+            sqlite3_bind_int64(st.stmt, 1, through);
+            bind_text(st.stmt, 2, diff);
+            if (sqlite3_step(st.stmt) != SQLITE_DONE) throw std::runtime_error("insert checkpoint revision failed");
+        }
+        {
+            OwnedStmt st(db_, "DELETE FROM checkpoint_keyframes WHERE checkpoint_id < ?");
+            sqlite3_bind_int64(st.stmt, 1, checkpoint_id);
+            if (sqlite3_step(st.stmt) != SQLITE_DONE) throw std::runtime_error("drop old checkpoints failed");
+        }
+        {
+            OwnedStmt st(db_, "DELETE FROM revision_checkpoints WHERE id < ?");
+            sqlite3_bind_int64(st.stmt, 1, checkpoint_id);
+            if (sqlite3_step(st.stmt) != SQLITE_DONE) throw std::runtime_error("drop old checkpoints failed");
+        }
+        commit();
+        return removed;
+    } catch (...) {
+        rollback();
+        throw;
+    }
+}
+
+// ---- Engine snapshot token ----
+
+void SqliteStorage::ensureEngineSnapshotTable() {
+    if (engine_snapshot_ready_) return;
+    exec_or_throw(db_, kEngineSnapshotSchema);
+    engine_snapshot_ready_ = true;
+}
+
+void SqliteStorage::setEngineSnapshotToken(int64_t token) {
+    ensureEngineSnapshotTable();
+    exec_or_throw(db_, "DELETE FROM engine_snapshot_token");
+    OwnedStmt insert(db_, "INSERT INTO engine_snapshot_token(token) VALUES(?)");
+    sqlite3_bind_int64(insert.stmt, 1, token);
+    if (sqlite3_step(insert.stmt) != SQLITE_DONE) {
+        throw std::runtime_error(std::string("engine snapshot token failed: ") + sqlite3_errmsg(db_));
+    }
+}
+
+std::optional<int64_t> SqliteStorage::engineSnapshotToken() const {
+    sqlite3_stmt* st = nullptr;
+    if (sqlite3_prepare_v2(db_, "SELECT token FROM engine_snapshot_token LIMIT 1", -1, &st, nullptr) != SQLITE_OK) {
+        return std::nullopt; // pre-V0005 project
+    }
+    std::optional<int64_t> token;
+    if (sqlite3_step(st) == SQLITE_ROW) token = sqlite3_column_int64(st, 0);
+    sqlite3_finalize(st);
+    return token;
+}
+
+// ---- Columnar track chunks ----
+
+void SqliteStorage::ensureTrackChunkTables() {
+    if (track_chunks_ready_) return;
+    exec_or_throw(db_, kTrackChunkSchema);
+    track_chunks_ready_ = true;
+}
+
+std::string SqliteStorage::trackChunkLayout() const {
+    sqlite3_stmt* st = nullptr;
+    if (sqlite3_prepare_v2(db_, "SELECT layout FROM track_chunks LIMIT 1", -1, &st, nullptr) != SQLITE_OK) {
+        return {}; // pre-V0004 project
+    }
+    std::string layout;
+    if (sqlite3_step(st) == SQLITE_ROW) layout = column_text(st, 0);
+    sqlite3_finalize(st);
+    return layout;
+}
+
+size_t SqliteStorage::packTrackChunks(const TrackPackOptions& options) {
+    if (sqlite3_get_autocommit(db_) == 0) throw std::logic_error("packTrackChunks inside an open transaction");
+    ensureTrackChunkTables();
+    const std::string layout = pack_layout(options);
+    const size_t chunk_keys = options.chunk_keys ? options.chunk_keys : 4096;
+    begin();
+    try {
+        // Stale tracks only while the layout matches; otherwise start over with every track
+        const bool full = trackChunkLayout() != layout;
+        if (full) exec_or_throw(db_, "DELETE FROM track_chunks");
+        std::vector<std::string> tracks;
+        {
+            OwnedStmt st(db_, full ? "SELECT DISTINCT track_id FROM keyframes ORDER BY track_id"
+                                   : "SELECT track_id FROM track_chunks_stale ORDER BY track_id");
+            while (sqlite3_step(st.stmt) == SQLITE_ROW) tracks.emplace_back(column_text(st.stmt, 0));
+        }
+        OwnedStmt rows(db_, "SELECT t_ms, value_json, interp FROM keyframes WHERE track_id = ? ORDER BY t_ms");
+        OwnedStmt insert(db_, "INSERT INTO track_chunks(track_id, seq, t0_ms, t1_ms, key_count, layout, data)"
+                              " VALUES(?,?,?,?,?,?,?)");
+        std::vector<int> t_ms;
+        std::vector<Key> keys;
+        std::string interp, blob;
+        size_t malformed = 0;
+        int64_t seq = 0;
+        auto write_chunk = [&](const std::string& track) {
+            if (keys.empty()) return;
+            blob.clear();
+            encode_track_chunk(t_ms.data(), keys.data(), keys.size(), malformed, interp, blob);
+            StmtScope scope {insert.stmt};
+            bind_text(insert.stmt, 1, track);
+            sqlite3_bind_int64(insert.stmt, 2, seq++);
+            sqlite3_bind_int(insert.stmt, 3, t_ms.front());
+            sqlite3_bind_int(insert.stmt, 4, t_ms.back());
+            sqlite3_bind_int64(insert.stmt, 5, static_cast<sqlite3_int64>(keys.size()));
+            bind_text(insert.stmt, 6, layout);
+            sqlite3_bind_blob(insert.stmt, 7, blob.data(), static_cast<int>(blob.size()), SQLITE_STATIC);
+            if (sqlite3_step(insert.stmt) != SQLITE_DONE) {
+                throw std::runtime_error(std::string("insert track chunk failed: ") + sqlite3_errmsg(db_));
+            }
+            t_ms.clear();
+            keys.clear();
+            malformed = 0;
+        };
+        for (const std::string& track : tracks) {
+            {
+                OwnedStmt drop(db_, "DELETE FROM track_chunks WHERE track_id = ?");
+                bind_text(drop.stmt, 1, track);
+                if (sqlite3_step(drop.stmt) != SQLITE_DONE) throw std::runtime_error("drop track chunks failed");
+            }
+            seq = 0;
+            StmtScope scope {rows.stmt};
+            bind_text(rows.stmt, 1, track);
+            while (sqlite3_step(rows.stmt) == SQLITE_ROW) {
+                if (keys.empty()) interp = column_text(rows.stmt, 2);
+                const int t = sqlite3_column_int(rows.stmt, 0);
+                Key k {float(t), 0.f, 0.f, 0.f};
+                bool has_value = false;
+                const bool ok = scan_numeric_fields(column_text(rows.stmt, 1), [&](std::string_view name, double v) {
+                    if (name == options.channel) {
+                        k.value = float(v);
+                        has_value = true;
+                    } else if (name == options.in_tangent) {
+                        k.inTan = float(v);
+                    } else if (name == options.out_tangent) {
+                        k.outTan = float(v);
+                    }
+                });
+                if (!ok || !has_value) ++malformed;
+                t_ms.push_back(t);
+                keys.push_back(k);
+                if (keys.size() == chunk_keys) write_chunk(track);
+            }
+            write_chunk(track);
+        }
+        exec_or_throw(db_, "DELETE FROM track_chunks_stale");
+        commit();
+        return tracks.size();
+    } catch (...) {
+        rollback();
+        throw;
+    }
+}
+
+void SqliteStorage::scanTrackChunks(const std::function<void(const TrackChunkView&)>& fn) const {
+    sqlite3_stmt* st = nullptr;
+    const char* sql = "SELECT track_id, t0_ms, t1_ms, key_count, data FROM track_chunks ORDER BY track_id, seq";
+    if (sqlite3_prepare_v2(db_, sql, -1, &st, nullptr) != SQLITE_OK) return; // pre-V0004 project
+    int rc = SQLITE_OK;
+    try {
+        while ((rc = sqlite3_step(st)) == SQLITE_ROW) {
+            TrackChunkView chunk;
+            chunk.track_id = column_text(st, 0);
+            chunk.t0_ms = sqlite3_column_int(st, 1);
+            chunk.t1_ms = sqlite3_column_int(st, 2);
+            chunk.key_count = static_cast<size_t>(sqlite3_column_int64(st, 3));
+            const void* data = sqlite3_column_blob(st, 4);
+            chunk.data = std::string_view(static_cast<const char*>(data), static_cast<size_t>(sqlite3_column_bytes(st, 4)));
+            fn(chunk);
+        }
+    } catch (...) {
+        sqlite3_finalize(st);
+        throw;
+    }
+    sqlite3_finalize(st);
+    if (rc != SQLITE_DONE) throw std::runtime_error("scan track chunks failed");
+}
+
+std::vector<std::string> SqliteStorage::staleTracks() const {
+    std::vector<std::string> out;
+    sqlite3_stmt* st = nullptr;
+    if (sqlite3_prepare_v2(db_, "SELECT track_id FROM track_chunks_stale ORDER BY track_id", -1, &st, nullptr) !=
+        SQLITE_OK) {
+        return out;
+    }
+    while (sqlite3_step(st) == SQLITE_ROW) out.emplace_back(column_text(st, 0));
+    sqlite3_finalize(st);
+    return out;
+}
+
+void SqliteStorage::scanTrackKeyframes(std::string_view track_id,
+                                       const std::function<void(const KeyframeRowView&)>& fn) const {
+    OwnedStmt st(db_, "SELECT id, track_id, t_ms, value_json, interp FROM keyframes WHERE track_id = ? ORDER BY t_ms");
+    bind_text(st.stmt, 1, track_id);
+    int rc = SQLITE_OK;
+    while ((rc = sqlite3_step(st.stmt)) == SQLITE_ROW) {
+        KeyframeRowView row;
+        row.id = column_text(st.stmt, 0);
+        row.track_id = column_text(st.stmt, 1);
+        row.t_ms = sqlite3_column_int(st.stmt, 2);
+        row.value_json = column_text(st.stmt, 3);
+        row.interp = column_text(st.stmt, 4);
+        fn(row);
+    }
+    if (rc != SQLITE_DONE) throw std::runtime_error("scan track keyframes failed");
 }
 
 } // namespace verity
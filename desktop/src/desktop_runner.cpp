@@ -7,6 +7,10 @@
 #include "verity/db.hpp"
 #include "verity/replay.hpp"
 #include "verity/autosave.hpp"
+#if VERITY_DESKTOP_SQLITE
+#include "verity/checkpoint.hpp"
+#include "verity/write_behind.hpp"
+#endif
 
 using namespace verity;
 
@@ -23,10 +27,25 @@ int main(int argc, char** argv) {
     std::optional<verity::AutosaveScheduler> autosaver;
     if (auto db = get_arg(argc, argv, "--db")) {
 #if VERITY_DESKTOP_SQLITE
-        storage = std::make_unique<verity::SqliteStorage>(*db);
+        // --write-behind 1: apply edits in memory and persist on a background writer thread
+        verity::WriteBehindStorage* write_behind = nullptr;
+        if (get_arg(argc, argv, "--write-behind").value_or("0") != "0") {
+            // Restore and checkpoints need the SqliteStorage itself, which the writer thread owns
+            if (get_arg(argc, argv, "--restore").has_value() ||
+                get_arg(argc, argv, "--checkpoint").value_or("0") != "0") {
+                std::cerr << "--write-behind cannot be combined with --restore or --checkpoint\n";
+                return 2;
+            }
+            auto wb = std::make_unique<verity::WriteBehindStorage>(*db);
+            write_behind = wb.get();
+            storage = std::move(wb);
+        } else {
+            storage = std::make_unique<verity::SqliteStorage>(*db);
+        }
         // If a project directory is provided via --proj, start autosave
         if (auto proj = get_arg(argc, argv, "--proj")) {
             autosaver.emplace(*proj, std::chrono::seconds(60));
+            if (write_behind) autosaver->setBeforeSnapshot([write_behind] { write_behind->flush(); });
             autosaver->start();
         }
 #else
@@ -42,10 +61,12 @@ int main(int argc, char** argv) {
 #if VERITY_DESKTOP_SQLITE
     if (get_arg(argc, argv, "--restore").has_value()) {
         if (auto* sql = dynamic_cast<verity::SqliteStorage*>(storage.get())) {
-            auto revs = sql->readRevisions();
-            // Replay into stack to reconstruct state and undo history
-            restore_from_revisions(stack, *storage, revs);
-            std::cout << "Restored from revisions: " << revs.size() << " entries\n";
+            // Latest checkpoint plus the revisions after it, in one transaction (the log is not rewritten)
+            const ReplayResult replayed = restore_latest(stack, *sql);
+            std::cout << "Restored from revisions: " << replayed.revisions << " entries";
+            if (replayed.checkpoint_id) std::cout << " after checkpoint " << replayed.checkpoint_id;
+            if (replayed.skipped) std::cout << " (" << replayed.skipped << " skipped)";
+            std::cout << "\n";
         }
     }
 #endif
@@ -65,6 +86,17 @@ int main(int argc, char** argv) {
         stack.redo();
         std::cout << "Redo\n";
     }
+
+#if VERITY_DESKTOP_SQLITE
+    // --checkpoint 1 [--compact 1]: checkpoint the project (and squash the log up to it) on exit
+    if (get_arg(argc, argv, "--checkpoint").value_or("0") != "0") {
+        if (auto* sql = dynamic_cast<verity::SqliteStorage*>(storage.get())) {
+            CheckpointScheduler checkpoints(stack, *sql, 0, std::chrono::seconds(0),
+                                            get_arg(argc, argv, "--compact").value_or("0") != "0");
+            std::cout << "Checkpoint " << checkpoints.checkpointNow() << "\n";
+        }
+    }
+#endif
     if (autosaver.has_value()) autosaver->stop();
     return 0;
 }
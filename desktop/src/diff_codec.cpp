@@ -0,0 +1,221 @@
+#include "verity/diff_codec.hpp"
+#include <functional>
+
+namespace verity {
+
+namespace {
+
+constexpr size_t kUuidLen = 36;
+
+} // namespace
+
+void DiffWriter::reset() {
+    body_.clear();
+    out_.clear();
+    strings_.clear();
+    index_.clear();
+}
+
+void DiffWriter::putVarint(std::string& out, uint64_t v) {
+    while (v >= 0x80) {
+        out.push_back(static_cast<char>((v & 0x7F) | 0x80));
+        v >>= 7;
+    }
+    out.push_back(static_cast<char>(v));
+}
+
+void DiffWriter::ref(std::string_view s) {
+    KeyId k;
+    if (KeyId::parseUuid(s, k)) {
+        entry(Entry {k, {}});
+        return;
+    }
+    entry(Entry {KeyId(), s});
+}
+
+void DiffWriter::id(const KeyId& k) {
+    // Interned text lives for the process, so its view outlives the writer
+    if (k.isUuid()) entry(Entry {k, {}});
+    else entry(Entry {KeyId(), k.text().view()});
+}
+
+size_t DiffWriter::hashOf(const Entry& e) {
+    return e.id.isUuid() ? KeyIdHash {}(e.id) : std::hash<std::string_view> {}(e.text);
+}
+
+bool DiffWriter::same(const Entry& a, const Entry& b) {
+    return a.id.isUuid() ? a.id == b.id : !b.id.isUuid() && a.text == b.text;
+}
+
+// assign() reuses the vector's capacity, so after the largest diff seen this never allocates
+void DiffWriter::rebuildIndex(size_t slots) {
+    index_.assign(slots, 0);
+    const size_t mask = slots - 1;
+    for (size_t n = 0; n < strings_.size(); ++n) {
+        size_t i = hashOf(strings_[n]) & mask;
+        while (index_[i]) i = (i + 1) & mask;
+        index_[i] = static_cast<uint32_t>(n + 1);
+    }
+}
+
+void DiffWriter::entry(const Entry& e) {
+    // Single-key edits reference a handful of strings: a scan beats hashing until the table grows
+    if (strings_.size() <= kScanRefs) {
+        for (size_t i = 0; i < strings_.size(); ++i) {
+            if (same(e, strings_[i])) {
+                u(i);
+                return;
+            }
+        }
+        strings_.push_back(e);
+        if (strings_.size() > kScanRefs) rebuildIndex(64);
+        u(strings_.size() - 1);
+        return;
+    }
+    if ((strings_.size() + 1) * 2 > index_.size()) rebuildIndex(index_.size() * 2); // load <= 1/2
+    const size_t mask = index_.size() - 1;
+    for (size_t i = hashOf(e) & mask;; i = (i + 1) & mask) {
+        const uint32_t at = index_[i];
+        if (!at) {
+            strings_.push_back(e);
+            index_[i] = static_cast<uint32_t>(strings_.size());
+            u(strings_.size() - 1);
+            return;
+        }
+        if (same(e, strings_[at - 1])) {
+            u(at - 1);
+            return;
+        }
+    }
+}
+
+void DiffWriter::bytes(std::string_view s) {
+    u(s.size());
+    body_.append(s.data(), s.size());
+}
+
+std::string_view DiffWriter::finish() {
+    out_.clear();
+    out_.push_back(static_cast<char>(diffcodec::kMagic));
+    out_.push_back(static_cast<char>(diffcodec::kVersion));
+    putVarint(out_, strings_.size());
+    // Entry header: length << 1 for text, 1 for a UUID packed into 16 bytes
+    for (const Entry& e : strings_) {
+        if (!e.id.isUuid()) {
+            putVarint(out_, uint64_t(e.text.size()) << 1);
+            out_.append(e.text.data(), e.text.size());
+            continue;
+        }
+        unsigned char raw[16];
+        e.id.toBytes(raw);
+        putVarint(out_, 1);
+        out_.append(reinterpret_cast<const char*>(raw), sizeof(raw));
+    }
+    out_.append(body_);
+    return out_;
+}
+
+DiffReader::DiffReader(std::string_view blob) : p_(blob.data()), end_(blob.data() + blob.size()) {
+    if (!is_diff_blob(blob)) {
+        ok_ = false;
+        return;
+    }
+    p_ += 2;
+    const uint64_t count = u();
+    if (count > remaining()) { // every entry takes at least one byte
+        ok_ = false;
+        return;
+    }
+    strings_.reserve(count);
+    for (uint64_t n = 0; n < count && ok_; ++n) {
+        const uint64_t h = u();
+        if (h == 1) {
+            if (remaining() < 16) {
+                ok_ = false;
+                break;
+            }
+            Entry e;
+            e.id = KeyId::fromBytes(reinterpret_cast<const unsigned char*>(p_));
+            e.packed = e.has_id = true;
+            p_ += 16;
+            strings_.push_back(e);
+            ++packed_;
+        } else if ((h & 1) == 0 && (h >> 1) <= remaining()) {
+            Entry e;
+            e.text = std::string_view(p_, size_t(h >> 1));
+            strings_.push_back(e);
+            p_ += h >> 1;
+        } else {
+            ok_ = false;
+        }
+    }
+}
+
+uint8_t DiffReader::op() {
+    if (p_ == end_) {
+        ok_ = false;
+        return 0;
+    }
+    return static_cast<uint8_t>(*p_++);
+}
+
+uint64_t DiffReader::u() {
+    uint64_t v = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (p_ == end_) break;
+        const auto b = static_cast<uint8_t>(*p_++);
+        v |= uint64_t(b & 0x7F) << shift;
+        if (!(b & 0x80)) return v;
+    }
+    ok_ = false;
+    return 0;
+}
+
+DiffReader::Entry* DiffReader::entry() {
+    const uint64_t idx = u();
+    if (idx >= strings_.size()) {
+        ok_ = false;
+        return nullptr;
+    }
+    return &strings_[idx];
+}
+
+std::string_view DiffReader::ref() {
+    Entry* e = entry();
+    if (!e) return {};
+    if (e->packed && e->text.empty()) {
+        if (uuids_.capacity() < packed_ * kUuidLen) uuids_.reserve(packed_ * kUuidLen);
+        const size_t start = uuids_.size();
+        uuids_.append(e->id.text().view());
+        e->text = std::string_view(uuids_.data() + start, kUuidLen);
+    }
+    return e->text;
+}
+
+KeyId DiffReader::id() {
+    Entry* e = entry();
+    if (!e) return KeyId();
+    if (!e->has_id) {
+        e->id = KeyId::fromText(e->text);
+        e->has_id = true;
+    }
+    return e->id;
+}
+
+std::string_view DiffReader::bytes() {
+    const uint64_t n = u();
+    if (n > remaining()) {
+        ok_ = false;
+        return {};
+    }
+    std::string_view s(p_, size_t(n));
+    p_ += n;
+    return s;
+}
+
+bool is_diff_blob(std::string_view blob) {
+    return blob.size() >= 2 && static_cast<uint8_t>(blob[0]) == diffcodec::kMagic &&
+           static_cast<uint8_t>(blob[1]) == diffcodec::kVersion;
+}
+
+} // namespace verity
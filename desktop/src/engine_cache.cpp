@@ -0,0 +1,27 @@
+#include "verity/engine_cache.hpp"
+#include "verity/engine.hpp"
+#include <filesystem>
+#include <random>
+
+namespace verity {
+
+std::string engineSnapshotPath(const SqliteStorage& storage) {
+    namespace fs = std::filesystem;
+    return (fs::path(storage.dbPath()).parent_path() / "engine.snap").string();
+}
+
+bool loadEngineSnapshot(const SqliteStorage& storage) {
+    const auto token = storage.engineSnapshotToken();
+    if (!token) return false; // a keyframe changed since the snapshot was written (or none was)
+    return loadSnapshot(engineSnapshotPath(storage), static_cast<uint64_t>(*token));
+}
+
+void saveEngineSnapshot(SqliteStorage& storage) {
+    // Fresh per save, so a snapshot file left over from an earlier save never matches
+    thread_local std::mt19937_64 rng {std::random_device {}()};
+    const uint64_t token = rng();
+    storage.setEngineSnapshotToken(static_cast<int64_t>(token));
+    saveSnapshot(engineSnapshotPath(storage), token);
+}
+
+} // namespace verity
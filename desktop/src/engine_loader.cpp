@@ -0,0 +1,235 @@
+#include "verity/engine_loader.hpp"
+#include "verity/engine.hpp"
+#include "verity/json_scan.hpp"
+#include "verity/track_blob.hpp"
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+namespace verity {
+
+namespace {
+
+// Minimal fixed-size pool; the first task exception is rethrown from wait().
+class TaskPool {
+public:
+    explicit TaskPool(unsigned threads) {
+        for (unsigned i = 0; i < threads; ++i) workers_.emplace_back([this] { run(); });
+    }
+    ~TaskPool() {
+        {
+            std::lock_guard<std::mutex> lock(mu_);
+            stopping_ = true;
+        }
+        cv_.notify_all();
+        for (auto& t : workers_) t.join();
+    }
+    TaskPool(const TaskPool&) = delete;
+    TaskPool& operator=(const TaskPool&) = delete;
+
+    void submit(std::function<void()> task) {
+        {
+            std::lock_guard<std::mutex> lock(mu_);
+            tasks_.push_back(std::move(task));
+            ++pending_;
+        }
+        cv_.notify_one();
+    }
+
+    void wait() {
+        std::unique_lock<std::mutex> lock(mu_);
+        idle_cv_.wait(lock, [this] { return pending_ == 0; });
+        if (error_) {
+            auto e = error_;
+            error_ = nullptr;
+            std::rethrow_exception(e);
+        }
+    }
+
+private:
+    void run() {
+        for (;;) {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(mu_);
+                cv_.wait(lock, [this] { return stopping_ || !tasks_.empty(); });
+                if (tasks_.empty()) return;
+                task = std::move(tasks_.front());
+                tasks_.pop_front();
+            }
+            std::exception_ptr err;
+            try {
+                task();
+            } catch (...) {
+                err = std::current_exception();
+            }
+            std::lock_guard<std::mutex> lock(mu_);
+            if (err && !error_) error_ = err;
+            if (--pending_ == 0) idle_cv_.notify_all();
+        }
+    }
+
+    std::mutex mu_;
+    std::condition_variable cv_;
+    std::condition_variable idle_cv_;
+    std::deque<std::function<void()>> tasks_;
+    std::vector<std::thread> workers_;
+    size_t pending_ {0};
+    bool stopping_ {false};
+    std::exception_ptr error_;
+};
+
+// Rows (or packed chunks) of one track, copied out of SQLite's column buffers into flat arrays.
+struct PendingTrack {
+    std::string track_id;
+    std::string interp; // first key decides the curve kind
+    bool packed {false};
+    std::vector<int> t_ms;
+    std::string values;              // concatenated value_json, or chunk blobs when packed
+    std::vector<uint32_t> value_end; // end offset of each row (chunk) in `values`
+    std::vector<Key> keys;
+    size_t malformed {0};
+};
+
+CurveKind kind_for_interp(const std::string& interp) {
+    if (interp == "bezier") return CurveKind::BezierCubic;
+    if (interp == "catmull" || interp == "catmullrom" || interp == "catmull_rom") return CurveKind::CatmullRom;
+    return CurveKind::Hermite;
+}
+
+void decode_track(PendingTrack& tr) {
+    uint32_t begin = 0;
+    for (size_t i = 0; i < tr.value_end.size(); ++i) {
+        const std::string_view blob(tr.values.data() + begin, tr.value_end[i] - begin);
+        begin = tr.value_end[i];
+        TrackChunkHeader header;
+        if (!decode_track_chunk(blob, tr.keys, &header)) throw std::runtime_error("corrupt track chunk: " + tr.track_id);
+        if (i == 0) tr.interp.assign(header.interp);
+        tr.malformed += header.malformed;
+    }
+    std::string().swap(tr.values);
+    std::vector<uint32_t>().swap(tr.value_end);
+}
+
+void parse_track(PendingTrack& tr, const EngineLoadOptions& options) {
+    if (tr.packed) return decode_track(tr);
+    const size_t n = tr.t_ms.size();
+    tr.keys.resize(n);
+    uint32_t begin = 0;
+    for (size_t i = 0; i < n; ++i) {
+        const std::string_view json(tr.values.data() + begin, tr.value_end[i] - begin);
+        begin = tr.value_end[i];
+        Key k {float(tr.t_ms[i]), 0.f, 0.f, 0.f};
+        bool has_value = false;
+        const bool ok = scan_numeric_fields(json, [&](std::string_view name, double v) {
+            if (name == options.channel) {
+                k.value = float(v);
+                has_value = true;
+            } else if (name == options.in_tangent) {
+                k.inTan = float(v);
+            } else if (name == options.out_tangent) {
+                k.outTan = float(v);
+            }
+        });
+        if (!ok || !has_value) ++tr.malformed;
+        tr.keys[i] = k;
+    }
+    // Raw rows are no longer needed once keys exist
+    std::string().swap(tr.values);
+    std::vector<uint32_t>().swap(tr.value_end);
+    std::vector<int>().swap(tr.t_ms);
+}
+
+} // namespace
+
+EngineLoadResult load_engine_curves(const SqliteStorage& storage, const EngineLoadOptions& options) {
+    const auto start = std::chrono::steady_clock::now();
+    EngineLoadResult result;
+    std::vector<std::unique_ptr<PendingTrack>> tracks; // outlives the pool's in-flight tasks
+    unsigned threads = options.threads ? options.threads : std::thread::hardware_concurrency();
+    TaskPool pool(std::max(1u, threads));
+    PendingTrack* current = nullptr;
+    auto flush = [&] {
+        if (!current) return;
+        PendingTrack* tr = current;
+        pool.submit([tr, &options] { parse_track(*tr, options); });
+        current = nullptr;
+    };
+
+    auto add_row = [&](const KeyframeRowView& row) {
+        if (!current || row.track_id != current->track_id) {
+            flush();
+            tracks.push_back(std::make_unique<PendingTrack>());
+            current = tracks.back().get();
+            current->track_id.assign(row.track_id);
+            current->interp.assign(row.interp);
+        }
+        current->t_ms.push_back(row.t_ms);
+        current->values.append(row.value_json);
+        current->value_end.push_back(static_cast<uint32_t>(current->values.size()));
+        ++result.rows;
+    };
+
+    const std::string layout = options.channel + "," + options.in_tangent + "," + options.out_tangent;
+    if (options.use_track_chunks && storage.trackChunkLayout() == layout) {
+        // Packed tracks arrive as a few large blobs each; tracks edited since packing come from rows
+        storage.scanTrackChunks([&](const TrackChunkView& chunk) {
+            if (!current || chunk.track_id != current->track_id) {
+                flush();
+                tracks.push_back(std::make_unique<PendingTrack>());
+                current = tracks.back().get();
+                current->track_id.assign(chunk.track_id);
+                current->packed = true;
+            }
+            current->values.append(chunk.data);
+            current->value_end.push_back(static_cast<uint32_t>(current->values.size()));
+            result.rows += chunk.key_count;
+            ++result.packed_chunks;
+        });
+        flush();
+        for (const std::string& track : storage.staleTracks()) {
+            storage.scanTrackKeyframes(track, add_row);
+            flush();
+        }
+    } else {
+        storage.scanKeyframes(add_row);
+        flush();
+    }
+    pool.wait();
+    std::sort(tracks.begin(), tracks.end(), [](const auto& a, const auto& b) { return a->track_id < b->track_id; });
+
+    // Curve creation grows the engine's curve table, so it stays on this thread; filling the
+    // curves touches disjoint state and fans out to the pool.
+    for (auto& tr : tracks) {
+        result.malformed_rows += tr->malformed;
+        if (tr->keys.size() < 2) continue;
+        TrackCurve tc;
+        tc.track_id = tr->track_id;
+        tc.curve_id = createCurve(kind_for_interp(tr->interp));
+        tc.key_count = tr->keys.size();
+        result.curves.push_back(std::move(tc));
+    }
+    size_t ci = 0;
+    for (auto& tr : tracks) {
+        if (tr->keys.size() < 2) continue;
+        const int id = result.curves[ci++].curve_id;
+        PendingTrack* p = tr.get();
+        pool.submit([p, id, &options] {
+            if (options.constant_speed) setConstantSpeed(id, true);
+            setKeys(id, std::move(p->keys));
+        });
+    }
+    pool.wait();
+
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return result;
+}
+
+} // namespace verity
@@ -0,0 +1,48 @@
+#include "verity/history_spill.hpp"
+#include <filesystem>
+#include <stdexcept>
+
+namespace verity {
+
+HistorySpill::HistorySpill(std::string path) : path_(std::move(path)) {
+    file_.open(path_, std::ios::in | std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!file_) throw std::runtime_error("failed to open history spill file: " + path_);
+}
+
+HistorySpill::~HistorySpill() {
+    file_.close();
+    std::error_code ec;
+    std::filesystem::remove(path_, ec);
+}
+
+HistorySpill::Ref HistorySpill::write(std::string_view record) {
+    if (live_ == 0 && end_ > 0) {
+        // Nothing live: start over instead of growing the file for the whole session
+        file_.close();
+        file_.open(path_, std::ios::in | std::ios::out | std::ios::binary | std::ios::trunc);
+        end_ = 0;
+    }
+    file_.clear();
+    file_.seekp(static_cast<std::streamoff>(end_));
+    file_.write(record.data(), static_cast<std::streamsize>(record.size()));
+    if (!file_) throw std::runtime_error("history spill write failed: " + path_);
+    const Ref ref {end_, static_cast<uint32_t>(record.size())};
+    end_ += record.size();
+    ++live_;
+    return ref;
+}
+
+void HistorySpill::read(Ref ref, std::string& out) {
+    out.resize(ref.size);
+    file_.clear();
+    file_.seekg(static_cast<std::streamoff>(ref.offset));
+    file_.read(out.data(), static_cast<std::streamsize>(ref.size));
+    if (!file_) throw std::runtime_error("history spill read failed: " + path_);
+}
+
+void HistorySpill::release(Ref ref) {
+    (void)ref;
+    if (live_ > 0) --live_;
+}
+
+} // namespace verity
@@ -0,0 +1,140 @@
+#include "verity/key_id.hpp"
+#include <deque>
+#include <mutex>
+#include <random>
+#include <shared_mutex>
+#include <unordered_map>
+
+namespace verity {
+
+namespace {
+
+constexpr size_t kUuidLen = 36;
+constexpr char kHex[] = "0123456789abcdef";
+
+bool is_dash_pos(size_t i) { return i == 8 || i == 13 || i == 18 || i == 23; }
+
+int hex_value(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    return -1;
+}
+
+// Append-only: entries never move, so views handed out by text() stay valid for the process
+class InternTable {
+public:
+    uint64_t intern(std::string_view s) {
+        {
+            std::shared_lock lock(mutex_);
+            auto it = index_.find(s);
+            if (it != index_.end()) return it->second;
+        }
+        std::unique_lock lock(mutex_);
+        auto it = index_.find(s);
+        if (it != index_.end()) return it->second;
+        names_.emplace_back(s);
+        const uint64_t id = names_.size(); // 0 is the empty id
+        index_.emplace(names_.back(), id);
+        return id;
+    }
+
+    std::string_view name(uint64_t id) const {
+        std::shared_lock lock(mutex_);
+        return id && id <= names_.size() ? std::string_view(names_[id - 1]) : std::string_view();
+    }
+
+private:
+    mutable std::shared_mutex mutex_;
+    std::deque<std::string> names_;
+    std::unordered_map<std::string_view, uint64_t> index_;
+};
+
+void format_uuid(uint64_t hi, uint64_t lo, char* out) {
+    const uint64_t half[2] = {hi, lo};
+    int nibble = 0;
+    for (size_t i = 0; i < kUuidLen; ++i) {
+        if (is_dash_pos(i)) {
+            out[i] = '-';
+            continue;
+        }
+        out[i] = kHex[(half[nibble / 16] >> (60 - 4 * (nibble % 16))) & 0xf];
+        ++nibble;
+    }
+}
+
+InternTable& intern_table() {
+    static InternTable table;
+    return table;
+}
+
+} // namespace
+
+KeyId KeyId::generate() {
+    thread_local std::mt19937_64 rng = [] {
+        std::random_device rd;
+        std::seed_seq seq {rd(), rd(), rd(), rd()};
+        return std::mt19937_64(seq);
+    }();
+    uint64_t hi = rng();
+    uint64_t lo = rng();
+    hi = (hi & ~0xf000ull) | 0x4000ull;                         // version 4
+    lo = (lo & 0x3fffffffffffffffull) | 0x8000000000000000ull; // RFC 4122 variant
+    return KeyId(hi, lo);
+}
+
+bool KeyId::parseUuid(std::string_view text, KeyId& out) {
+    if (text.size() != kUuidLen) return false;
+    uint64_t half[2] = {0, 0};
+    int nibbles = 0;
+    for (size_t i = 0; i < kUuidLen; ++i) {
+        if (is_dash_pos(i)) {
+            if (text[i] != '-') return false;
+            continue;
+        }
+        const int v = hex_value(text[i]);
+        if (v < 0) return false;
+        uint64_t& h = half[nibbles++ / 16];
+        h = h << 4 | static_cast<uint64_t>(v);
+    }
+    // A zero high half is the interned range; such UUIDs are interned as text instead
+    if (half[0] == 0) return false;
+    out = KeyId(half[0], half[1]);
+    return true;
+}
+
+KeyId KeyId::fromText(std::string_view text) {
+    if (text.empty()) return KeyId();
+    KeyId id;
+    if (parseUuid(text, id)) return id;
+    return KeyId(0, intern_table().intern(text));
+}
+
+KeyId KeyId::fromBytes(const unsigned char* bytes) {
+    uint64_t hi = 0, lo = 0;
+    for (int i = 0; i < 8; ++i) hi = hi << 8 | bytes[i];
+    for (int i = 8; i < 16; ++i) lo = lo << 8 | bytes[i];
+    if (hi == 0) {
+        char text[kUuidLen];
+        format_uuid(hi, lo, text);
+        return KeyId(0, intern_table().intern(std::string_view(text, kUuidLen)));
+    }
+    return KeyId(hi, lo);
+}
+
+void KeyId::toBytes(unsigned char* out) const {
+    for (int i = 0; i < 8; ++i) out[i] = static_cast<unsigned char>(hi_ >> (56 - 8 * i));
+    for (int i = 0; i < 8; ++i) out[8 + i] = static_cast<unsigned char>(lo_ >> (56 - 8 * i));
+}
+
+KeyIdText KeyId::text() const {
+    KeyIdText t;
+    if (!isUuid()) {
+        t.interned_ = intern_table().name(lo_);
+        return t;
+    }
+    t.uuid_ = true;
+    format_uuid(hi_, lo_, t.buf_);
+    return t;
+}
+
+} // namespace verity
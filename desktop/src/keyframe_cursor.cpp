@@ -0,0 +1,84 @@
+#include "verity/keyframe_cursor.hpp"
+#include "verity/json_scan.hpp"
+#include <limits>
+#include <stdexcept>
+#include <string_view>
+#include <utility>
+
+namespace verity {
+
+KeyframeCursor::KeyframeCursor(sqlite3* db, std::vector<std::string> tracks, int t0_ms, int t1_ms, std::string channel)
+    : db_(db), tracks_(std::move(tracks)), t0_ms_(t0_ms), t1_ms_(t1_ms), channel_(std::move(channel)) {
+    const char* sql = "SELECT t_ms, value_json FROM keyframes WHERE track_id = ? AND t_ms BETWEEN ? AND ? ORDER BY t_ms";
+    if (sqlite3_prepare_v2(db_, sql, -1, &stmt_, nullptr) != SQLITE_OK) {
+        stmt_ = nullptr;
+        throw std::runtime_error(std::string("prepare failed for keyframe cursor: ") + sqlite3_errmsg(db_));
+    }
+}
+
+KeyframeCursor::~KeyframeCursor() { sqlite3_finalize(stmt_); }
+
+KeyframeCursor::KeyframeCursor(KeyframeCursor&& other) noexcept
+    : db_(other.db_), stmt_(std::exchange(other.stmt_, nullptr)), tracks_(std::move(other.tracks_)),
+      track_(other.track_), bound_(other.bound_), t0_ms_(other.t0_ms_), t1_ms_(other.t1_ms_),
+      channel_(std::move(other.channel_)), rows_(other.rows_), malformed_(other.malformed_) {}
+
+KeyframeCursor& KeyframeCursor::operator=(KeyframeCursor&& other) noexcept {
+    if (this != &other) {
+        sqlite3_finalize(stmt_);
+        db_ = other.db_;
+        stmt_ = std::exchange(other.stmt_, nullptr);
+        tracks_ = std::move(other.tracks_); // element buffers move with the vector, so bindings stay valid
+        track_ = other.track_;
+        bound_ = other.bound_;
+        t0_ms_ = other.t0_ms_;
+        t1_ms_ = other.t1_ms_;
+        channel_ = std::move(other.channel_);
+        rows_ = other.rows_;
+        malformed_ = other.malformed_;
+    }
+    return *this;
+}
+
+size_t KeyframeCursor::next(int* t_ms, double* values, uint32_t* track, size_t capacity) {
+    size_t n = 0;
+    while (n < capacity && !done()) {
+        if (!bound_) {
+            const std::string& id = tracks_[track_];
+            sqlite3_bind_text(stmt_, 1, id.data(), static_cast<int>(id.size()), SQLITE_STATIC);
+            sqlite3_bind_int(stmt_, 2, t0_ms_);
+            sqlite3_bind_int(stmt_, 3, t1_ms_);
+            bound_ = true;
+        }
+        const int rc = sqlite3_step(stmt_);
+        if (rc == SQLITE_DONE) {
+            sqlite3_reset(stmt_);
+            bound_ = false;
+            ++track_;
+            continue;
+        }
+        if (rc != SQLITE_ROW) {
+            sqlite3_reset(stmt_);
+            throw std::runtime_error(std::string("keyframe cursor step failed: ") + sqlite3_errmsg(db_));
+        }
+        const auto* json = reinterpret_cast<const char*>(sqlite3_column_text(stmt_, 1));
+        const std::string_view value_json(json ? json : "", json ? static_cast<size_t>(sqlite3_column_bytes(stmt_, 1)) : 0);
+        double v = std::numeric_limits<double>::quiet_NaN();
+        bool found = false;
+        const bool ok = scan_numeric_fields(value_json, [&](std::string_view name, double x) {
+            if (!found && name == channel_) {
+                v = x;
+                found = true;
+            }
+        });
+        if (!ok || !found) ++malformed_;
+        t_ms[n] = sqlite3_column_int(stmt_, 0);
+        values[n] = v;
+        track[n] = static_cast<uint32_t>(track_);
+        ++n;
+        ++rows_;
+    }
+    return n;
+}
+
+} // namespace verity
@@ -0,0 +1,143 @@
+#include "verity/net_effect_store.hpp"
+#include <map>
+#include <stdexcept>
+
+namespace verity {
+
+static IKeyframeStore& keyframe_store(IStorage& inner) {
+    auto* keys = dynamic_cast<IKeyframeStore*>(&inner);
+    if (!keys) throw std::invalid_argument("NetEffectStore needs a keyframe store");
+    return *keys;
+}
+
+NetEffectStore::NetEffectStore(IStorage& inner) : inner_(inner), keys_(keyframe_store(inner)) {}
+
+NetEffectStore::Net* NetEffectStore::find(const KeyId& id) {
+    auto it = net_.find(id);
+    return it == net_.end() ? nullptr : &it->second;
+}
+
+NetEffectStore::Net& NetEffectStore::add(const KeyId& id, Net::Kind kind, int t) {
+    order_.push_back(id);
+    Net& n = net_[id];
+    n.kind = kind;
+    n.t = t;
+    return n;
+}
+
+void NetEffectStore::erase(const KeyId& id) { net_.erase(id); }
+
+void NetEffectStore::insertOne(const KeyId& id, std::string_view track_id, int t_ms, std::string_view value_json,
+                               std::string_view interp) {
+    ++edits_;
+    Net* n = find(id);
+    if (n && n->kind != Net::Delete) {
+        // The key exists at this point: let the storage report the conflict
+        apply();
+        keys_.insertKeyframe(id, track_id, t_ms, value_json, interp);
+        return;
+    }
+    if (!n) n = &add(id, Net::Insert, t_ms);
+    else n->kind = Net::Replace;
+    n->t = t_ms;
+    n->track_id = track_id;
+    n->value_json = value_json;
+    n->interp = interp;
+}
+
+void NetEffectStore::deleteOne(const KeyId& id) {
+    ++edits_;
+    Net* n = find(id);
+    if (!n) {
+        add(id, Net::Delete, 0);
+    } else if (n->kind == Net::Insert) {
+        erase(id); // added and removed within the run
+    } else {
+        n->kind = Net::Delete;
+    }
+}
+
+void NetEffectStore::insertKeyframe(const KeyId& key_id, std::string_view track_id, int t_ms,
+                                    std::string_view value_json, std::string_view interp) {
+    insertOne(key_id, track_id, t_ms, value_json, interp);
+}
+
+void NetEffectStore::deleteKeyframe(const KeyId& key_id) { deleteOne(key_id); }
+
+void NetEffectStore::updateKeyframeTime(const KeyId& key_id, int t_ms) {
+    ++edits_;
+    Net* n = find(key_id);
+    if (!n) {
+        add(key_id, Net::SetTime, t_ms);
+    } else if (n->kind == Net::Shift) {
+        n->kind = Net::SetTime;
+        n->t = t_ms;
+    } else if (n->kind != Net::Delete) {
+        n->t = t_ms;
+    }
+}
+
+void NetEffectStore::insertKeyframes(const KeyframeBatch& rows) {
+    for (size_t i = 0; i < rows.size(); ++i) {
+        insertOne(rows.id(i), rows.trackId(i), rows.tMs(i), rows.valueJson(i), rows.interp(i));
+    }
+}
+
+void NetEffectStore::shiftKeyframes(const KeyIdList& ids, int delta_ms) {
+    for (size_t i = 0; i < ids.size(); ++i) {
+        ++edits_;
+        Net* n = find(ids[i]);
+        if (!n) {
+            add(ids[i], Net::Shift, delta_ms);
+        } else if (n->kind == Net::Shift) {
+            n->t += delta_ms;
+            if (n->t == 0) erase(ids[i]); // moves cancel out
+        } else if (n->kind != Net::Delete) {
+            n->t += delta_ms;
+        }
+    }
+}
+
+KeyframeBatch NetEffectStore::deleteKeyframes(const KeyIdList& ids) {
+    KeyframeBatch removed;
+    removed.reserve(ids.size());
+    for (size_t i = 0; i < ids.size(); ++i) {
+        const Net* n = find(ids[i]);
+        if (!n || (n->kind != Net::Insert && n->kind != Net::Replace)) {
+            // Row contents live in the storage only
+            apply();
+            return keys_.deleteKeyframes(ids);
+        }
+        removed.add(ids[i], n->track_id, n->t, n->value_json, n->interp);
+    }
+    for (size_t i = 0; i < ids.size(); ++i) deleteOne(ids[i]);
+    return removed;
+}
+
+void NetEffectStore::apply() {
+    KeyIdList deletes;
+    KeyframeBatch inserts;
+    std::vector<std::pair<KeyId, int>> times;
+    std::map<int, KeyIdList> shifts;
+    for (const KeyId& id : order_) {
+        auto it = net_.find(id);
+        if (it == net_.end()) continue; // vanished, or already taken under an earlier position
+        const Net& n = it->second;
+        switch (n.kind) {
+        case Net::Shift: shifts[n.t].push_back(id); break;
+        case Net::SetTime: times.emplace_back(id, n.t); break;
+        case Net::Delete: deletes.push_back(id); break;
+        case Net::Replace: deletes.push_back(id); [[fallthrough]];
+        case Net::Insert: inserts.add(id, n.track_id, n.t, n.value_json, n.interp); break;
+        }
+        ++written_;
+        net_.erase(it);
+    }
+    order_.clear();
+    if (!deletes.empty()) keys_.deleteKeyframes(deletes);
+    if (!inserts.empty()) keys_.insertKeyframes(inserts);
+    for (const auto& [id, t] : times) keys_.updateKeyframeTime(id, t);
+    for (const auto& [delta, ids] : shifts) keys_.shiftKeyframes(ids, delta);
+}
+
+} // namespace verity
@@ -0,0 +1,169 @@
+#include "verity/read_pool.hpp"
+#include <algorithm>
+#include <stdexcept>
+#include <thread>
+
+namespace verity {
+
+namespace {
+struct StmtScope {
+    sqlite3_stmt* stmt;
+    ~StmtScope() {
+        sqlite3_reset(stmt);
+        sqlite3_clear_bindings(stmt);
+    }
+};
+
+std::string_view column_text(sqlite3_stmt* stmt, int col) {
+    const auto* p = reinterpret_cast<const char*>(sqlite3_column_text(stmt, col));
+    return p ? std::string_view(p, static_cast<size_t>(sqlite3_column_bytes(stmt, col))) : std::string_view();
+}
+} // namespace
+
+ReadConnection::ReadConnection(const std::string& db_path) {
+    if (sqlite3_open_v2(db_path.c_str(), &db_, SQLITE_OPEN_READONLY | SQLITE_OPEN_NOMUTEX, nullptr) != SQLITE_OK) {
+        sqlite3_close(db_);
+        throw std::runtime_error("failed to open sqlite database for reading: " + db_path);
+    }
+    sqlite3_stmt* info = nullptr;
+    if (sqlite3_prepare_v2(db_, "SELECT 1 FROM pragma_table_info('revisions') WHERE name = 'diff_blob'", -1, &info,
+                           nullptr) == SQLITE_OK) {
+        diff_blob_column_ = sqlite3_step(info) == SQLITE_ROW;
+    }
+    sqlite3_finalize(info);
+}
+
+ReadConnection::~ReadConnection() {
+    for (sqlite3_stmt* st : stmts_) sqlite3_finalize(st);
+    sqlite3_close(db_);
+}
+
+sqlite3_stmt* ReadConnection::cached(Stmt id) {
+    static const char* const kSql[kStmtCount] = {
+        "BEGIN",
+        "COMMIT",
+        "SELECT id, track_id, t_ms, value_json, interp FROM keyframes"
+        " WHERE track_id = ? AND t_ms BETWEEN ? AND ? ORDER BY t_ms",
+        "SELECT id, label, diff_json, diff_blob FROM revisions WHERE id > ? ORDER BY id LIMIT ?",
+        "SELECT COALESCE(MAX(id), 0) FROM revisions",
+    };
+    const char* sql = kSql[id];
+    if (id == kStmtRevisionPage && !diff_blob_column_) {
+        sql = "SELECT id, label, diff_json, NULL FROM revisions WHERE id > ? ORDER BY id LIMIT ?";
+    }
+    sqlite3_stmt*& st = stmts_[id];
+    if (!st && sqlite3_prepare_v3(db_, sql, -1, SQLITE_PREPARE_PERSISTENT, &st, nullptr) != SQLITE_OK) {
+        st = nullptr;
+        throw std::runtime_error(std::string("prepare failed: ") + sqlite3_errmsg(db_));
+    }
+    return st;
+}
+
+size_t ReadConnection::keyframesInRange(std::string_view track_id, int t0_ms, int t1_ms,
+                                        const std::function<void(const KeyframeRowView&)>& fn) {
+    StmtScope scope {cached(kStmtKeyRange)};
+    sqlite3_bind_text(scope.stmt, 1, track_id.data(), static_cast<int>(track_id.size()), SQLITE_STATIC);
+    sqlite3_bind_int(scope.stmt, 2, t0_ms);
+    sqlite3_bind_int(scope.stmt, 3, t1_ms);
+    size_t rows = 0;
+    int rc = SQLITE_OK;
+    while ((rc = sqlite3_step(scope.stmt)) == SQLITE_ROW) {
+        KeyframeRowView row;
+        row.id = column_text(scope.stmt, 0);
+        row.track_id = column_text(scope.stmt, 1);
+        row.t_ms = sqlite3_column_int(scope.stmt, 2);
+        row.value_json = column_text(scope.stmt, 3);
+        row.interp = column_text(scope.stmt, 4);
+        fn(row);
+        ++rows;
+    }
+    if (rc != SQLITE_DONE) throw std::runtime_error(std::string("keyframe range query failed: ") + sqlite3_errmsg(db_));
+    return rows;
+}
+
+int64_t ReadConnection::revisionsPage(int64_t after_id, size_t limit,
+                                      const std::function<void(int64_t id, const RevisionRecord&)>& fn) {
+    StmtScope scope {cached(kStmtRevisionPage)};
+    sqlite3_bind_int64(scope.stmt, 1, after_id);
+    sqlite3_bind_int64(scope.stmt, 2, static_cast<sqlite3_int64>(limit));
+    int64_t last = after_id;
+    RevisionRecord r;
+    int rc = SQLITE_OK;
+    while ((rc = sqlite3_step(scope.stmt)) == SQLITE_ROW) {
+        last = sqlite3_column_int64(scope.stmt, 0);
+        r.label = column_text(scope.stmt, 1);
+        r.diff_json = column_text(scope.stmt, 2);
+        r.diff_blob.clear();
+        if (const void* blob = sqlite3_column_blob(scope.stmt, 3)) {
+            r.diff_blob.assign(static_cast<const char*>(blob), static_cast<size_t>(sqlite3_column_bytes(scope.stmt, 3)));
+        }
+        fn(last, r);
+    }
+    if (rc != SQLITE_DONE) throw std::runtime_error(std::string("revision page query failed: ") + sqlite3_errmsg(db_));
+    return last;
+}
+
+int64_t ReadConnection::latestRevisionId() {
+    StmtScope scope {cached(kStmtLatestRevision)};
+    int64_t id = 0;
+    if (sqlite3_step(scope.stmt) == SQLITE_ROW) id = sqlite3_column_int64(scope.stmt, 0);
+    return id;
+}
+
+ReadPool::ReadPool(const std::string& db_path, size_t connections) {
+    if (connections == 0) connections = std::max(1u, std::thread::hardware_concurrency());
+    connections_.reserve(connections);
+    for (size_t i = 0; i < connections; ++i) {
+        connections_.push_back(std::make_unique<ReadConnection>(db_path));
+        idle_.push_back(connections_.back().get());
+    }
+}
+
+void ReadPool::read(const std::function<void(ReadConnection&)>& fn) {
+    ReadConnection* conn = nullptr;
+    {
+        std::unique_lock<std::mutex> lock(mu_);
+        cv_.wait(lock, [this] { return !idle_.empty(); });
+        conn = idle_.back();
+        idle_.pop_back();
+    }
+    // Ends the read transaction and hands the connection back, also when `fn` throws
+    struct Lease {
+        ReadPool& pool;
+        ReadConnection* conn;
+        bool open {false};
+        ~Lease() {
+            if (open) {
+                StmtScope commit {conn->cached(ReadConnection::kStmtCommit)};
+                sqlite3_step(commit.stmt);
+            }
+            {
+                std::lock_guard<std::mutex> lock(pool.mu_);
+                pool.idle_.push_back(conn);
+            }
+            pool.cv_.notify_one();
+        }
+    } lease {*this, conn};
+    {
+        StmtScope begin {conn->cached(ReadConnection::kStmtBegin)};
+        if (sqlite3_step(begin.stmt) != SQLITE_DONE) throw std::runtime_error("begin read failed");
+    }
+    lease.open = true;
+    fn(*conn);
+}
+
+size_t ReadPool::keyframesInRange(std::string_view track_id, int t0_ms, int t1_ms,
+                                  const std::function<void(const KeyframeRowView&)>& fn) {
+    size_t rows = 0;
+    read([&](ReadConnection& c) { rows = c.keyframesInRange(track_id, t0_ms, t1_ms, fn); });
+    return rows;
+}
+
+int64_t ReadPool::revisionsPage(int64_t after_id, size_t limit,
+                                const std::function<void(int64_t id, const RevisionRecord&)>& fn) {
+    int64_t last = after_id;
+    read([&](ReadConnection& c) { last = c.revisionsPage(after_id, limit, fn); });
+    return last;
+}
+
+} // namespace verity
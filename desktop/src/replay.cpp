@@ -1,152 +1,452 @@
 #include "verity/replay.hpp"
 #include "commands/add_keyframe.hpp"
+#include "commands/bulk_keyframes.hpp"
 #include "commands/move_selection.hpp"
-#include <cctype>
-#include <stdexcept>
+#include "verity/diff_codec.hpp"
+#include <charconv>
+#include <cstdint>
+#include <string>
 
 namespace verity {
 
-static std::string get_string(const std::string& json, const std::string& key) {
-    const std::string needle = std::string("\"") + key + "\"";
-    auto k = json.find(needle);
-    if (k == std::string::npos) return {};
-    auto colon = json.find(':', k + needle.size());
-    if (colon == std::string::npos) return {};
-    auto q = json.find('"', colon + 1);
-    if (q == std::string::npos) return {};
-    std::string out;
-    for (size_t i = q + 1; i < json.size(); ++i) {
-        char c = json[i];
-        if (c == '\\') {
-            if (i + 1 < json.size()) {
-                char n = json[++i];
-                switch (n) {
-                case '\\': out.push_back('\\'); break;
-                case '"': out.push_back('"'); break;
-                case 'n': out.push_back('\n'); break;
-                case 'r': out.push_back('\r'); break;
-                case 't': out.push_back('\t'); break;
-                default: out.push_back(n); break;
-                }
+namespace {
+
+// One JSON value as a view into the revision text. Strings keep their raw (still escaped) content;
+// objects, arrays and numbers keep their full source span.
+struct JsonValue {
+    enum Kind : uint8_t { None, String, Number, Object, Array, Literal } kind {None};
+    std::string_view raw;
+    bool escaped {false};
+};
+
+// Single-pass, non-allocating tokenizer over one revision diff. MoveSelection rows written before
+// ids were escaped used \" for the quotes of their item objects ({\"id\":\"k\",...}); where a
+// token is expected, \" opens such a string and the next \" closes it.
+class JsonCursor {
+public:
+    explicit JsonCursor(std::string_view s) : p_(s.data()), end_(s.data() + s.size()) {}
+
+    // Calls fn(name, value) for each member of the object at the cursor; false on malformed input
+    template <class F>
+    bool members(F&& fn) {
+        skipWs();
+        if (p_ == end_ || *p_ != '{') return false;
+        ++p_;
+        skipWs();
+        if (p_ < end_ && *p_ == '}') {
+            ++p_;
+            return true;
+        }
+        for (;;) {
+            std::string_view name;
+            bool escaped = false;
+            if (!string(name, escaped)) return false;
+            skipWs();
+            if (p_ == end_ || *p_ != ':') return false;
+            ++p_;
+            JsonValue v;
+            if (!value(v)) return false;
+            fn(name, v);
+            skipWs();
+            if (p_ == end_) return false;
+            if (*p_ == '}') {
+                ++p_;
+                return true;
+            }
+            if (*p_ != ',') return false;
+            ++p_;
+        }
+    }
+
+    // Calls fn(value) for each element of the array at the cursor; false on malformed input
+    template <class F>
+    bool elements(F&& fn) {
+        skipWs();
+        if (p_ == end_ || *p_ != '[') return false;
+        ++p_;
+        skipWs();
+        if (p_ < end_ && *p_ == ']') {
+            ++p_;
+            return true;
+        }
+        for (;;) {
+            JsonValue v;
+            if (!value(v)) return false;
+            fn(v);
+            skipWs();
+            if (p_ == end_) return false;
+            if (*p_ == ']') {
+                ++p_;
+                return true;
             }
+            if (*p_ != ',') return false;
+            ++p_;
+        }
+    }
+
+private:
+    void skipWs() {
+        while (p_ < end_ && (*p_ == ' ' || *p_ == '\t' || *p_ == '\n' || *p_ == '\r')) ++p_;
+    }
+
+    bool atLegacyQuote() const { return end_ - p_ >= 2 && p_[0] == '\\' && p_[1] == '"'; }
+
+    bool string(std::string_view& out, bool& escaped) {
+        skipWs();
+        bool legacy = false;
+        if (p_ < end_ && *p_ == '"') {
+            ++p_;
+        } else if (atLegacyQuote()) {
+            p_ += 2;
+            legacy = true;
+        } else {
+            return false;
+        }
+        const char* begin = p_;
+        escaped = false;
+        while (p_ < end_) {
+            if (*p_ == '\\') {
+                if (legacy && atLegacyQuote()) break;
+                escaped = true;
+                p_ += 2;
+                continue;
+            }
+            if (*p_ == '"' && !legacy) break;
+            ++p_;
+        }
+        if (p_ >= end_) return false;
+        out = std::string_view(begin, size_t(p_ - begin));
+        p_ += legacy ? 2 : 1;
+        return true;
+    }
+
+    bool value(JsonValue& v) {
+        skipWs();
+        if (p_ == end_) return false;
+        const char* begin = p_;
+        const char c = *p_;
+        bool ok = true;
+        if (c == '"' || atLegacyQuote()) {
+            v.kind = JsonValue::String;
+            return string(v.raw, v.escaped);
+        }
+        if (c == '{') {
+            v.kind = JsonValue::Object;
+            ok = members([](std::string_view, const JsonValue&) {});
+        } else if (c == '[') {
+            v.kind = JsonValue::Array;
+            ok = elements([](const JsonValue&) {});
+        } else if (c == '-' || c == '+' || (c >= '0' && c <= '9')) {
+            v.kind = JsonValue::Number;
+            ++p_;
+            while (p_ < end_ && ((*p_ >= '0' && *p_ <= '9') || *p_ == '.' || *p_ == 'e' || *p_ == 'E' ||
+                                 *p_ == '-' || *p_ == '+')) {
+                ++p_;
+            }
+        } else if (c >= 'a' && c <= 'z') {
+            v.kind = JsonValue::Literal;
+            while (p_ < end_ && *p_ >= 'a' && *p_ <= 'z') ++p_;
+        } else {
+            return false;
+        }
+        v.raw = std::string_view(begin, size_t(p_ - begin));
+        return ok;
+    }
+
+    const char* p_;
+    const char* end_;
+};
+
+void append_utf8(std::string& out, uint32_t cp) {
+    if (cp < 0x80) {
+        out += char(cp);
+    } else if (cp < 0x800) {
+        out += char(0xC0 | (cp >> 6));
+        out += char(0x80 | (cp & 0x3F));
+    } else {
+        out += char(0xE0 | (cp >> 12));
+        out += char(0x80 | ((cp >> 6) & 0x3F));
+        out += char(0x80 | (cp & 0x3F));
+    }
+}
+
+// Decoded string value: the raw view itself when it has no escapes, otherwise decoded into scratch
+std::string_view text(const JsonValue& v, std::string& scratch) {
+    if (v.kind != JsonValue::String) return {};
+    if (!v.escaped) return v.raw;
+    scratch.clear();
+    const std::string_view s = v.raw;
+    for (size_t i = 0; i < s.size(); ++i) {
+        if (s[i] != '\\' || i + 1 == s.size()) {
+            scratch += s[i];
             continue;
         }
-        if (c == '"') break;
-        out.push_back(c);
+        const char n = s[++i];
+        switch (n) {
+        case 'n': scratch += '\n'; break;
+        case 'r': scratch += '\r'; break;
+        case 't': scratch += '\t'; break;
+        case 'b': scratch += '\b'; break;
+        case 'f': scratch += '\f'; break;
+        case 'u': {
+            uint32_t cp = 0;
+            if (i + 4 < s.size() && std::from_chars(s.data() + i + 1, s.data() + i + 5, cp, 16).ec == std::errc()) {
+                append_utf8(scratch, cp);
+                i += 4;
+            }
+            break;
+        }
+        default: scratch += n; break; // \" \\ \/
+        }
     }
+    return scratch;
+}
+
+int to_int(const JsonValue& v) {
+    std::string_view s = v.raw;
+    if (!s.empty() && s.front() == '+') s.remove_prefix(1);
+    int out = 0;
+    std::from_chars(s.data(), s.data() + s.size(), out);
     return out;
 }
 
-static int get_int(const std::string& json, const std::string& key) {
-    const std::string needle = std::string("\"") + key + "\"";
-    auto k = json.find(needle);
-    if (k == std::string::npos) return 0;
-    auto colon = json.find(':', k + needle.size());
-    if (colon == std::string::npos) return 0;
-    size_t i = colon + 1;
-    while (i < json.size() && std::isspace(static_cast<unsigned char>(json[i]))) ++i;
-    int sign = 1;
-    if (i < json.size() && (json[i] == '-' || json[i] == '+')) {
-        if (json[i] == '-') sign = -1;
-        ++i;
-    }
-    int val = 0;
-    while (i < json.size() && std::isdigit(static_cast<unsigned char>(json[i]))) {
-        val = val * 10 + (json[i] - '0');
-        ++i;
-    }
-    return sign * val;
+std::unique_ptr<ICommand> build_command(std::string_view json) {
+    JsonValue op, label, track, id, interp, value_json, items, ids, t_ms, delta;
+    if (!JsonCursor(json).members([&](std::string_view name, const JsonValue& v) {
+            if (name == "op") op = v;
+            else if (name == "label") label = v;
+            else if (name == "track_id") track = v;
+            else if (name == "id") id = v;
+            else if (name == "interp") interp = v;
+            else if (name == "value_json") value_json = v;
+            else if (name == "items") items = v;
+            else if (name == "ids") ids = v;
+            else if (name == "t_ms") t_ms = v;
+            else if (name == "delta") delta = v;
+        })) {
+        return nullptr;
+    }
+    std::string op_scratch;
+    std::string scratch;
+    const std::string_view kind = text(op, op_scratch);
+    if (kind == "add_key") {
+        std::string s1, s2, s3, s4;
+        return std::make_unique<AddKeyframeCommand>(text(track, s1), to_int(t_ms), text(value_json, s2), text(interp, s3),
+                                                    text(id, s4));
+    }
+    if (kind == "move") {
+        std::vector<std::pair<KeyId, int>> sel;
+        bool bad = false; // one malformed item rejects the whole revision
+        bool ok = items.kind == JsonValue::Array && JsonCursor(items.raw).elements([&](const JsonValue& item) {
+            JsonValue item_id, orig;
+            bad |= !JsonCursor(item.raw).members([&](std::string_view name, const JsonValue& v) {
+                if (name == "id") item_id = v;
+                else if (name == "orig_t_ms") orig = v;
+            });
+            const std::string_view key = text(item_id, scratch);
+            bad |= key.empty();
+            sel.emplace_back(KeyId::fromText(key), to_int(orig));
+        });
+        if (!ok || bad) return nullptr;
+        return std::make_unique<MoveSelectionCommand>(std::move(sel), to_int(delta));
+    }
+    if (kind == "bulk_add") {
+        KeyframeBatch rows;
+        std::string s1, s2, s3, s4;
+        bool bad = false;
+        bool ok = items.kind == JsonValue::Array && JsonCursor(items.raw).elements([&](const JsonValue& item) {
+            JsonValue r_id, r_track, r_t, r_value, r_interp;
+            bad |= !JsonCursor(item.raw).members([&](std::string_view name, const JsonValue& v) {
+                if (name == "id") r_id = v;
+                else if (name == "track_id") r_track = v;
+                else if (name == "t_ms") r_t = v;
+                else if (name == "value_json") r_value = v;
+                else if (name == "interp") r_interp = v;
+            });
+            const std::string_view key = text(r_id, s1);
+            bad |= key.empty();
+            rows.add(key, text(r_track, s2), to_int(r_t), text(r_value, s3), text(r_interp, s4));
+        });
+        if (!ok || bad) return nullptr;
+        return std::make_unique<BulkInsertKeyframesCommand>(std::move(rows));
+    }
+    if (kind == "bulk_move" || kind == "bulk_delete") {
+        KeyIdList list;
+        bool bad = false;
+        bool ok = ids.kind == JsonValue::Array && JsonCursor(ids.raw).elements([&](const JsonValue& v) {
+            const std::string_view key = text(v, scratch);
+            bad |= key.empty();
+            list.push_back(KeyId::fromText(key));
+        });
+        if (!ok || bad) return nullptr;
+        if (kind == "bulk_move") return std::make_unique<BulkMoveKeyframesCommand>(std::move(list), to_int(delta));
+        return std::make_unique<BulkDeleteKeyframesCommand>(std::move(list));
+    }
+    if (kind == "batch") {
+        std::vector<std::unique_ptr<ICommand>> children;
+        bool bad = false; // a child that does not parse rejects the batch rather than applying part of it
+        bool ok = items.kind == JsonValue::Array && JsonCursor(items.raw).elements([&](const JsonValue& item) {
+            if (bad) return;
+            if (auto child = build_command(item.raw)) children.push_back(std::move(child));
+            else bad = true;
+        });
+        if (!ok || bad) return nullptr;
+        std::string lbl(text(label, scratch));
+        return std::make_unique<CompositeCommand>(std::move(lbl), std::move(children));
+    }
+    return nullptr; // unknown op
 }
 
-static std::string get_op(const std::string& json) { return get_string(json, "op"); }
-
-static void replay_one(CommandStack& stack, IStorage& store, const std::string& json);
-
-static void replay_batch(CommandStack& stack, IStorage& store, const std::string& json) {
-    // naive scan for items array
-    const std::string tag = "\"items\":";
-    auto p = json.find(tag);
-    if (p == std::string::npos) return;
-    auto lb = json.find('[', p + tag.size());
-    if (lb == std::string::npos) return;
-    auto rb = json.rfind(']');
-    if (rb == std::string::npos || rb <= lb) return;
-    std::string items = json.substr(lb + 1, rb - lb - 1);
-    // split on top-level commas between objects (assumes no nested objects with unbalanced braces)
-    size_t depth = 0;
-    size_t start = 0;
-    for (size_t i = 0; i <= items.size(); ++i) {
-        if (i == items.size() || (items[i] == ',' && depth == 0)) {
-            std::string obj = items.substr(start, i - start);
-            if (!obj.empty()) replay_one(stack, store, obj);
-            start = i + 1;
-        } else if (items[i] == '{') {
-            ++depth;
-        } else if (items[i] == '}') {
-            if (depth > 0) --depth;
-        }
+bool decode_ids(DiffReader& in, KeyIdList& ids) {
+    const uint64_t n = in.u();
+    if (n > in.remaining()) return false;
+    ids.reserve(n);
+    for (uint64_t k = 0; k < n && in.ok(); ++k) ids.push_back(in.id());
+    return in.ok();
+}
+
+bool decode_rows(DiffReader& in, KeyframeBatch& rows) {
+    const uint64_t n = in.u();
+    if (n > in.remaining()) return false;
+    rows.reserve(n);
+    int64_t t = 0;
+    for (uint64_t k = 0; k < n && in.ok(); ++k) {
+        const KeyId id = in.id();
+        const std::string_view track = in.ref();
+        t += in.i();
+        const std::string_view interp = in.ref();
+        rows.add(id, track, int(t), in.bytes(), interp);
     }
+    return in.ok();
 }
 
-static void replay_one(CommandStack& stack, IStorage& store, const std::string& json) {
-    const auto op = get_op(json);
-    if (op == "add_key") {
-        const auto track = get_string(json, "track_id");
-        const auto id = get_string(json, "id");
-        const auto interp = get_string(json, "interp");
-        const auto value_json = get_string(json, "value_json");
-        int t_ms = get_int(json, "t_ms");
-        auto cmd = std::make_unique<AddKeyframeCommand>(track, t_ms, value_json, interp, id);
-        stack.execute(std::move(cmd));
-    } else if (op == "move") {
-        int delta = get_int(json, "delta");
-        // items with {"id":"...","orig_t_ms":N}
-        std::vector<std::pair<std::string, int>> sel;
-        const std::string tag = "\"items\":";
-        auto p = json.find(tag);
-        if (p != std::string::npos) {
-            auto lb = json.find('[', p + tag.size());
-            auto rb = json.rfind(']');
-            if (lb != std::string::npos && rb != std::string::npos && rb > lb) {
-                std::string items = json.substr(lb + 1, rb - lb - 1);
-                size_t start = 0;
-                for (size_t i = 0; i <= items.size(); ++i) {
-                    if (i == items.size() || items[i] == ',') {
-                        std::string obj = items.substr(start, i - start);
-                        if (!obj.empty()) {
-                            std::string id = get_string(obj, "id");
-                            int orig = get_int(obj, "orig_t_ms");
-                            sel.emplace_back(id, orig);
-                        }
-                        start = i + 1;
-                    }
-                }
-            }
+std::unique_ptr<ICommand> decode_command(DiffReader& in) {
+    using namespace diffcodec;
+    const uint8_t code = in.op();
+    switch (code) {
+    case kAddKey: {
+        const KeyId track = in.id();
+        const int t_ms = int(in.i());
+        const KeyId id = in.id();
+        const std::string_view interp = in.ref();
+        const std::string_view value = in.bytes();
+        if (!in.ok()) return nullptr;
+        return std::make_unique<AddKeyframeCommand>(track, t_ms, value, interp, id);
+    }
+    case kMove: {
+        const int delta = int(in.i());
+        const uint64_t n = in.u();
+        if (n > in.remaining()) return nullptr;
+        std::vector<std::pair<KeyId, int>> sel;
+        sel.reserve(n);
+        int64_t t = 0;
+        for (uint64_t k = 0; k < n && in.ok(); ++k) {
+            const KeyId id = in.id();
+            t += in.i();
+            sel.emplace_back(id, int(t));
         }
-        auto cmd = std::make_unique<MoveSelectionCommand>(std::move(sel), delta);
-        stack.execute(std::move(cmd));
-    } else if (op == "batch") {
-        // Reconstruct a batch by executing items within begin/endBatch
-        stack.beginBatch(get_string(json, "label"));
-        try {
-            replay_batch(stack, store, json);
-            stack.endBatch();
-        } catch (...) {
-            // Ensure we end the batch to cleanup
-            try { stack.endBatch(); } catch (...) {}
-            throw;
+        if (!in.ok()) return nullptr;
+        return std::make_unique<MoveSelectionCommand>(std::move(sel), delta);
+    }
+    case kBulkAdd: {
+        KeyframeBatch rows;
+        if (!decode_rows(in, rows)) return nullptr;
+        return std::make_unique<BulkInsertKeyframesCommand>(std::move(rows));
+    }
+    case kBulkMove:
+    case kBulkDelete: {
+        const int delta = code == kBulkMove ? int(in.i()) : 0;
+        KeyIdList ids;
+        if (!decode_ids(in, ids)) return nullptr;
+        if (code == kBulkMove) return std::make_unique<BulkMoveKeyframesCommand>(std::move(ids), delta);
+        return std::make_unique<BulkDeleteKeyframesCommand>(std::move(ids));
+    }
+    case kBulkDeleteApplied: {
+        KeyIdList ids;
+        KeyframeBatch removed;
+        if (!decode_ids(in, ids) || !decode_rows(in, removed)) return nullptr;
+        return std::make_unique<BulkDeleteKeyframesCommand>(std::move(ids), std::move(removed));
+    }
+    case kBatch: {
+        const std::string_view label = in.ref();
+        const uint64_t n = in.u();
+        if (n > in.remaining()) return nullptr;
+        std::vector<std::unique_ptr<ICommand>> children;
+        children.reserve(n);
+        for (uint64_t k = 0; k < n; ++k) {
+            auto child = decode_command(in);
+            if (!child) return nullptr;
+            children.push_back(std::move(child));
         }
-    } else {
-        // Unknown op; ignore
+        return std::make_unique<CompositeCommand>(std::string(label), std::move(children));
+    }
+    default: return nullptr; // unknown op
     }
 }
 
+} // namespace
+
+std::unique_ptr<ICommand> command_from_diff(std::string_view diff_json) { return build_command(diff_json); }
+
+std::unique_ptr<ICommand> command_from_blob(std::string_view diff_blob) {
+    DiffReader in(diff_blob);
+    if (!in.ok()) return nullptr;
+    auto cmd = decode_command(in);
+    if (!in.ok() || !in.atEnd()) return nullptr;
+    return cmd;
+}
+
+std::unique_ptr<ICommand> command_from_revision(const RevisionRecord& r) {
+    return r.diff_blob.empty() ? build_command(r.diff_json) : command_from_blob(r.diff_blob);
+}
+
+std::optional<std::string> revision_diff_json(const RevisionRecord& r) {
+    if (r.diff_blob.empty()) return r.diff_json;
+    auto cmd = command_from_blob(r.diff_blob);
+    if (!cmd) return std::nullopt;
+    return cmd->diffJson();
+}
+
 void restore_from_revisions(CommandStack& stack, IStorage& store, const std::vector<RevisionRecord>& records) {
+    (void)store;
     // Rebuild state by replaying all revisions in order
     for (const auto& r : records) {
-        replay_one(stack, store, r.diff_json);
+        if (auto cmd = command_from_revision(r)) stack.execute(std::move(cmd));
     }
 }
 
-} // namespace verity
+ReplayResult apply_revisions(IStorage& store, const std::vector<RevisionRecord>& records,
+                             std::vector<std::unique_ptr<ICommand>>& out) {
+    ReplayResult result;
+    result.revisions = records.size();
+    out.reserve(out.size() + records.size());
+    for (const auto& r : records) {
+        auto cmd = command_from_revision(r);
+        if (!cmd) {
+            ++result.skipped;
+            continue;
+        }
+        cmd->doAction(store);
+        out.push_back(std::move(cmd));
+        ++result.commands;
+    }
+    return result;
+}
 
+ReplayResult replay_revisions(CommandStack& stack, IStorage& store, const std::vector<RevisionRecord>& records) {
+    std::vector<std::unique_ptr<ICommand>> applied;
+    stack.flush();
+    store.begin();
+    ReplayResult result;
+    try {
+        result = apply_revisions(store, records, applied);
+        store.commit();
+    } catch (...) {
+        store.rollback();
+        throw;
+    }
+    for (auto& cmd : applied) stack.pushApplied(std::move(cmd));
+    return result;
+}
+
+} // namespace verity
@@ -0,0 +1,284 @@
+#include "verity/scene_index.hpp"
+#include "verity/json_scan.hpp"
+#include <algorithm>
+#include <functional>
+
+namespace verity {
+
+namespace {
+constexpr size_t kMinTableSize = 16;
+
+size_t hash_id(std::string_view id) { return std::hash<std::string_view>{}(id); }
+} // namespace
+
+// ---- Id table ----
+
+uint32_t SceneIndex::findSlot(std::string_view id) const {
+    if (table_.empty()) return kNone;
+    const size_t mask = table_.size() - 1;
+    for (size_t i = hash_id(id) & mask;; i = (i + 1) & mask) {
+        const uint32_t v = table_[i];
+        if (v == kNone) return kNone;
+        if (v != kTombstone && slots_[v].id == id) return v;
+    }
+}
+
+void SceneIndex::rehash(size_t capacity) {
+    std::vector<uint32_t> old;
+    old.swap(table_);
+    table_.assign(capacity, kNone);
+    table_used_ = 0;
+    for (uint32_t v : old) {
+        if (v != kNone && v != kTombstone) tableInsert(v);
+    }
+}
+
+void SceneIndex::tableInsert(uint32_t slot) {
+    if ((table_used_ + 1) * 4 > table_.size() * 3) {
+        size_t cap = std::max(kMinTableSize, table_.size());
+        while ((live_ + 1) * 2 > cap) cap *= 2; // tombstones are dropped by the rehash
+        rehash(cap);
+    }
+    const size_t mask = table_.size() - 1;
+    size_t i = hash_id(slots_[slot].id) & mask;
+    while (table_[i] != kNone && table_[i] != kTombstone) i = (i + 1) & mask;
+    if (table_[i] == kNone) ++table_used_;
+    table_[i] = slot;
+}
+
+void SceneIndex::tableErase(std::string_view id) {
+    const size_t mask = table_.size() - 1;
+    for (size_t i = hash_id(id) & mask;; i = (i + 1) & mask) {
+        const uint32_t v = table_[i];
+        if (v == kNone) return;
+        if (v != kTombstone && slots_[v].id == id) {
+            table_[i] = kTombstone;
+            return;
+        }
+    }
+}
+
+// ---- Tracks ----
+
+const SceneIndex::Track* SceneIndex::findTrack(std::string_view track_id) const {
+    auto it = track_index_.find(std::string(track_id));
+    return it == track_index_.end() ? nullptr : &tracks_[it->second];
+}
+
+uint32_t SceneIndex::trackFor(std::string_view track_id) {
+    auto [it, inserted] = track_index_.emplace(std::string(track_id), uint32_t(tracks_.size()));
+    if (inserted) tracks_.push_back(Track{it->first, {}, {}});
+    return it->second;
+}
+
+uint16_t SceneIndex::internInterp(std::string_view interp) {
+    for (size_t i = 0; i < interps_.size(); ++i) {
+        if (interps_[i] == interp) return uint16_t(i);
+    }
+    interps_.emplace_back(interp);
+    return uint16_t(interps_.size() - 1);
+}
+
+size_t SceneIndex::lowerBound(const Track& tr, int t) {
+    return size_t(std::lower_bound(tr.times.begin(), tr.times.end(), t) - tr.times.begin());
+}
+
+size_t SceneIndex::position(const Track& tr, uint32_t slot) const {
+    size_t i = lowerBound(tr, slots_[slot].t_ms);
+    while (tr.slots[i] != slot) ++i;
+    return i;
+}
+
+void SceneIndex::placeInTrack(uint32_t slot) {
+    Track& tr = tracks_[slots_[slot].track];
+    const int32_t t = slots_[slot].t_ms;
+    if (tr.times.empty() || tr.times.back() <= t) { // appends dominate loads and recording
+        tr.times.push_back(t);
+        tr.slots.push_back(slot);
+        return;
+    }
+    const size_t i = size_t(std::upper_bound(tr.times.begin(), tr.times.end(), t) - tr.times.begin());
+    tr.times.insert(tr.times.begin() + i, t);
+    tr.slots.insert(tr.slots.begin() + i, slot);
+}
+
+void SceneIndex::removeFromTrack(uint32_t slot) {
+    Track& tr = tracks_[slots_[slot].track];
+    const size_t i = position(tr, slot);
+    tr.times.erase(tr.times.begin() + i);
+    tr.slots.erase(tr.slots.begin() + i);
+}
+
+SceneIndex::KeyRef SceneIndex::ref(uint32_t slot) const {
+    const Slot& s = slots_[slot];
+    return KeyRef{s.id, tracks_[s.track].id, s.t_ms, s.value_json, interps_[s.interp]};
+}
+
+// ---- Mutations ----
+
+bool SceneIndex::insert(std::string_view id, std::string_view track_id, int t_ms, std::string_view value_json,
+                        std::string_view interp) {
+    if (findSlot(id) != kNone) return false;
+    uint32_t slot;
+    if (!free_.empty()) {
+        slot = free_.back();
+        free_.pop_back();
+    } else {
+        slot = uint32_t(slots_.size());
+        slots_.emplace_back();
+    }
+    Slot& s = slots_[slot];
+    s.id.assign(id);
+    s.value_json.assign(value_json);
+    s.track = trackFor(track_id);
+    s.t_ms = t_ms;
+    s.interp = internInterp(interp);
+    s.live = true;
+    ++live_;
+    tableInsert(slot);
+    placeInTrack(slot);
+    if ((in_txn_ || !savepoints_.empty()) && !replaying_) {
+        journal_.push_back(JournalEntry{JournalEntry::Inserted, std::string(id), {}, {}, {}, 0});
+    }
+    return true;
+}
+
+bool SceneIndex::erase(std::string_view id) {
+    const uint32_t slot = findSlot(id);
+    if (slot == kNone) return false;
+    Slot& s = slots_[slot];
+    if ((in_txn_ || !savepoints_.empty()) && !replaying_) {
+        journal_.push_back(JournalEntry{JournalEntry::Erased, s.id, tracks_[s.track].id, s.value_json,
+                                        interps_[s.interp], s.t_ms});
+    }
+    removeFromTrack(slot);
+    tableErase(s.id);
+    s.live = false;
+    s.id.clear();
+    s.value_json.clear();
+    --live_;
+    free_.push_back(slot);
+    return true;
+}
+
+bool SceneIndex::setTime(std::string_view id, int t_ms) {
+    const uint32_t slot = findSlot(id);
+    if (slot == kNone) return false;
+    Slot& s = slots_[slot];
+    if (s.t_ms == t_ms) return true;
+    if ((in_txn_ || !savepoints_.empty()) && !replaying_) {
+        journal_.push_back(JournalEntry{JournalEntry::Retimed, s.id, {}, {}, {}, s.t_ms});
+    }
+    removeFromTrack(slot);
+    s.t_ms = t_ms;
+    placeInTrack(slot);
+    return true;
+}
+
+void SceneIndex::clear() {
+    slots_.clear();
+    free_.clear();
+    table_.clear();
+    table_used_ = 0;
+    live_ = 0;
+    tracks_.clear();
+    track_index_.clear();
+    interps_.clear();
+    journal_.clear();
+    savepoints_.clear();
+    in_txn_ = false;
+}
+
+// ---- Journal ----
+
+void SceneIndex::undoTo(size_t mark) {
+    replaying_ = true;
+    while (journal_.size() > mark) {
+        const JournalEntry& e = journal_.back();
+        switch (e.op) {
+        case JournalEntry::Inserted: erase(e.id); break;
+        case JournalEntry::Erased: insert(e.id, e.track_id, e.t_ms, e.value_json, e.interp); break;
+        case JournalEntry::Retimed: setTime(e.id, e.t_ms); break;
+        }
+        journal_.pop_back();
+    }
+    replaying_ = false;
+}
+
+void SceneIndex::begin() { in_txn_ = true; }
+
+void SceneIndex::commit() {
+    in_txn_ = false;
+    journal_.clear();
+    savepoints_.clear();
+}
+
+void SceneIndex::rollback() {
+    undoTo(0);
+    savepoints_.clear();
+    in_txn_ = false;
+}
+
+void SceneIndex::savepoint() { savepoints_.push_back(journal_.size()); }
+
+void SceneIndex::releaseSavepoint() {
+    if (savepoints_.empty()) return;
+    savepoints_.pop_back();
+    if (savepoints_.empty() && !in_txn_) journal_.clear();
+}
+
+void SceneIndex::rollbackToSavepoint() {
+    if (!savepoints_.empty()) undoTo(savepoints_.back());
+}
+
+// ---- Queries ----
+
+std::optional<SceneIndex::KeyRef> SceneIndex::find(std::string_view id) const {
+    const uint32_t slot = findSlot(id);
+    if (slot == kNone) return std::nullopt;
+    return ref(slot);
+}
+
+std::vector<std::string_view> SceneIndex::trackIds() const {
+    std::vector<std::string_view> ids;
+    ids.reserve(tracks_.size());
+    for (const Track& tr : tracks_) {
+        if (!tr.times.empty()) ids.push_back(tr.id);
+    }
+    std::sort(ids.begin(), ids.end());
+    return ids;
+}
+
+const std::vector<int32_t>& SceneIndex::trackTimes(std::string_view track_id) const {
+    static const std::vector<int32_t> kEmpty;
+    const Track* tr = findTrack(track_id);
+    return tr ? tr->times : kEmpty;
+}
+
+size_t SceneIndex::buildEngineKeys(std::string_view track_id, std::vector<Key>& out, std::string_view channel,
+                                   std::string_view in_tangent, std::string_view out_tangent) const {
+    out.clear();
+    const Track* tr = findTrack(track_id);
+    if (!tr) return 0;
+    out.reserve(tr->slots.size());
+    size_t malformed = 0;
+    for (size_t i = 0; i < tr->slots.size(); ++i) {
+        Key k {float(tr->times[i]), 0.f, 0.f, 0.f};
+        bool has_value = false;
+        const bool ok = scan_numeric_fields(slots_[tr->slots[i]].value_json, [&](std::string_view name, double v) {
+            if (name == channel) {
+                k.value = float(v);
+                has_value = true;
+            } else if (name == in_tangent) {
+                k.inTan = float(v);
+            } else if (name == out_tangent) {
+                k.outTan = float(v);
+            }
+        });
+        if (!ok || !has_value) ++malformed;
+        out.push_back(k);
+    }
+    return malformed;
+}
+
+} // namespace verity
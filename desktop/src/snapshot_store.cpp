@@ -0,0 +1,317 @@
+#include "verity/snapshot_store.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <thread>
+#include <unordered_set>
+
+namespace fs = std::filesystem;
+
+namespace verity {
+
+namespace {
+
+constexpr const char* kManifestMagic = "verity-snapshot 1";
+constexpr const char* kManifestSuffix = ".manifest";
+
+class Sha256 {
+public:
+    void update(const uint8_t* p, size_t n) {
+        total_ += n;
+        if (fill_) {
+            const size_t take = std::min(n, sizeof(buf_) - fill_);
+            std::memcpy(buf_ + fill_, p, take);
+            fill_ += take;
+            p += take;
+            n -= take;
+            if (fill_ < sizeof(buf_)) return;
+            block(buf_);
+            fill_ = 0;
+        }
+        for (; n >= 64; p += 64, n -= 64) block(p);
+        std::memcpy(buf_, p, n);
+        fill_ = n;
+    }
+
+    std::string hex() {
+        const uint64_t bits = total_ * 8;
+        const uint8_t pad = 0x80;
+        update(&pad, 1);
+        const uint8_t zero = 0;
+        while (fill_ != 56) update(&zero, 1);
+        uint8_t len[8];
+        for (int i = 0; i < 8; ++i) len[i] = static_cast<uint8_t>(bits >> (56 - 8 * i));
+        update(len, 8);
+        static const char digits[] = "0123456789abcdef";
+        std::string out(64, '0');
+        for (int i = 0; i < 8; ++i) {
+            for (int b = 0; b < 8; ++b) out[i * 8 + b] = digits[(h_[i] >> (28 - 4 * b)) & 0xf];
+        }
+        return out;
+    }
+
+private:
+    static uint32_t rotr(uint32_t x, int n) { return (x >> n) | (x << (32 - n)); }
+
+    void block(const uint8_t* p) {
+        static const uint32_t k[64] = {
+            0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+            0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+            0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+            0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+            0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+            0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+            0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+            0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
+        uint32_t w[64];
+        for (int i = 0; i < 16; ++i) {
+            w[i] = (uint32_t(p[4 * i]) << 24) | (uint32_t(p[4 * i + 1]) << 16) | (uint32_t(p[4 * i + 2]) << 8) |
+                   uint32_t(p[4 * i + 3]);
+        }
+        for (int i = 16; i < 64; ++i) {
+            const uint32_t s0 = rotr(w[i - 15], 7) ^ rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+            const uint32_t s1 = rotr(w[i - 2], 17) ^ rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+            w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+        }
+        uint32_t a = h_[0], b = h_[1], c = h_[2], d = h_[3], e = h_[4], f = h_[5], g = h_[6], h = h_[7];
+        for (int i = 0; i < 64; ++i) {
+            const uint32_t t1 = h + (rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25)) + ((e & f) ^ (~e & g)) + k[i] + w[i];
+            const uint32_t t2 = (rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+            h = g;
+            g = f;
+            f = e;
+            e = d + t1;
+            d = c;
+            c = b;
+            b = a;
+            a = t1 + t2;
+        }
+        h_[0] += a;
+        h_[1] += b;
+        h_[2] += c;
+        h_[3] += d;
+        h_[4] += e;
+        h_[5] += f;
+        h_[6] += g;
+        h_[7] += h;
+    }
+
+    uint32_t h_[8] = {0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+    uint8_t buf_[64];
+    size_t fill_ {0};
+    uint64_t total_ {0};
+};
+
+struct Manifest {
+    int64_t revision {-1};
+    uint64_t size {0};
+    std::vector<std::pair<std::string, size_t>> chunks;
+};
+
+bool is_chunk_hash(const std::string& s) {
+    return s.size() == 64 && std::all_of(s.begin(), s.end(), [](char c) {
+               return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'f');
+           });
+}
+
+Manifest read_manifest(const fs::path& file) {
+    std::ifstream in(file);
+    std::string line;
+    if (!in || !std::getline(in, line) || line != kManifestMagic) {
+        throw std::runtime_error("not a snapshot manifest: " + file.string());
+    }
+    Manifest m;
+    std::string key;
+    while (in >> key) {
+        if (key == "revision") {
+            in >> m.revision;
+        } else if (key == "size") {
+            in >> m.size;
+        } else if (key == "chunk_bytes") {
+            size_t ignored = 0;
+            in >> ignored;
+        } else if (is_chunk_hash(key)) {
+            size_t len = 0;
+            in >> len;
+            m.chunks.emplace_back(key, len);
+        } else {
+            throw std::runtime_error("bad snapshot manifest line '" + key + "': " + file.string());
+        }
+    }
+    return m;
+}
+
+// Writes `size` bytes to `target` via a temporary name in the same directory
+void write_atomically(const fs::path& target, const char* data, size_t size) {
+    const fs::path tmp = fs::path(target.string() + ".tmp");
+    {
+        std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+        out.write(data, static_cast<std::streamsize>(size));
+        if (!out) throw std::runtime_error("snapshot store write failed: " + tmp.string());
+    }
+    std::error_code ec;
+    fs::rename(tmp, target, ec);
+    if (ec) throw std::runtime_error("snapshot store rename failed: " + target.string());
+}
+
+} // namespace
+
+std::string sha256_hex(const void* data, size_t size) {
+    Sha256 h;
+    h.update(static_cast<const uint8_t*>(data), size);
+    return h.hex();
+}
+
+SnapshotStore::SnapshotStore(std::string dir, size_t chunk_bytes, unsigned threads)
+    : dir_(std::move(dir)), chunk_bytes_(chunk_bytes ? chunk_bytes : 256 * 1024),
+      threads_(threads ? threads : std::max(1u, std::min(8u, std::thread::hardware_concurrency()))) {}
+
+SnapshotStats SnapshotStore::put(const std::string& name, const std::string& file, int64_t revision) {
+    std::ifstream in(file, std::ios::binary);
+    if (!in) throw std::runtime_error("failed to open for snapshot: " + file);
+    Reader read = [&](char* out, size_t size, uint64_t) {
+        in.read(out, static_cast<std::streamsize>(size));
+        if (in.bad()) throw std::runtime_error("snapshot read failed: " + file);
+        return static_cast<size_t>(in.gcount());
+    };
+    return put(name, read, revision);
+}
+
+SnapshotStats SnapshotStore::put(const std::string& name, const Reader& read, int64_t revision) {
+    const auto t0 = std::chrono::steady_clock::now();
+    const fs::path root(dir_);
+    fs::create_directories(root / "chunks");
+    fs::create_directories(root / "manifests");
+
+    SnapshotStats stats;
+    std::string manifest = std::string(kManifestMagic) + "\nchunk_bytes " + std::to_string(chunk_bytes_) +
+                           "\nsize SIZE\nrevision " + std::to_string(revision) + "\n";
+    const size_t size_at = manifest.find("SIZE");
+    // Read a batch of chunks, hash it across threads, then store what the CAS lacks
+    const size_t batch = static_cast<size_t>(threads_) * 8;
+    std::vector<std::string> bufs(batch, std::string(chunk_bytes_, '\0'));
+    std::vector<size_t> lens(batch);
+    std::vector<std::string> hashes(batch);
+    uint64_t offset = 0;
+    bool more = true;
+    while (more) {
+        size_t n = 0;
+        for (; n < batch; ++n) {
+            lens[n] = read(bufs[n].data(), chunk_bytes_, offset);
+            offset += lens[n];
+            if (lens[n] < chunk_bytes_) {
+                more = false;
+                if (lens[n] > 0) ++n;
+                break;
+            }
+        }
+        if (n == 0) break;
+        auto hash_range = [&](size_t first) {
+            for (size_t i = first; i < n; i += threads_) hashes[i] = sha256_hex(bufs[i].data(), lens[i]);
+        };
+        std::vector<std::thread> workers;
+        for (unsigned t = 1; t < threads_ && t < n; ++t) workers.emplace_back(hash_range, t);
+        hash_range(0);
+        for (auto& w : workers) w.join();
+
+        for (size_t i = 0; i < n; ++i) {
+            const fs::path shard = root / "chunks" / hashes[i].substr(0, 2);
+            const fs::path target = shard / hashes[i];
+            std::error_code ec;
+            if (!fs::exists(target, ec)) {
+                fs::create_directories(shard);
+                write_atomically(target, bufs[i].data(), lens[i]);
+                ++stats.new_chunks;
+                stats.new_bytes += lens[i];
+            }
+            manifest += hashes[i] + " " + std::to_string(lens[i]) + "\n";
+            ++stats.chunks;
+            stats.bytes += lens[i];
+        }
+    }
+    manifest.replace(size_at, 4, std::to_string(stats.bytes));
+    write_atomically(root / "manifests" / (name + kManifestSuffix), manifest.data(), manifest.size());
+    stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    return stats;
+}
+
+void SnapshotStore::restore(const std::string& name, const std::string& out_file) const {
+    const fs::path root(dir_);
+    const Manifest m = read_manifest(root / "manifests" / (name + kManifestSuffix));
+    const fs::path partial = fs::path(out_file + ".partial");
+    {
+        std::ofstream out(partial, std::ios::binary | std::ios::trunc);
+        if (!out) throw std::runtime_error("failed to open for restore: " + partial.string());
+        std::string buf;
+        for (const auto& [hash, len] : m.chunks) {
+            const fs::path chunk = root / "chunks" / hash.substr(0, 2) / hash;
+            std::ifstream in(chunk, std::ios::binary);
+            buf.resize(len);
+            in.read(buf.data(), static_cast<std::streamsize>(len));
+            if (!in || in.gcount() != static_cast<std::streamsize>(len) || sha256_hex(buf.data(), len) != hash) {
+                out.close();
+                std::error_code ec;
+                fs::remove(partial, ec);
+                throw std::runtime_error("snapshot chunk missing or corrupt: " + chunk.string());
+            }
+            out.write(buf.data(), static_cast<std::streamsize>(len));
+        }
+        out.flush();
+        if (!out) throw std::runtime_error("restore write failed: " + partial.string());
+    }
+    std::error_code ec;
+    fs::rename(partial, out_file, ec);
+    if (ec) throw std::runtime_error("restore rename failed: " + out_file);
+}
+
+std::vector<std::string> SnapshotStore::list() const {
+    std::vector<std::string> out;
+    std::error_code ec;
+    const std::string suffix = kManifestSuffix;
+    for (const auto& entry : fs::directory_iterator(fs::path(dir_) / "manifests", ec)) {
+        const std::string file = entry.path().filename().string();
+        if (file.size() > suffix.size() && file.compare(file.size() - suffix.size(), suffix.size(), suffix) == 0) {
+            out.push_back(file.substr(0, file.size() - suffix.size()));
+        }
+    }
+    std::sort(out.begin(), out.end());
+    return out;
+}
+
+int64_t SnapshotStore::revisionOf(const std::string& name) const {
+    try {
+        return read_manifest(fs::path(dir_) / "manifests" / (name + kManifestSuffix)).revision;
+    } catch (const std::exception&) {
+        return -1;
+    }
+}
+
+void SnapshotStore::remove(const std::string& name) {
+    std::error_code ec;
+    fs::remove(fs::path(dir_) / "manifests" / (name + kManifestSuffix), ec);
+}
+
+size_t SnapshotStore::collectGarbage() {
+    std::unordered_set<std::string> live;
+    for (const std::string& name : list()) {
+        for (const auto& chunk : read_manifest(fs::path(dir_) / "manifests" / (name + kManifestSuffix)).chunks) {
+            live.insert(chunk.first);
+        }
+    }
+    size_t removed = 0;
+    std::error_code ec;
+    std::vector<fs::path> dead;
+    for (const auto& entry : fs::recursive_directory_iterator(fs::path(dir_) / "chunks", ec)) {
+        if (!entry.is_regular_file(ec)) continue;
+        if (!live.count(entry.path().filename().string())) dead.push_back(entry.path()); // includes stale .tmp
+    }
+    for (const auto& file : dead) {
+        if (fs::remove(file, ec)) ++removed;
+    }
+    return removed;
+}
+
+} // namespace verity
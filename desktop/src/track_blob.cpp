@@ -0,0 +1,112 @@
+#include "verity/track_blob.hpp"
+#include <cstring>
+
+namespace verity {
+
+namespace {
+
+void put_varint(std::string& out, uint64_t v) {
+    while (v >= 0x80) {
+        out.push_back(static_cast<char>((v & 0x7f) | 0x80));
+        v >>= 7;
+    }
+    out.push_back(static_cast<char>(v));
+}
+
+bool get_varint(const char*& p, const char* end, uint64_t& v) {
+    v = 0;
+    for (int shift = 0; p < end && shift < 64; shift += 7) {
+        const auto byte = static_cast<uint8_t>(*p++);
+        v |= static_cast<uint64_t>(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) return true;
+    }
+    return false;
+}
+
+void put_f32(char* out, float f) {
+    uint32_t bits = 0;
+    std::memcpy(&bits, &f, 4);
+    for (int b = 0; b < 4; ++b) out[b] = static_cast<char>(bits >> (8 * b));
+}
+
+float get_f32(const char* p) {
+    uint32_t bits = 0;
+    for (int b = 0; b < 4; ++b) bits |= static_cast<uint32_t>(static_cast<uint8_t>(p[b])) << (8 * b);
+    float f = 0.f;
+    std::memcpy(&f, &bits, 4);
+    return f;
+}
+
+} // namespace
+
+void encode_track_chunk(const int* t_ms, const Key* keys, size_t n, size_t malformed, std::string_view interp,
+                        std::string& out) {
+    out.push_back(static_cast<char>(trackblob::kMagic));
+    out.push_back(static_cast<char>(trackblob::kVersion));
+    put_varint(out, n);
+    put_varint(out, malformed);
+    put_varint(out, interp.size());
+    out.append(interp);
+    int64_t prev = 0;
+    for (size_t i = 0; i < n; ++i) {
+        const int64_t d = static_cast<int64_t>(t_ms[i]) - prev;
+        put_varint(out, (static_cast<uint64_t>(d) << 1) ^ static_cast<uint64_t>(d >> 63));
+        prev = t_ms[i];
+    }
+    const size_t base = out.size();
+    out.resize(base + n * 12);
+    char* col = &out[base];
+    for (size_t i = 0; i < n; ++i) put_f32(col + 4 * i, keys[i].value);
+    col += 4 * n;
+    for (size_t i = 0; i < n; ++i) put_f32(col + 4 * i, keys[i].inTan);
+    col += 4 * n;
+    for (size_t i = 0; i < n; ++i) put_f32(col + 4 * i, keys[i].outTan);
+}
+
+bool decode_track_chunk(std::string_view blob, std::vector<Key>& keys, TrackChunkHeader* header) {
+    const char* p = blob.data();
+    const char* end = p + blob.size();
+    if (blob.size() < 2 || static_cast<uint8_t>(p[0]) != trackblob::kMagic ||
+        static_cast<uint8_t>(p[1]) != trackblob::kVersion) {
+        return false;
+    }
+    p += 2;
+    uint64_t n = 0, malformed = 0, interp_len = 0;
+    if (!get_varint(p, end, n) || !get_varint(p, end, malformed) || !get_varint(p, end, interp_len) ||
+        interp_len > static_cast<uint64_t>(end - p)) {
+        return false;
+    }
+    const std::string_view interp(p, static_cast<size_t>(interp_len));
+    p += interp_len;
+    if (n > static_cast<uint64_t>(end - p)) return false; // at least one byte per time delta
+    const size_t first = keys.size();
+    keys.resize(first + n);
+    Key* out = keys.data() + first;
+    int64_t t = 0;
+    for (size_t i = 0; i < n; ++i) {
+        uint64_t z = 0;
+        if (!get_varint(p, end, z)) {
+            keys.resize(first);
+            return false;
+        }
+        t += static_cast<int64_t>(z >> 1) ^ -static_cast<int64_t>(z & 1);
+        out[i].time = static_cast<float>(t);
+    }
+    if (static_cast<uint64_t>(end - p) != n * 12) {
+        keys.resize(first);
+        return false;
+    }
+    for (size_t i = 0; i < n; ++i) out[i].value = get_f32(p + 4 * i);
+    p += 4 * n;
+    for (size_t i = 0; i < n; ++i) out[i].inTan = get_f32(p + 4 * i);
+    p += 4 * n;
+    for (size_t i = 0; i < n; ++i) out[i].outTan = get_f32(p + 4 * i);
+    if (header) {
+        header->keys = static_cast<size_t>(n);
+        header->malformed = static_cast<size_t>(malformed);
+        header->interp = interp;
+    }
+    return true;
+}
+
+} // namespace verity
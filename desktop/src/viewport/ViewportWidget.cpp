@@ -271,8 +271,17 @@ void ViewportWidget::updateFps() {
     tAnim_ += dtMs / 1000.0; // seconds
 }
 
+void ViewportWidget::updateEngineStats() {
+    engineStats_ = verity::getEngineStats();
+    const auto& ev = engineStats_.evaluations;
+    const uint64_t total = ev[0] + ev[1] + ev[2];
+    evalsLastFrame_ = total - lastEngineEvals_;
+    lastEngineEvals_ = total;
+}
+
 void ViewportWidget::paintGL() {
     updateFps();
+    updateEngineStats();
 
     QPainter p(this);
     p.fillRect(rect(), QColor(20, 20, 22));
@@ -415,6 +424,21 @@ void ViewportWidget::drawHud(QPainter& p) {
         p.drawText(QPoint(xText, yText), info);
     }
     yText += lineH;
+    if (engineStats_.enabled) {
+        const double searches = double(std::max<uint64_t>(1, engineStats_.segmentSearches));
+        p.drawText(QPoint(xText, yText),
+                   QString("Engine: %1 evals/frame  %2 steps/search  %3 LUT builds")
+                       .arg(evalsLastFrame_)
+                       .arg(double(engineStats_.searchSteps) / searches, 0, 'f', 1)
+                       .arg(engineStats_.lutBuilds));
+        yText += lineH;
+    }
+    p.drawText(QPoint(xText, yText),
+               QString("Curves: %1  keys %2 KB  LUT %3 KB")
+                   .arg(engineStats_.curves)
+                   .arg(double(engineStats_.keyBytes) / 1024.0, 0, 'f', 1)
+                   .arg(double(engineStats_.lutBytes) / 1024.0, 0, 'f', 1));
+    yText += lineH;
     p.setPen(QColor(180, 180, 180));
     if (enable3D_) {
         p.drawText(QPoint(xText, yText), QString("3D: Drag orbit, Wheel dolly, R reset, M toggle 2D"));
@@ -0,0 +1,113 @@
+#include "verity/wal_policy.hpp"
+#include <algorithm>
+#include <filesystem>
+#include <stdexcept>
+
+namespace verity {
+
+WalPolicy::WalPolicy(std::string db_path, WalPolicyOptions options)
+    : db_path_(std::move(db_path)), options_(options), last_change_(std::chrono::steady_clock::now()) {}
+
+WalPolicy::~WalPolicy() {
+    stop();
+    if (db_) sqlite3_close(db_);
+}
+
+void WalPolicy::configure(SqliteStorage& storage) const {
+    if (options_.mmap_bytes >= 0) storage.setMmapSize(options_.mmap_bytes);
+    if (options_.cache_kib >= 0) storage.setCacheSize(options_.cache_kib);
+    storage.setBusyTimeout(options_.writer_wait);
+    storage.setWalAutocheckpoint(0);
+}
+
+void WalPolicy::start() {
+    if (running_.exchange(true)) return;
+    worker_ = std::thread([this] { run(); });
+}
+
+void WalPolicy::stop() {
+    {
+        std::lock_guard<std::mutex> lock(wake_mu_);
+        if (!running_.exchange(false)) return;
+    }
+    wake_cv_.notify_all();
+    if (worker_.joinable()) worker_.join();
+}
+
+void WalPolicy::run() {
+    std::unique_lock<std::mutex> lock(wake_mu_);
+    while (running_.load()) {
+        lock.unlock();
+        try {
+            poll();
+        } catch (const std::exception&) {
+            // The database may be briefly unavailable (e.g. being replaced by a restore); retry next poll
+        }
+        lock.lock();
+        wake_cv_.wait_for(lock, options_.poll, [this] { return !running_.load(); });
+    }
+}
+
+bool WalPolicy::poll() {
+    std::lock_guard<std::mutex> lock(mu_);
+    if (!db_) {
+        if (sqlite3_open_v2(db_path_.c_str(), &db_, SQLITE_OPEN_READWRITE, nullptr) != SQLITE_OK) {
+            sqlite3_close(db_);
+            db_ = nullptr;
+            throw std::runtime_error("failed to open sqlite database: " + db_path_);
+        }
+    }
+    const auto now = std::chrono::steady_clock::now();
+    sqlite3_stmt* st = nullptr;
+    int64_t version = data_version_;
+    if (sqlite3_prepare_v2(db_, "PRAGMA data_version", -1, &st, nullptr) == SQLITE_OK && sqlite3_step(st) == SQLITE_ROW) {
+        version = sqlite3_column_int64(st, 0);
+    }
+    sqlite3_finalize(st);
+    if (version != data_version_) {
+        data_version_ = version;
+        last_change_ = now;
+        dirty_ = true;
+    }
+    std::error_code ec;
+    const auto wal_bytes = std::filesystem::file_size(db_path_ + "-wal", ec);
+    stats_.wal_bytes = ec ? 0 : static_cast<uint64_t>(wal_bytes);
+
+    int mode = -1;
+    if (stats_.wal_bytes > options_.wal_budget_bytes) {
+        mode = SQLITE_CHECKPOINT_TRUNCATE;
+    } else if (dirty_ && now - last_change_ >= options_.idle_after) {
+        mode = SQLITE_CHECKPOINT_PASSIVE;
+    }
+    if (mode < 0) return false;
+
+    // TRUNCATE waits on the busy handler; PASSIVE never does
+    sqlite3_busy_timeout(db_, mode == SQLITE_CHECKPOINT_TRUNCATE ? static_cast<int>(options_.truncate_wait.count()) : 0);
+    int log = -1, backfilled = -1;
+    const auto t0 = std::chrono::steady_clock::now();
+    const int rc = sqlite3_wal_checkpoint_v2(db_, "main", mode, &log, &backfilled);
+    const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+    stats_.last_checkpoint_ms = ms;
+    stats_.max_checkpoint_ms = std::max(stats_.max_checkpoint_ms, ms);
+    stats_.total_checkpoint_ms += ms;
+    stats_.wal_pages = log;
+    if (rc == SQLITE_OK && log == backfilled) {
+        dirty_ = false;
+    } else {
+        ++stats_.busy_checkpoints;
+    }
+    if (mode == SQLITE_CHECKPOINT_TRUNCATE) {
+        ++stats_.truncate_checkpoints;
+        if (rc == SQLITE_OK) stats_.wal_bytes = 0;
+    } else {
+        ++stats_.passive_checkpoints;
+    }
+    return true;
+}
+
+WalStats WalPolicy::stats() const {
+    std::lock_guard<std::mutex> lock(mu_);
+    return stats_;
+}
+
+} // namespace verity
@@ -0,0 +1,300 @@
+#include "verity/write_behind.hpp"
+#include <future>
+#include <stdexcept>
+#include <string_view>
+#include <unordered_set>
+
+namespace verity {
+
+namespace {
+// Committed transactions applied per SQLite commit by the writer
+constexpr size_t kMaxTxnsPerCommit = 256;
+} // namespace
+
+// ---- MPSC queue ----
+
+void WriteBehindStorage::MpscQueue::push(Node* n) {
+    n->next.store(nullptr, std::memory_order_relaxed);
+    Node* prev = head_.exchange(n); // seq_cst: pairs with the writer's parked_ handshake
+    prev->next.store(n, std::memory_order_release);
+}
+
+WriteBehindStorage::Node* WriteBehindStorage::MpscQueue::pop() {
+    Node* tail = tail_;
+    Node* next = tail->next.load(std::memory_order_acquire);
+    if (tail == &stub_) {
+        if (!next) return nullptr;
+        tail_ = next;
+        tail = next;
+        next = next->next.load(std::memory_order_acquire);
+    }
+    if (next) {
+        tail_ = next;
+        return tail;
+    }
+    if (tail != head_.load()) return nullptr; // a producer has swapped head_ but not linked yet
+    push(&stub_);
+    next = tail->next.load(std::memory_order_acquire);
+    if (next) {
+        tail_ = next;
+        return tail;
+    }
+    return nullptr;
+}
+
+bool WriteBehindStorage::MpscQueue::idle() const { return tail_ == &stub_ && head_.load() == &stub_; }
+
+// ---- Construction / writer thread ----
+
+WriteBehindStorage::WriteBehindStorage(const std::string& db_path) : db_(std::make_unique<SqliteStorage>(db_path)) {
+    db_->scanKeyframes([this](const KeyframeRowView& row) {
+        scene_.insert(row.id, row.track_id, row.t_ms, row.value_json, row.interp);
+    });
+    diff_blobs_ = db_->storesDiffBlobs();
+    writer_ = std::thread([this] { writerLoop(); });
+}
+
+WriteBehindStorage::~WriteBehindStorage() {
+    {
+        std::lock_guard<std::mutex> lock(park_mu_);
+        stop_.store(true);
+    }
+    park_cv_.notify_one();
+    if (writer_.joinable()) writer_.join();
+}
+
+void WriteBehindStorage::enqueue(Node* n) {
+    queue_.push(n);
+    if (parked_.load()) {
+        std::lock_guard<std::mutex> lock(park_mu_);
+        park_cv_.notify_one();
+    }
+}
+
+void WriteBehindStorage::writerLoop() {
+    std::vector<Node*> batch;
+    batch.reserve(kMaxTxnsPerCommit);
+    for (;;) {
+        batch.clear();
+        while (batch.size() < kMaxTxnsPerCommit) {
+            Node* n = queue_.pop();
+            if (!n) break;
+            batch.push_back(n);
+        }
+        if (!batch.empty()) {
+            applyBatch(batch);
+            continue;
+        }
+        if (!queue_.idle()) {
+            std::this_thread::yield(); // producer mid-push
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(park_mu_);
+        if (stop_.load()) break;
+        parked_.store(true);
+        park_cv_.wait(lock, [this] { return !queue_.idle() || stop_.load(); });
+        parked_.store(false);
+    }
+}
+
+void WriteBehindStorage::applyBatch(std::vector<Node*>& nodes) {
+    auto fail = [this](std::exception_ptr e) {
+        std::lock_guard<std::mutex> lock(error_mu_);
+        if (!error_) error_ = e;
+        failed_.store(true);
+    };
+    bool open = false;
+    uint64_t applied = 0;
+    auto commit_open = [&] {
+        if (!open) return;
+        open = false;
+        try {
+            db_->commit();
+            commits_.fetch_add(1, std::memory_order_relaxed);
+            txns_written_.fetch_add(applied, std::memory_order_relaxed);
+        } catch (...) {
+            fail(std::current_exception());
+            try { db_->rollback(); } catch (...) {}
+        }
+        applied = 0;
+    };
+    for (Node* n : nodes) {
+        if (n->barrier) {
+            // Everything queued before the barrier must be committed before it is released
+            commit_open();
+            std::exception_ptr err;
+            if (failed_.load()) {
+                std::lock_guard<std::mutex> lock(error_mu_);
+                err = error_;
+            }
+            n->barrier(err);
+        } else if (!failed_.load()) {
+            try {
+                if (!open) {
+                    db_->begin();
+                    open = true;
+                }
+                db_->savepoint();
+                try {
+                    for (auto& op : n->ops) op(*db_);
+                    db_->releaseSavepoint();
+                    ++applied;
+                } catch (...) {
+                    // Keep the transactions already applied in this commit; drop this one and stop
+                    db_->rollbackToSavepoint();
+                    db_->releaseSavepoint();
+                    throw;
+                }
+            } catch (...) {
+                fail(std::current_exception());
+            }
+        }
+        delete n;
+    }
+    commit_open();
+}
+
+void WriteBehindStorage::throwIfFailed() const {
+    if (!failed_.load()) return;
+    std::lock_guard<std::mutex> lock(error_mu_);
+    std::rethrow_exception(error_);
+}
+
+void WriteBehindStorage::flush() {
+    auto done = std::make_shared<std::promise<void>>();
+    auto fut = done->get_future();
+    auto* n = new Node;
+    n->barrier = [done](std::exception_ptr e) {
+        if (e) done->set_exception(e);
+        else done->set_value();
+    };
+    enqueue(n);
+    fut.get();
+}
+
+// ---- Transactions (editing thread) ----
+
+void WriteBehindStorage::begin() {
+    throwIfFailed();
+    if (in_txn_) throw std::logic_error("write-behind transaction already open");
+    in_txn_ = true;
+    scene_.begin();
+}
+
+void WriteBehindStorage::commit() {
+    if (!in_txn_) throw std::logic_error("commit without an open transaction");
+    in_txn_ = false;
+    scene_.commit();
+    savepoints_.clear();
+    if (pending_.empty()) return;
+    auto* n = new Node;
+    n->ops = std::move(pending_);
+    pending_.clear();
+    enqueue(n);
+}
+
+void WriteBehindStorage::rollback() {
+    if (!in_txn_) return;
+    scene_.rollback();
+    pending_.clear();
+    savepoints_.clear();
+    in_txn_ = false;
+}
+
+void WriteBehindStorage::savepoint() {
+    savepoints_.push_back(pending_.size());
+    scene_.savepoint();
+}
+
+void WriteBehindStorage::releaseSavepoint() {
+    if (savepoints_.empty()) return;
+    savepoints_.pop_back();
+    scene_.releaseSavepoint();
+}
+
+void WriteBehindStorage::rollbackToSavepoint() {
+    if (savepoints_.empty()) return;
+    scene_.rollbackToSavepoint();
+    pending_.resize(savepoints_.back());
+}
+
+void WriteBehindStorage::addRevision(const RevisionRecord& r) {
+    emit([r](SqliteStorage& db) { db.addRevision(r); });
+}
+
+void WriteBehindStorage::emit(WriteOp op) {
+    if (in_txn_) {
+        pending_.push_back(std::move(op));
+        return;
+    }
+    // Outside begin/commit every call is its own transaction
+    throwIfFailed();
+    auto* n = new Node;
+    n->ops.push_back(std::move(op));
+    enqueue(n);
+}
+
+// ---- Keyframe mutations ----
+
+void WriteBehindStorage::insertKeyframe(const KeyId& key_id,
+                                        std::string_view track_id,
+                                        int t_ms,
+                                        std::string_view value_json,
+                                        std::string_view interp) {
+    // Mirror the primary-key check so failures surface synchronously, as with SqliteStorage
+    if (!scene_.insert(key_id.text(), track_id, t_ms, value_json, interp)) {
+        throw std::runtime_error("insert keyframe failed");
+    }
+    emit([key_id, track = std::string(track_id), t_ms, value = std::string(value_json),
+          interp = std::string(interp)](SqliteStorage& db) { db.insertKeyframe(key_id, track, t_ms, value, interp); });
+}
+
+void WriteBehindStorage::deleteKeyframe(const KeyId& key_id) {
+    if (!scene_.erase(key_id.text())) return;
+    emit([key_id](SqliteStorage& db) { db.deleteKeyframe(key_id); });
+}
+
+void WriteBehindStorage::updateKeyframeTime(const KeyId& key_id, int t_ms) {
+    if (!scene_.setTime(key_id.text(), t_ms)) return;
+    emit([key_id, t_ms](SqliteStorage& db) { db.updateKeyframeTime(key_id, t_ms); });
+}
+
+void WriteBehindStorage::insertKeyframes(const KeyframeBatch& rows) {
+    if (rows.empty()) return;
+    std::unordered_set<KeyId, KeyIdHash> seen;
+    seen.reserve(rows.size());
+    for (size_t i = 0; i < rows.size(); ++i) {
+        if (!seen.insert(rows.id(i)).second || scene_.contains(rows.id(i).text())) {
+            throw std::runtime_error("bulk insert keyframes failed");
+        }
+    }
+    for (size_t i = 0; i < rows.size(); ++i) {
+        scene_.insert(rows.id(i).text(), rows.trackId(i), rows.tMs(i), rows.valueJson(i), rows.interp(i));
+    }
+    emit([rows](SqliteStorage& db) { db.insertKeyframes(rows); });
+}
+
+void WriteBehindStorage::shiftKeyframes(const KeyIdList& ids, int delta_ms) {
+    if (ids.empty()) return;
+    for (const KeyId& key_id : ids) {
+        const KeyIdText id = key_id.text();
+        if (auto k = scene_.find(id)) scene_.setTime(id, k->t_ms + delta_ms);
+    }
+    emit([ids, delta_ms](SqliteStorage& db) { db.shiftKeyframes(ids, delta_ms); });
+}
+
+KeyframeBatch WriteBehindStorage::deleteKeyframes(const KeyIdList& ids) {
+    KeyframeBatch removed;
+    if (ids.empty()) return removed;
+    for (const KeyId& key_id : ids) {
+        const KeyIdText id = key_id.text();
+        auto k = scene_.find(id);
+        if (!k) continue;
+        removed.add(key_id, k->track_id, k->t_ms, k->value_json, k->interp);
+        scene_.erase(id);
+    }
+    emit([ids](SqliteStorage& db) { db.deleteKeyframes(ids); });
+    return removed;
+}
+
+} // namespace verity
@@ -1,11 +1,40 @@
 #include "commands/add_keyframe.hpp"
+#include "commands/bulk_keyframes.hpp"
 #include "commands/move_selection.hpp"
+#include "verity/autosave.hpp"
+#include "verity/checkpoint.hpp"
 #include "verity/command.hpp"
 #include "verity/db.hpp"
+#include "verity/diff_codec.hpp"
+#include "verity/engine.hpp"
+#include "verity/engine_cache.hpp"
+#include "verity/engine_loader.hpp"
+#include "verity/history_spill.hpp"
+#include "verity/json_scan.hpp"
+#include "verity/key_id.hpp"
+#include "verity/keyframe_cursor.hpp"
+#include "verity/net_effect_store.hpp"
+#include "verity/read_pool.hpp"
+#include "verity/replay.hpp"
+#include "verity/scene_index.hpp"
+#include "verity/snapshot_store.hpp"
+#include "verity/track_blob.hpp"
+#include "verity/wal_policy.hpp"
+#include "verity/write_behind.hpp"
+#include <atomic>
 #include <cassert>
+#include <chrono>
+#include <cmath>
 #include <filesystem>
+#include <memory_resource>
 #include <sqlite3.h>
+#include <stdexcept>
 #include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <unordered_set>
+#include <vector>
 
 using namespace verity;
 
@@ -27,7 +56,7 @@ static void prepare_db(const std::string& path) {
     exec(db, "CREATE TABLE projects(id TEXT PRIMARY KEY, name TEXT, version INTEGER, created_at INTEGER, updated_at INTEGER);");
     exec(db, "CREATE TABLE tracks(id TEXT PRIMARY KEY, scene_id TEXT, name TEXT, kind TEXT, created_at INTEGER, updated_at INTEGER);");
     exec(db, "CREATE TABLE keyframes(id TEXT PRIMARY KEY, track_id TEXT NOT NULL, t_ms INTEGER NOT NULL, value_json TEXT NOT NULL, interp TEXT NOT NULL, created_at INTEGER, updated_at INTEGER);");
-    exec(db, "CREATE TABLE revisions(id INTEGER PRIMARY KEY AUTOINCREMENT, project_id TEXT, user TEXT, label TEXT, diff_json TEXT, created_at INTEGER);");
+    exec(db, "CREATE TABLE revisions(id INTEGER PRIMARY KEY AUTOINCREMENT, project_id TEXT, user TEXT, label TEXT, diff_json TEXT, created_at INTEGER, diff_blob BLOB);");
     exec(db, "INSERT INTO projects(id,name,version,created_at,updated_at) VALUES('proj','Test',1,0,0);");
     exec(db, "INSERT INTO tracks(id,scene_id,name,kind,created_at,updated_at) VALUES('track1','scene','T','curve',0,0);");
     sqlite3_close(db);
@@ -62,13 +91,27 @@ static std::string get_first_key(sqlite3* db) {
     return id;
 }
 
+// Counts bytes handed out, to check where a command's payload is allocated
+struct CountingResource : std::pmr::memory_resource {
+    size_t bytes {0};
+    void* do_allocate(size_t n, size_t align) override {
+        bytes += n;
+        return std::pmr::new_delete_resource()->allocate(n, align);
+    }
+    void do_deallocate(void* p, size_t n, size_t align) override { std::pmr::new_delete_resource()->deallocate(p, n, align); }
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+};
+
 int main() {
     namespace fs = std::filesystem;
+    fs::remove_all("test_tmp");
     fs::create_directories("test_tmp");
     std::string dbpath = "test_tmp/test.db";
     prepare_db(dbpath);
 
     SqliteStorage storage(dbpath);
+    SceneIndex scene;
+    storage.attachSceneIndex(&scene);
     CommandStack stack(storage);
 
     // Add keyframe
@@ -104,6 +147,838 @@ int main() {
     // Revisions recorded (one for add, one for move)
     assert(count(db, "revisions") >= 2);
 
+    // Cached statements are reset after a failed step and stay usable
+    storage.begin();
+    storage.insertKeyframe(KeyId::fromText("dup"), "track9", 10, "{\"x\":0}", "auto");
+    bool threw = false;
+    try {
+        storage.insertKeyframe(KeyId::fromText("dup"), "track9", 20, "{\"x\":0}", "auto");
+    } catch (const std::runtime_error&) {
+        threw = true;
+    }
+    assert(threw);
+    storage.insertKeyframe(KeyId::fromText("dup2"), "track9", 30, "{\"x\":0}", "auto");
+    storage.rollback();
+    assert(count(db, "keyframes") == 0 && scene.keyCount() == 0);
+
+    // Bulk commands: set-based insert/move/delete with set-based undo
+    {
+        KeyframeBatch rows;
+        KeyIdList half;
+        for (int i = 0; i < 1000; ++i) {
+            const std::string id = "bk" + std::to_string(i);
+            rows.add(id, "btrack" + std::to_string(i % 10), i * 10, "{\"x\":" + std::to_string(i) + "}", "auto");
+            if (i % 2 == 0) half.push_back(KeyId::fromText(id));
+        }
+        assert(rows.size() == 1000 && rows.trackId(13) == "btrack3");
+        stack.execute(std::make_unique<BulkInsertKeyframesCommand>(std::move(rows)));
+        assert(count(db, "keyframes") == 1000);
+        stack.execute(std::make_unique<BulkMoveKeyframesCommand>(half, 5));
+        assert(get_t(db, "bk10") == 105 && get_t(db, "bk11") == 110);
+        stack.execute(std::make_unique<BulkDeleteKeyframesCommand>(half));
+        assert(count(db, "keyframes") == 500 && scene.keyCount() == 500 && scene.trackTimes("btrack1").size() == 100);
+        stack.undo(); // delete
+        assert(count(db, "keyframes") == 1000 && get_t(db, "bk10") == 105);
+        stack.undo(); // move
+        assert(get_t(db, "bk10") == 100);
+        stack.undo(); // insert
+        assert(count(db, "keyframes") == 0 && scene.keyCount() == 0);
+
+        // Bulk diffs replay through the revision parser
+        KeyframeBatch two;
+        two.add("r\"1", "t", 1, "{\"x\":{\"y\":[1,2]}}", "auto");
+        two.add("r2", "t", 2, "{}", "auto");
+        BulkInsertKeyframesCommand ins(std::move(two));
+        restore_from_revisions(stack, storage, {RevisionRecord{"BulkInsertKeyframes", *ins.diffJson()},
+                                                RevisionRecord{"BulkMoveKeyframes", R"({"op":"bulk_move","delta":7,"ids":["r\"1"]})"}});
+        assert(count(db, "keyframes") == 2 && get_t(db, "r\"1") == 8);
+        stack.undo();
+        stack.undo();
+        assert(count(db, "keyframes") == 0);
+    }
+
+    // Revision parser and one-transaction replay: revisions are applied, not re-written
+    {
+        const char* legacy_move = R"({"op":"move","delta":50,"items":[{\"id\":\"rk1\",\"orig_t_ms\":1000}]})";
+        auto legacy = command_from_diff(legacy_move);
+        assert(legacy && *legacy->diffJson() == R"({"op":"move","delta":50,"items":[{"id":"rk1","orig_t_ms":1000}]})");
+        assert(!command_from_diff(R"({"op":"rotate"})") && !command_from_diff(R"({"op":"add_key",)"));
+
+        CompositeCommand batch("Paste \"2\"", {});
+        assert(!batch.diffJson());
+        const int revs = count(db, "revisions");
+        std::vector<RevisionRecord> log = {
+            {"AddKeyframe", R"({"op":"add_key","track_id":"rt","t_ms":1000,"id":"rk1","interp":"auto","value_json":"{\"x\":1}"})"},
+            {"MoveSelection", legacy_move},
+            {"Paste", R"({"op":"batch","label":"Paste \"2\"","items":[)"
+                      R"({"op":"add_key","track_id":"rt","t_ms":5,"id":"rk\u00e92","interp":"auto","value_json":"{}"},)"
+                      R"({"op":"bulk_move","delta":3,"ids":["rk1","rk\u00e92"]}]})"},
+            {"Rotate", R"({"op":"rotate"})"},
+            // Corrupted rows: a malformed move item or an unparsable child rejects the whole revision
+            {"Paste", R"({"op":"batch","label":"Bad","items":[)"
+                      R"({"op":"add_key","track_id":"rt","t_ms":9,"id":"rk3","interp":"auto","value_json":"{}"},)"
+                      R"({"op":"rotate"}]})"},
+            {"Paste", R"({"op":"batch","label":"Bad","items":[)"
+                      R"({"op":"add_key","track_id":"rt","t_ms":9,"id":"rk4","interp":"auto","value_json":"{}"},)"
+                      R"({"op":"move","delta":1,"items":[7]}]})"},
+            {"MoveSelection", R"({"op":"move","delta":1,"items":[{"orig_t_ms":1000}]})"},
+        };
+        const ReplayResult r = replay_revisions(stack, storage, log);
+        assert(r.revisions == 7 && r.commands == 3 && r.skipped == 4);
+        assert(count(db, "revisions") == revs && count(db, "keyframes") == 2);
+        assert(get_t(db, "rk1") == 1053 && get_t(db, "rk\xc3\xa9" "2") == 8);
+        assert(scene.find("rk1")->value_json == "{\"x\":1}");
+        stack.undo(); // batch
+        assert(count(db, "keyframes") == 1 && get_t(db, "rk1") == 1050);
+        stack.undo();
+        stack.undo();
+        assert(count(db, "keyframes") == 0);
+    }
+
+    // Binary diffs: new revisions are blobs that decode to the same commands; JSON stays available
+    {
+        assert(storage.storesDiffBlobs());
+        const int keys = count(db, "keyframes");
+        const std::string uuid = "0123abcd-4567-89ef-0123-456789abcdef";
+        const std::string value = "{\"x\":\"a\\\"b\"}";
+        stack.execute(std::make_unique<AddKeyframeCommand>("dtrack", 40, value, "auto", uuid));
+        std::vector<std::pair<std::string, int>> dsel = {{uuid, 40}};
+        stack.execute(std::make_unique<MoveSelectionCommand>(dsel, -15));
+        const auto rows = storage.readRevisions();
+        const RevisionRecord add_rev = rows[rows.size() - 2];
+        const RevisionRecord move_rev = rows.back();
+        assert(add_rev.diff_json.empty() && is_diff_blob(add_rev.diff_blob));
+        const std::string add_json = *AddKeyframeCommand("dtrack", 40, value, "auto", uuid).diffJson();
+        assert(*revision_diff_json(add_rev) == add_json && add_rev.diff_blob.size() * 2 < add_json.size());
+        assert(revision_diff_json(move_rev)->find("\"delta\":-15") != std::string::npos);
+
+        KeyframeBatch kb;
+        kb.add(uuid, "dt", -5, "{}", "linear");
+        kb.add("dk2", "dt", 1000000, "{\"v\":1}", "linear");
+        KeyIdList dids;
+        dids.push_back(KeyId::fromText(uuid));
+        dids.push_back(KeyId::fromText("dk2"));
+        std::vector<std::unique_ptr<ICommand>> parts;
+        parts.push_back(std::make_unique<BulkInsertKeyframesCommand>(std::move(kb)));
+        parts.push_back(std::make_unique<BulkMoveKeyframesCommand>(dids, 3));
+        parts.push_back(std::make_unique<BulkDeleteKeyframesCommand>(dids));
+        CompositeCommand paste("Paste", std::move(parts));
+        DiffWriter writer;
+        assert(paste.encodeDiff(writer));
+        const std::string blob(writer.finish());
+        auto decoded = command_from_blob(blob);
+        assert(decoded && *decoded->diffJson() == *paste.diffJson());
+        assert(!command_from_blob(std::string_view(blob).substr(0, blob.size() - 1)) && !command_from_blob("{}"));
+
+        stack.undo();
+        stack.undo();
+        assert(!scene.contains(uuid));
+        const ReplayResult r = replay_revisions(stack, storage, {add_rev, move_rev});
+        assert(r.commands == 2 && get_t(db, uuid) == 25);
+        stack.undo();
+        stack.undo();
+        assert(count(db, "keyframes") == keys);
+
+        // Projects without migration V0003 keep writing JSON rows
+        sqlite3* ldb = nullptr;
+        assert(sqlite3_open("test_tmp/legacy.db", &ldb) == SQLITE_OK);
+        exec(ldb, "CREATE TABLE projects(id TEXT PRIMARY KEY, name TEXT, version INTEGER, created_at INTEGER, updated_at INTEGER);");
+        exec(ldb, "CREATE TABLE keyframes(id TEXT PRIMARY KEY, track_id TEXT NOT NULL, t_ms INTEGER NOT NULL, value_json TEXT NOT NULL, interp TEXT NOT NULL, created_at INTEGER, updated_at INTEGER);");
+        exec(ldb, "CREATE TABLE revisions(id INTEGER PRIMARY KEY AUTOINCREMENT, project_id TEXT, user TEXT, label TEXT, diff_json TEXT, created_at INTEGER);");
+        sqlite3_close(ldb);
+        SqliteStorage legacy("test_tmp/legacy.db");
+        CommandStack ls(legacy);
+        assert(!legacy.storesDiffBlobs());
+        ls.execute(std::make_unique<AddKeyframeCommand>("lt", 1, "{}", "auto", "lk"));
+        const auto lrows = legacy.readRevisions();
+        assert(lrows.size() == 1 && lrows[0].diff_blob.empty() && lrows[0].diff_json.find("add_key") != std::string::npos);
+    }
+
+    // Checkpoints: restore loads the newest one and replays only later revisions; compaction squashes
+    // the log up to a checkpoint into one summary row
+    {
+        stack.execute(std::make_unique<AddKeyframeCommand>("cp", 10, "{}", "auto", "cp1"));
+        stack.execute(std::make_unique<AddKeyframeCommand>("cp", 20, "{}", "auto", "cp2"));
+        CheckpointScheduler checkpoints(stack, storage, 3, std::chrono::hours(1), true);
+        const int64_t first = checkpoints.poll();
+        assert(first > 0 && checkpoints.poll() == 0 && count(db, "revisions") == 1);
+        assert(storage.readRevisions()[0].diff_json.find("\"op\":\"checkpoint\"") != std::string::npos);
+        std::vector<std::pair<std::string, int>> sel2 = {{"cp2", 20}};
+        stack.execute(std::make_unique<MoveSelectionCommand>(sel2, 10));
+        assert(checkpoints.poll() == 0);
+        stack.execute(std::make_unique<AddKeyframeCommand>("cp", 40, "{}", "auto", "cp3"));
+        stack.execute(std::make_unique<AddKeyframeCommand>("cp", 50, "{}", "auto", "cp4"));
+        const int64_t second = checkpoints.poll();
+        assert(second > first && count(db, "revisions") == 1 && count(db, "checkpoint_keyframes") == 4);
+        std::vector<std::pair<std::string, int>> sel1 = {{"cp1", 10}};
+        stack.execute(std::make_unique<MoveSelectionCommand>(sel1, 5));
+
+        exec(db, "VACUUM INTO 'test_tmp/restore.db';");
+        {
+            sqlite3* rdb = nullptr;
+            assert(sqlite3_open("test_tmp/restore.db", &rdb) == SQLITE_OK);
+            exec(rdb, "DELETE FROM keyframes;");
+            sqlite3_close(rdb);
+            SqliteStorage restored("test_tmp/restore.db");
+            CommandStack rs(restored);
+            const ReplayResult r = restore_latest(rs, restored);
+            assert(r.checkpoint_id == second && r.revisions == 1 && r.commands == 1);
+            sqlite3* rdb2 = nullptr;
+            assert(sqlite3_open("test_tmp/restore.db", &rdb2) == SQLITE_OK);
+            assert(count(rdb2, "keyframes") == 4 && get_t(rdb2, "cp1") == 15 && get_t(rdb2, "cp2") == 30);
+            rs.undo(); // only the tail is undoable
+            assert(get_t(rdb2, "cp1") == 10 && !rs.canUndo());
+            sqlite3_close(rdb2);
+        }
+        // A zero revision count and a zero interval both disable their trigger in poll()
+        CheckpointScheduler manual(stack, storage, 0, std::chrono::seconds(0));
+        assert(manual.poll() == 0 && count(db, "revisions") == 2);
+        for (int i = 0; i < 6; ++i) stack.undo();
+        assert(count(db, "keyframes") == 0);
+    }
+
+    // Group commit: edits share one transaction until flushed; a failing edit rolls back alone
+    {
+        const int revs = count(db, "revisions");
+        stack.setGroupCommitWindow(std::chrono::hours(1));
+        stack.execute(std::make_unique<AddKeyframeCommand>("gtrack", 1, "{}", "auto", "g1"));
+        stack.execute(std::make_unique<AddKeyframeCommand>("gtrack", 2, "{}", "auto", "g2"));
+        bool dup = false;
+        try {
+            stack.execute(std::make_unique<AddKeyframeCommand>("gtrack", 3, "{}", "auto", "g1"));
+        } catch (const std::runtime_error&) {
+            dup = true;
+        }
+        assert(dup);
+        stack.pollGroupCommit();
+        assert(count(db, "keyframes") == 0); // other connection sees nothing yet
+        stack.flush();
+        assert(count(db, "keyframes") == 2 && count(db, "revisions") == revs + 2);
+        stack.undo();
+        stack.undo();
+        stack.setGroupCommitWindow(std::chrono::milliseconds(0));
+        assert(count(db, "keyframes") == 0);
+    }
+
+    // Coalescing: a 120-step drag is one undo entry and one revision, written when the run ends
+    {
+        const int revs = count(db, "revisions");
+        stack.execute(std::make_unique<AddKeyframeCommand>("ctrack", 100, "{}", "auto", "c1"));
+        stack.setCoalesceWindow(std::chrono::hours(1));
+        for (int t = 100; t < 220; ++t) {
+            std::vector<std::pair<std::string, int>> step = {{"c1", t}};
+            stack.execute(std::make_unique<MoveSelectionCommand>(step, 1));
+        }
+        assert(scene.find("c1")->t_ms == 220 && count(db, "revisions") == revs + 1);
+        stack.flush();
+        assert(count(db, "revisions") == revs + 2 && get_t(db, "c1") == 220);
+        assert(revision_diff_json(storage.readRevisions().back())->find("\"delta\":120") != std::string::npos);
+        stack.undo(); // the whole drag
+        assert(get_t(db, "c1") == 100);
+        stack.redo();
+        assert(get_t(db, "c1") == 220);
+
+        // A different selection starts a new run; an idle run is committed by pollGroupCommit()
+        stack.execute(std::make_unique<AddKeyframeCommand>("ctrack", 500, "{}", "auto", "c2"));
+        stack.setCoalesceWindow(std::chrono::milliseconds(1));
+        KeyIdList both;
+        both.push_back(KeyId::fromText("c1"));
+        both.push_back(KeyId::fromText("c2"));
+        stack.execute(std::make_unique<BulkMoveKeyframesCommand>(both, 5));
+        stack.execute(std::make_unique<BulkMoveKeyframesCommand>(both, 5));
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        stack.pollGroupCommit();
+        assert(get_t(db, "c1") == 230 && get_t(db, "c2") == 510);
+        stack.setCoalesceWindow(std::chrono::milliseconds(0));
+        while (stack.canUndo() && count(db, "keyframes") > 0) stack.undo();
+        assert(scene.keyCount() == 0);
+    }
+
+    // History budget: older undo/redo entries spill to disk and are rebuilt when reached
+    {
+        const int keys = count(db, "keyframes");
+        const AddKeyframeCommand probe("htrack", 0, std::string(200, 'v'), "auto", "hp");
+        assert(probe.memoryBytes() >= sizeof(probe) + 200);
+        HistorySpill spill("test_tmp/history.spill");
+        CommandStack hs(storage);
+        hs.setHistoryBudget(1, &spill, command_from_blob); // only the newest undo entry stays resident
+        KeyframeBatch hrows;
+        KeyIdList hids;
+        for (int i = 0; i < 50; ++i) {
+            hrows.add("h" + std::to_string(i), "htrack", i * 10, "{}", "auto");
+            if (i % 2 == 0) hids.push_back(KeyId::fromText("h" + std::to_string(i)));
+        }
+        hs.execute(std::make_unique<BulkInsertKeyframesCommand>(std::move(hrows)));
+        hs.execute(std::make_unique<BulkMoveKeyframesCommand>(hids, 7));
+        hs.execute(std::make_unique<BulkDeleteKeyframesCommand>(hids));
+        std::vector<std::pair<std::string, int>> hsel = {{"h1", 10}};
+        hs.execute(std::make_unique<MoveSelectionCommand>(hsel, 5));
+        assert(hs.spilledEntries() == 3 && spill.liveRecords() == 3 && hs.historyBytes() > 0);
+        hs.undo(); // move
+        hs.undo(); // delete, rebuilt with the rows it removed
+        assert(count(db, "keyframes") == keys + 50 && get_t(db, "h0") == 7 && get_t(db, "h1") == 10);
+        hs.undo();
+        hs.undo();
+        assert(count(db, "keyframes") == keys && !hs.canUndo() && hs.spilledEntries() == 4);
+        for (int i = 0; i < 4; ++i) hs.redo();
+        assert(count(db, "keyframes") == keys + 25 && get_t(db, "h1") == 15);
+        hs.undo();
+        hs.undo();
+        hs.execute(std::make_unique<AddKeyframeCommand>("htrack", 1, "{}", "auto", "hx")); // drops redo
+        assert(!hs.canRedo() && spill.liveRecords() == hs.spilledEntries());
+        while (hs.canUndo()) hs.undo();
+        assert(count(db, "keyframes") == keys && spill.liveRecords() == hs.spilledEntries());
+    }
+
+    // Multi-step undo/redo: one transaction per jump, keyframe edits folded per key first
+    {
+        const int keys = count(db, "keyframes");
+        const int revs = count(db, "revisions");
+        stack.execute(std::make_unique<AddKeyframeCommand>("jt", 100, "{}", "auto", "j1"));
+        const size_t base = stack.historyPosition();
+        for (int i = 0; i < 40; ++i) {
+            std::vector<std::pair<std::string, int>> jsel = {{"j1", 100 + i * 5}};
+            stack.execute(std::make_unique<MoveSelectionCommand>(jsel, 5));
+        }
+        KeyIdList j2;
+        j2.push_back(KeyId::fromText("j2"));
+        stack.execute(std::make_unique<AddKeyframeCommand>("jt", 7, "{}", "auto", "j2"));
+        stack.execute(std::make_unique<BulkMoveKeyframesCommand>(j2, 3));
+        stack.execute(std::make_unique<BulkDeleteKeyframesCommand>(j2));
+        const size_t top = stack.historyPosition();
+        assert(get_t(db, "j1") == 300 && count(db, "keyframes") == keys + 1);
+        assert(stack.undoN(top - base) == top - base && stack.historyPosition() == base);
+        assert(get_t(db, "j1") == 100 && count(db, "keyframes") == keys + 1 && scene.find("j1")->t_ms == 100);
+        assert(stack.redoN(1000) == top - base && get_t(db, "j1") == 300 && !scene.contains("j2"));
+        assert(stack.jumpTo(base + 20) == top - base - 20 && get_t(db, "j1") == 200);
+        assert(count(db, "revisions") == revs + int(top - base + 1));
+
+        NetEffectStore net(storage);
+        KeyIdList j1;
+        j1.push_back(KeyId::fromText("j1"));
+        net.shiftKeyframes(j1, 5);
+        net.shiftKeyframes(j1, -5);
+        KeyIdList j3;
+        j3.push_back(KeyId::fromText("j3"));
+        net.insertKeyframe(KeyId::fromText("j3"), "jt", 1, "{}", "auto");
+        assert(net.deleteKeyframes(j3).size() == 1);
+        assert(net.pendingKeys() == 0 && net.editsSeen() == 4);
+        net.updateKeyframeTime(KeyId::fromText("j1"), 10);
+        net.updateKeyframeTime(KeyId::fromText("j1"), 20);
+        net.apply();
+        assert(net.keysWritten() == 1 && get_t(db, "j1") == 20);
+        net.updateKeyframeTime(KeyId::fromText("j1"), 200);
+        net.apply();
+
+        stack.jumpTo(base - 1);
+        assert(count(db, "keyframes") == keys && stack.canRedo());
+
+        // A failing jump (j1 re-added behind the stack's back) rolls back and keeps every entry
+        storage.begin();
+        storage.insertKeyframe(KeyId::fromText("j1"), "jt", 1, "{}", "auto");
+        storage.commit();
+        bool jump_threw = false;
+        try {
+            stack.redoN(5);
+        } catch (const std::exception&) {
+            jump_threw = true;
+        }
+        assert(jump_threw && stack.historyPosition() == base - 1 && get_t(db, "j1") == 1);
+        storage.begin();
+        storage.deleteKeyframes(j1);
+        storage.commit();
+        assert(stack.redoN(1000) == top - base + 1 && get_t(db, "j1") == 300);
+        stack.jumpTo(base - 1);
+        assert(count(db, "keyframes") == keys && stack.canRedo());
+    }
+
+    // Scene index: follows edits, undo and rollback incrementally and matches a fresh load
+    {
+        stack.execute(std::make_unique<AddKeyframeCommand>("strack", 300, "{\"x\":3}", "auto", "s3"));
+        stack.execute(std::make_unique<AddKeyframeCommand>("strack", 100, "{\"x\":1,\"out\":2}", "auto", "s1"));
+        stack.execute(std::make_unique<AddKeyframeCommand>("strack", 200, "{\"x\":2}", "auto", "s2"));
+        stack.execute(std::make_unique<AddKeyframeCommand>("other", 150, "{}", "bezier", "o1"));
+        assert(scene.keyCount() == 4 && scene.trackIds() == std::vector<std::string_view>({"other", "strack"}));
+        assert(scene.trackTimes("strack") == std::vector<int32_t>({100, 200, 300}));
+        std::string seen;
+        scene.forEachInRange("strack", 100, 300, [&](const SceneIndex::KeyRef& k) { seen += std::string(k.id) + ","; });
+        assert(seen == "s1,s2,");
+
+        std::vector<std::pair<std::string, int>> sel1 = {{"s1", 100}};
+        stack.execute(std::make_unique<MoveSelectionCommand>(sel1, 250));
+        assert(scene.trackTimes("strack") == std::vector<int32_t>({200, 300, 350}) && scene.find("s1")->t_ms == 350);
+        stack.undo();
+        assert(scene.trackTimes("strack") == std::vector<int32_t>({100, 200, 300}));
+
+        std::vector<Key> keys;
+        assert(scene.buildEngineKeys("strack", keys) == 0 && keys.size() == 3);
+        assert(keys[0].time == 100.f && keys[0].value == 1.f && keys[0].outTan == 2.f && keys[2].value == 3.f);
+        assert(scene.buildEngineKeys("other", keys) == 1 && keys.size() == 1);
+
+        storage.begin();
+        storage.deleteKeyframe(KeyId::fromText("s2"));
+        storage.updateKeyframeTime(KeyId::fromText("s3"), 50);
+        storage.savepoint();
+        storage.insertKeyframe(KeyId::fromText("s4"), "strack", 400, "{}", "auto");
+        storage.rollbackToSavepoint();
+        storage.releaseSavepoint();
+        assert(!scene.contains("s4") && scene.trackTimes("strack") == std::vector<int32_t>({50, 100}));
+        storage.rollback();
+        assert(scene.find("s2")->value_json == "{\"x\":2}");
+        assert(scene.trackTimes("strack") == std::vector<int32_t>({100, 200, 300}));
+
+        SqliteStorage other(dbpath);
+        SceneIndex reloaded;
+        other.attachSceneIndex(&reloaded);
+        assert(reloaded.keyCount() == scene.keyCount() && reloaded.trackTimes("strack") == scene.trackTimes("strack"));
+        assert(reloaded.find("o1")->interp == "bezier");
+
+        for (int i = 0; i < 4; ++i) stack.undo();
+        assert(scene.keyCount() == 0 && scene.trackTimes("strack").empty() && count(db, "keyframes") == 0);
+    }
+
+    // Engine snapshot in the package stays valid until a keyframe changes
+    int curve = createCurve(CurveKind::Hermite);
+    setKeys(curve, std::vector<Key>{{0.f, 0.f, 0.f, 1.f}, {1.f, 1.f, 1.f, 0.f}});
+    assert(!loadEngineSnapshot(storage));
+    saveEngineSnapshot(storage);
+    assert(fs::exists(engineSnapshotPath(storage)));
+    assert(loadEngineSnapshot(storage));
+    assert(evaluate(curve, 0.5f) > 0.49f && evaluate(curve, 0.5f) < 0.51f);
+    stack.execute(std::make_unique<AddKeyframeCommand>("track1", 2000, "{\"x\":2}", "auto", "key2"));
+    assert(!loadEngineSnapshot(storage));
+    // Undo and redo write no revision but still invalidate it; a rolled-back edit does not
+    saveEngineSnapshot(storage);
+    const int64_t snap_rev = storage.latestRevisionId();
+    stack.undo();
+    assert(storage.latestRevisionId() == snap_rev && !loadEngineSnapshot(storage));
+    saveEngineSnapshot(storage);
+    stack.redo();
+    assert(!loadEngineSnapshot(storage));
+    saveEngineSnapshot(storage);
+    storage.begin();
+    storage.updateKeyframeTime(KeyId::fromText("key2"), 2500);
+    storage.rollback();
+    assert(loadEngineSnapshot(storage));
+    {
+        SqliteStorage reopened(dbpath);
+        assert(loadEngineSnapshot(reopened));
+    }
+
+    // value_json scanner: numeric members only, nested/string members skipped
+    double sx = 0, sy = 0;
+    int fields = 0;
+    assert(scan_numeric_fields(R"({"x": -1.5e1, "tag":"a\"}", "n":{"q":[1,2]}, "y":2})",
+                               [&](std::string_view name, double v) {
+                                   ++fields;
+                                   if (name == "x") sx = v;
+                                   if (name == "y") sy = v;
+                               }));
+    assert(fields == 2 && sx == -15.0 && sy == 2.0);
+    assert(!scan_numeric_fields("{\"x\":", [](std::string_view, double) {}));
+
+    // Bulk loader: one Hermite curve per track with >= 2 keys (key1 was undone, key2 remains)
+    stack.execute(std::make_unique<AddKeyframeCommand>("track1", 3000, "{\"x\":4,\"out\":0}", "auto", "key3"));
+    auto loaded = load_engine_curves(storage);
+    assert(loaded.rows == 2 && loaded.malformed_rows == 0);
+    assert(loaded.curves.size() == 1 && loaded.curves[0].track_id == "track1" && loaded.curves[0].key_count == 2);
+    assert(evaluate(loaded.curves[0].curve_id, 2000.f) == 2.f);
+    assert(evaluate(loaded.curves[0].curve_id, 3000.f) == 4.f);
+
+    // Write-behind storage: edits land in the model at once and in the database after flush();
+    // a failed background write is rethrown from flush() and poisons later edits
+    {
+        WriteBehindStorage wb(dbpath);
+        const size_t base = wb.keyframeCount();
+        assert(base == 2 && wb.scene().contains("key3"));
+        CommandStack ws(wb);
+        ws.execute(std::make_unique<AddKeyframeCommand>("wtrack", 1, "{}", "auto", "w1"));
+        ws.execute(std::make_unique<AddKeyframeCommand>("wtrack", 2, "{}", "auto", "w2"));
+        bool dup = false;
+        try {
+            ws.execute(std::make_unique<AddKeyframeCommand>("wtrack", 3, "{}", "auto", "w1"));
+        } catch (const std::runtime_error&) {
+            dup = true;
+        }
+        assert(dup && wb.keyframeCount() == base + 2);
+        KeyIdList both;
+        both.push_back(KeyId::fromText("w1"));
+        both.push_back(KeyId::fromText("w2"));
+        ws.execute(std::make_unique<BulkMoveKeyframesCommand>(both, 10));
+        assert(wb.scene().find("w1")->t_ms == 11);
+        ws.undo();
+        assert(wb.scene().find("w1")->t_ms == 1);
+        wb.flush();
+        assert(count(db, "keyframes") == int(base) + 2 && get_t(db, "w1") == 1);
+        assert(wb.transactionsWritten() >= 4 && wb.sqliteCommits() <= wb.transactionsWritten());
+
+        storage.insertKeyframe(KeyId::fromText("w3"), "wtrack", 3, "{}", "auto"); // behind the model's back
+        ws.execute(std::make_unique<AddKeyframeCommand>("wtrack", 3, "{}", "auto", "w3"));
+        bool surfaced = false;
+        try {
+            wb.flush();
+        } catch (const std::runtime_error&) {
+            surfaced = true;
+        }
+        assert(surfaced);
+        surfaced = false;
+        try {
+            ws.execute(std::make_unique<AddKeyframeCommand>("wtrack", 4, "{}", "auto", "w4"));
+        } catch (const std::runtime_error&) {
+            surfaced = true;
+        }
+        assert(surfaced);
+    }
+
+    // Autosave: online backup into rotating slots, skipped while the revision log is unchanged
+    {
+        fs::create_directories("test_tmp/proj");
+        prepare_db("test_tmp/proj/project.db");
+        AutosaveScheduler autosave("test_tmp/proj", std::chrono::hours(1), 2);
+        autosave.setBackupPacing(1, std::chrono::milliseconds(0));
+        assert(autosave.snapshotIfChanged() && !autosave.snapshotIfChanged() && autosave.snapshotsSkipped() == 1);
+        {
+            SqliteStorage ps("test_tmp/proj/project.db");
+            CommandStack pstack(ps);
+            for (int i = 0; i < 3; ++i) {
+                pstack.execute(std::make_unique<AddKeyframeCommand>("at", i, "{}", "auto", "a" + std::to_string(i)));
+                assert(autosave.snapshotIfChanged());
+            }
+        }
+        int files = 0;
+        for (const auto& e : fs::directory_iterator("test_tmp/proj/snapshots")) files += e.path().extension() == ".db";
+        assert(files == 2 && autosave.snapshotsWritten() == 4);
+        sqlite3* sdb = nullptr;
+        assert(sqlite3_open(autosave.lastSnapshot().c_str(), &sdb) == SQLITE_OK);
+        assert(count(sdb, "keyframes") == 3 && count(sdb, "revisions") == 3);
+        sqlite3_close(sdb);
+        const auto started = std::chrono::steady_clock::now();
+        autosave.start();
+        autosave.stop(); // no wait for the hour-long interval
+        assert(std::chrono::steady_clock::now() - started < std::chrono::seconds(5));
+        assert(autosave.snapshotsWritten() == 4);
+    }
+
+    // Incremental autosave: content-addressed chunks shared between snapshots, manifests per snapshot
+    {
+        assert(sha256_hex("abc", 3) == "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
+        fs::create_directories("test_tmp/proj2");
+        prepare_db("test_tmp/proj2/project.db");
+        AutosaveScheduler autosave("test_tmp/proj2", std::chrono::hours(1), 2);
+        autosave.setIncremental(4096);
+        assert(autosave.snapshotNow());
+        const SnapshotStats first = autosave.lastIncremental();
+        assert(first.chunks > 1 && first.new_chunks > 0 && first.new_chunks <= first.chunks);
+        {
+            SqliteStorage ps("test_tmp/proj2/project.db"); // open while snapshotting: WAL must be folded in
+            CommandStack pstack(ps);
+            for (int i = 0; i < 3; ++i) {
+                pstack.execute(std::make_unique<AddKeyframeCommand>("it", i, "{}", "auto", "i" + std::to_string(i)));
+                assert(autosave.snapshotIfChanged());
+                const SnapshotStats s = autosave.lastIncremental();
+                assert(s.new_chunks < s.chunks); // unchanged chunks are not written again
+            }
+            assert(!autosave.snapshotIfChanged());
+        }
+        SnapshotStore store("test_tmp/proj2/snapshots");
+        const auto names = store.list();
+        assert(names.size() == 2 && names.back() == autosave.lastSnapshot() && store.revisionOf(names.back()) == 3);
+        store.restore(names.back(), "test_tmp/restored.db");
+        sqlite3* rdb = nullptr;
+        assert(sqlite3_open("test_tmp/restored.db", &rdb) == SQLITE_OK);
+        assert(count(rdb, "keyframes") == 3 && count(rdb, "revisions") == 3);
+        sqlite3_close(rdb);
+        store.remove(names.front());
+        store.remove(names.back());
+        assert(store.collectGarbage() > 0 && store.list().empty());
+        bool threw = false;
+        try {
+            store.restore(names.back(), "test_tmp/restored2.db");
+        } catch (const std::runtime_error&) {
+            threw = true;
+        }
+        assert(threw && !fs::exists("test_tmp/restored2.db"));
+    }
+
+    // WAL policy: TRUNCATE over the budget, PASSIVE once commits go idle
+    {
+        prepare_db("test_tmp/wal.db");
+        SqliteStorage ws("test_tmp/wal.db");
+        WalPolicyOptions opt;
+        opt.idle_after = std::chrono::milliseconds(0);
+        opt.wal_budget_bytes = 64 * 1024;
+        WalPolicy policy("test_tmp/wal.db", opt);
+        policy.configure(ws);
+        CommandStack wstack(ws);
+        for (int i = 0; i < 200; ++i) {
+            wstack.execute(std::make_unique<AddKeyframeCommand>("wt", i, "{}", "auto", "w" + std::to_string(i)));
+        }
+        assert(fs::file_size("test_tmp/wal.db-wal") > opt.wal_budget_bytes); // auto-checkpoint is off
+        assert(policy.poll());
+        WalStats st = policy.stats();
+        assert(st.truncate_checkpoints == 1 && st.busy_checkpoints == 0 && fs::file_size("test_tmp/wal.db-wal") == 0);
+        wstack.execute(std::make_unique<AddKeyframeCommand>("wt", 999, "{}", "auto", "w999"));
+        assert(policy.poll() && !policy.poll()); // one PASSIVE for the new commit, then nothing to do
+        st = policy.stats();
+        assert(st.passive_checkpoints == 1 && st.wal_pages > 0 && st.max_checkpoint_ms >= st.last_checkpoint_ms);
+        policy.start();
+        policy.stop();
+    }
+
+    // Read pool: range queries and revision pages on read-only connections beside the writer
+    {
+        prepare_db("test_tmp/reads.db");
+        SqliteStorage ws("test_tmp/reads.db");
+        CommandStack rstack(ws);
+        for (int i = 0; i < 10; ++i) {
+            rstack.execute(std::make_unique<AddKeyframeCommand>("rt", i * 100, "{}", "auto", "r" + std::to_string(i)));
+        }
+        ReadPool pool("test_tmp/reads.db", 2);
+        std::vector<int> times;
+        pool.keyframesInRange("rt", 200, 500, [&](const KeyframeRowView& row) { times.push_back(row.t_ms); });
+        assert((times == std::vector<int> {200, 300, 400, 500}));
+        int64_t after = 0;
+        size_t revs = 0, pages = 0;
+        for (;;) {
+            const int64_t next = pool.revisionsPage(after, 4, [&](int64_t, const RevisionRecord& r) {
+                assert(!r.label.empty());
+                ++revs;
+            });
+            if (next == after) break;
+            after = next;
+            ++pages;
+        }
+        assert(revs == 10 && pages == 3);
+        auto count_all = [](ReadConnection& c) { return c.keyframesInRange("rt", 0, 1 << 30, [](const KeyframeRowView&) {}); };
+        pool.read([&](ReadConnection& c) {
+            const size_t before = count_all(c);
+            rstack.execute(std::make_unique<AddKeyframeCommand>("rt", 1000, "{}", "auto", "r10"));
+            assert(count_all(c) == before); // the read keeps its snapshot while the writer commits
+        });
+        pool.read([&](ReadConnection& c) { assert(count_all(c) == 11 && c.latestRevisionId() == 11); });
+        std::atomic<size_t> rows {0};
+        std::vector<std::thread> readers;
+        for (int t = 0; t < 3; ++t) {
+            readers.emplace_back([&] {
+                for (int q = 0; q < 50; ++q) pool.read([&](ReadConnection& c) { rows += count_all(c); });
+            });
+        }
+        for (int i = 11; i < 31; ++i) {
+            rstack.execute(std::make_unique<AddKeyframeCommand>("rt", i * 100, "{}", "auto", "r" + std::to_string(i)));
+        }
+        for (auto& t : readers) t.join();
+        assert(rows >= 150 * 11 && rows <= 150 * 31);
+    }
+
+    // Keyframe cursor: chunked [t0, t1] reads over several tracks into reused packed arrays
+    {
+        prepare_db("test_tmp/cursor.db");
+        SqliteStorage cs("test_tmp/cursor.db");
+        KeyframeBatch rows;
+        for (int i = 0; i < 10; ++i) {
+            rows.add("ca" + std::to_string(i), "ta", i * 10, "{\"x\":" + std::to_string(i) + "}", "auto");
+            rows.add("cb" + std::to_string(i), "tb", i * 10, "{\"y\":1,\"x\":" + std::to_string(-i) + "}", "auto");
+        }
+        rows.add("cc", "tb", 55, "{\"y\":2}", "auto"); // no x
+        cs.begin();
+        cs.insertKeyframes(rows);
+        cs.commit();
+        KeyframeCursor cursor = cs.keyframeCursor({"tb", "missing", "ta"}, 20, 60);
+        KeyframeChunk chunk(4);
+        std::vector<int> times;
+        std::vector<double> values;
+        std::vector<uint32_t> tracks;
+        size_t chunks = 0;
+        while (cursor.next(chunk) > 0) {
+            ++chunks;
+            times.insert(times.end(), chunk.t_ms.begin(), chunk.t_ms.begin() + long(chunk.size));
+            values.insert(values.end(), chunk.values.begin(), chunk.values.begin() + long(chunk.size));
+            tracks.insert(tracks.end(), chunk.track.begin(), chunk.track.begin() + long(chunk.size));
+        }
+        assert(cursor.done() && cursor.rowsRead() == 11 && chunks == 3 && cursor.malformedRows() == 1);
+        assert((times == std::vector<int> {20, 30, 40, 50, 55, 60, 20, 30, 40, 50, 60}));
+        assert(values[0] == -2.0 && std::isnan(values[4]) && values[6] == 2.0 && values[10] == 6.0);
+        assert(tracks[5] == 0 && tracks[6] == 2);
+        ReadPool pool("test_tmp/cursor.db", 1);
+        pool.read([](ReadConnection& c) {
+            KeyframeCursor rc = c.keyframeCursor({"ta"}, 0, 1000, "x");
+            int t[16];
+            double v[16];
+            uint32_t k[16];
+            assert(rc.next(t, v, k, 16) == 10 && rc.next(t, v, k, 16) == 0 && v[9] == 9.0);
+        });
+    }
+
+    // Columnar track chunks: packed copy for bulk loads, invalidated by edits through the triggers
+    {
+        prepare_db("test_tmp/chunks.db");
+        SqliteStorage ks("test_tmp/chunks.db");
+        KeyframeBatch rows;
+        for (int i = 0; i < 10; ++i) {
+            rows.add("pa" + std::to_string(i), "pa", i * 100, "{\"x\":" + std::to_string(i) + ",\"in\":0.5}", "auto");
+        }
+        for (int i = 0; i < 3; ++i) rows.add("pb" + std::to_string(i), "pb", i * 100, "{\"x\":1}", "bezier");
+        ks.begin();
+        ks.insertKeyframes(rows);
+        ks.commit();
+        TrackPackOptions po;
+        po.chunk_keys = 4;
+        assert(ks.packTrackChunks(po) == 2 && ks.trackChunkLayout() == "x,in,out" && ks.staleTracks().empty());
+        std::vector<Key> decoded;
+        size_t chunks = 0;
+        ks.scanTrackChunks([&](const TrackChunkView& c) {
+            ++chunks;
+            TrackChunkHeader h;
+            assert(decode_track_chunk(c.data, decoded, &h) && h.keys == c.key_count);
+        });
+        assert(chunks == 4 && decoded.size() == 13 && decoded[9].time == 900.f && decoded[9].inTan == 0.5f);
+        assert(!decode_track_chunk("\xC1\x01\x05", decoded) && decoded.size() == 13);
+        auto packed = load_engine_curves(ks);
+        assert(packed.packed_chunks == 4 && packed.rows == 13 && packed.curves.size() == 2);
+        assert(packed.curves[0].track_id == "pa" && evaluate(packed.curves[0].curve_id, 300.f) == 3.f);
+        CommandStack kst(ks);
+        kst.execute(std::make_unique<AddKeyframeCommand>("pb", 5000, "{\"x\":7}", "bezier", "pb-new"));
+        assert((ks.staleTracks() == std::vector<std::string> {"pb"}));
+        auto mixed = load_engine_curves(ks);
+        assert(mixed.packed_chunks == 3 && mixed.rows == 14 && mixed.curves[1].key_count == 4);
+        assert(evaluate(mixed.curves[1].curve_id, 5000.f) == 7.f);
+        assert(ks.packTrackChunks(po) == 1 && ks.staleTracks().empty());
+        EngineLoadOptions rows_only;
+        rows_only.use_track_chunks = false;
+        auto plain = load_engine_curves(ks, rows_only);
+        assert(plain.packed_chunks == 0 && plain.rows == 14 && plain.curves[1].key_count == 4);
+        po.channel = "y";
+        assert(ks.packTrackChunks(po) == 2); // another layout repacks everything
+        assert(load_engine_curves(ks).packed_chunks == 0);
+    }
+
+    // Binary key ids: generated UUIDs from any thread, other text interned, both written compactly
+    {
+        std::vector<KeyIdList> made(4);
+        std::vector<std::thread> workers;
+        for (auto& list : made) {
+            workers.emplace_back([&list] {
+                for (int i = 0; i < 2000; ++i) list.push_back(KeyId::generate());
+            });
+        }
+        for (auto& w : workers) w.join();
+        std::unordered_set<KeyId> unique;
+        for (const auto& list : made) {
+            for (const KeyId& k : list) {
+                assert(k.isUuid() && unique.insert(k).second);
+                const KeyIdText text = k.text();
+                assert(text.view().size() == 36 && text.view()[14] == '4' && KeyId::fromText(text) == k);
+            }
+        }
+        const KeyId named = KeyId::fromText("key1");
+        assert(!named.isUuid() && named == KeyId::fromText(std::string("key") + "1") && named.str() == "key1");
+        const KeyId zero_hi = KeyId::fromText("00000000-0000-0000-0000-00000000002a");
+        assert(!zero_hi.isUuid() && zero_hi.str() == "00000000-0000-0000-0000-00000000002a");
+        assert(KeyId::fromText("").empty() && KeyId().str().empty());
+
+        // id() and ref() of the same UUID share one 16-byte entry, as blobs written before ids were binary
+        const KeyId k = made[0][0];
+        const std::string k_text = k.str();
+        DiffWriter w;
+        w.id(k);
+        w.ref(k_text);
+        w.id(named);
+        const std::string blob(w.finish());
+        assert(blob.size() == 2 + 1 + 1 + 16 + 1 + 4 + 3);
+        DiffReader r(blob);
+        assert(r.id() == k && r.ref() == k_text && r.ref() == "key1" && r.ok() && r.atEnd());
+
+        AddKeyframeCommand generated("gen-track", 1, "{}", "auto");
+        NullStorage none;
+        generated.doAction(none);
+        assert(generated.keyId().isUuid());
+        const MoveSelectionCommand drag(std::vector<std::pair<KeyId, int>> {{k, 1}, {named, 2}}, 5);
+        assert(drag.memoryBytes() == sizeof(drag) + 2 * sizeof(std::pair<KeyId, int>));
+        DiffWriter dw;
+        assert(drag.encodeDiff(dw));
+        auto back = command_from_blob(dw.finish());
+        assert(back && *back->diffJson() == *drag.diffJson());
+        assert(drag.diffJson()->find(k_text) != std::string::npos);
+
+        // JSON diff of a selection of generated ids carries each UUID's text and replays to the same ids
+        std::vector<std::pair<KeyId, int>> uuid_sel;
+        std::string expected = "{\"op\":\"move\",\"delta\":3,\"items\":[";
+        for (int i = 0; i < 8; ++i) {
+            uuid_sel.emplace_back(made[1][size_t(i)], i);
+            if (i) expected += ",";
+            expected += "{\"id\":\"" + made[1][size_t(i)].str() + "\",\"orig_t_ms\":" + std::to_string(i) + "}";
+        }
+        expected += "]}";
+        const MoveSelectionCommand uuid_drag(std::move(uuid_sel), 3);
+        const std::string uuid_json = *uuid_drag.diffJson();
+        assert(uuid_json == expected);
+        auto uuid_back = command_from_diff(uuid_json);
+        DiffWriter uw, bw;
+        assert(uuid_back && uuid_back->encodeDiff(uw) && uuid_drag.encodeDiff(bw) && uw.finish() == bw.finish());
+    }
+
+    // Batch arenas: emplaced commands and their payloads live in the batch's arena
+    {
+        prepare_db("test_tmp/arena.db");
+        SqliteStorage as("test_tmp/arena.db");
+        CommandStack astack(as);
+        const KeyId track = KeyId::fromText("track1");
+        const std::string big(200, 'v'); // past any small-string buffer
+        astack.beginBatch("Arena batch");
+        for (int i = 0; i < 50; ++i) {
+            astack.emplace<AddKeyframeCommand>(track, i * 10, "{\"x\":\"" + big + "\"}", "auto",
+                                               KeyId::fromText("ar" + std::to_string(i)));
+        }
+        astack.endBatch();
+        sqlite3* adb = nullptr;
+        assert(sqlite3_open("test_tmp/arena.db", &adb) == SQLITE_OK);
+        assert(count(adb, "keyframes") == 50 && count(adb, "revisions") == 1 && get_t(adb, "ar7") == 70);
+        astack.undo();
+        assert(count(adb, "keyframes") == 0);
+        astack.redo();
+        assert(count(adb, "keyframes") == 50 && get_t(adb, "ar49") == 490);
+
+        // Every constructor form emplace() uses takes the arena, generated and text ids included
+        static_assert(std::is_constructible_v<AddKeyframeCommand, std::allocator_arg_t, std::pmr::memory_resource*,
+                                              const KeyId&, int, std::string, const char*>);
+        static_assert(std::is_constructible_v<AddKeyframeCommand, std::allocator_arg_t, std::pmr::memory_resource*,
+                                              const char*, int, const char*, const char*, const char*>);
+        CountingResource counted;
+        {
+            const AddKeyframeCommand generated(std::allocator_arg, &counted, track, 5, big, "auto");
+            assert(counted.bytes > big.size());
+        }
+        astack.beginBatch("Generated ids");
+        for (int i = 0; i < 20; ++i) astack.emplace<AddKeyframeCommand>(track, 2000 + i, "{\"x\":\"" + big + "\"}", "auto");
+        astack.emplace<AddKeyframeCommand>("track1", 2100, big, "auto", "named");
+        astack.endBatch();
+        assert(count(adb, "keyframes") == 71 && get_t(adb, "named") == 2100);
+        astack.undo();
+        assert(count(adb, "keyframes") == 50);
+        astack.redo();
+        assert(count(adb, "keyframes") == 71);
+        astack.undo();
+
+        // Outside a batch emplace is execute(make_unique)
+        astack.emplace<AddKeyframeCommand>("track1", 900, "{}", "auto", "solo");
+        assert(get_t(adb, "solo") == 900);
+
+        // A failing child (duplicate id) drops the batch; its arena goes with it
+        astack.beginBatch("Failing batch");
+        astack.emplace<AddKeyframeCommand>(track, 1000, "{\"x\":1}", "auto", KeyId::fromText("fresh"));
+        bool threw = false;
+        try {
+            astack.emplace<AddKeyframeCommand>(track, 1010, "{\"x\":2}", "auto", KeyId::fromText("ar0"));
+        } catch (const std::exception&) {
+            threw = true;
+        }
+        astack.endBatch();
+        assert(threw && count(adb, "keyframes") == 51 && get_t(adb, "ar0") == 0);
+        astack.undo();
+        assert(count(adb, "keyframes") == 50);
+        sqlite3_close(adb);
+    }
+
     sqlite3_close(db);
     return 0;
 }
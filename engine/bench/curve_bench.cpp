@@ -1,44 +1,471 @@
+// Engine benchmark suite.
+//
+// Cases cover key counts (10 -> 1M), all CurveKinds, float/quantized key storage, constant-speed
+// on/off, sequential/random/uniform-range access, blended evaluation and setKeys/LUT build cost.
+// Each case runs warmup passes, then N timed repetitions; percentiles are taken over repetitions.
+//
+// Usage: engine_bench [--quick] [--filter SUBSTR] [--reps N] [--samples N] [--max-keys N]
+//                     [--perf] [--json OUT.json] [--baseline BASE.json] [--threshold 0.10]
+//
+// --json writes one result object per line; --baseline compares p50 against a stored run and
+// exits non-zero when any case regressed by more than --threshold.
 #include "verity/engine.hpp"
+#include <algorithm>
 #include <chrono>
 #include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
 #include <iostream>
+#include <map>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
 #include <vector>
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
 
 using namespace verity;
 
-int main() {
-    // Build 10k-key Hermite curve approximating a sine wave on [0, 10]
-    const int K = 10000;
-    std::vector<Key> keys;
-    keys.reserve(K);
-    for (int i = 0; i < K; ++i) {
-        float t = 10.f * (float(i) / float(K - 1));
-        float v = std::sin(t);
-        // Approximate slope dv/dt of sine = cos(t)
-        float m = std::cos(t);
-        keys.push_back(Key{t, v, m, m});
-    }
-
-    int id = createCurve(CurveKind::Hermite);
-    setKeys(id, keys);
-    setConstantSpeed(id, true); // enable LUT path
-
-    // Evaluate at N sample times and measure wall time
-    const int N = 200000; // 200k evaluations
-    volatile float sink = 0.f; // prevent optimizing away
-    auto t0 = std::chrono::high_resolution_clock::now();
-    for (int i = 0; i < N; ++i) {
-        float x = 10.f * (float(i) / float(N - 1));
-        sink += evaluate(id, x);
-    }
-    auto t1 = std::chrono::high_resolution_clock::now();
-    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count();
-    double per_eval_ns = double(ns) / double(N);
-    double total_ms = double(ns) / 1e6;
-    std::cout << "evals=" << N << ", keys=" << K << ", total_ms=" << total_ms
-              << ", per_eval_ns=" << per_eval_ns << "\n";
-    // Print sink to avoid optimizing away
-    std::cerr << "sink=" << sink << "\n";
-    return 0;
+namespace {
+
+struct Options {
+    std::vector<size_t> keyCounts {10, 100, 1000, 10000, 100000, 1000000};
+    std::string filter;
+    int warmup {2};
+    int reps {15};
+    size_t samples {100000};
+    bool perf {false};
+    std::string jsonPath;
+    std::string baselinePath;
+    double threshold {0.10};
+};
+
+// ---- Hardware counters (Linux perf_event) -----------------------------------------------------
+
+struct CounterValues {
+    uint64_t cycles {0};
+    uint64_t cacheMisses {0};
+    uint64_t branchMisses {0};
+};
+
+class PerfCounters {
+public:
+    explicit PerfCounters(bool enabled) {
+#if defined(__linux__)
+        if (!enabled) return;
+        const uint64_t configs[3] = {PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_CACHE_MISSES,
+                                     PERF_COUNT_HW_BRANCH_MISSES};
+        for (int i = 0; i < 3; ++i) {
+            perf_event_attr attr {};
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.size = sizeof(attr);
+            attr.config = configs[i];
+            attr.disabled = 1;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            fds_[i] = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+            if (fds_[i] < 0) {
+                std::cerr << "perf_event_open unavailable; hardware counters disabled\n";
+                close_all();
+                return;
+            }
+        }
+        active_ = true;
+#else
+        if (enabled) std::cerr << "hardware counters are only supported on Linux\n";
+#endif
+    }
+    ~PerfCounters() { close_all(); }
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+    bool active() const { return active_; }
+
+    void start() {
+#if defined(__linux__)
+        if (!active_) return;
+        for (int fd : fds_) {
+            ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+            ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+#endif
+    }
+
+    CounterValues stop() {
+        CounterValues v;
+#if defined(__linux__)
+        if (!active_) return v;
+        uint64_t out[3] = {0, 0, 0};
+        for (int i = 0; i < 3; ++i) {
+            ioctl(fds_[i], PERF_EVENT_IOC_DISABLE, 0);
+            if (read(fds_[i], &out[i], sizeof(uint64_t)) != sizeof(uint64_t)) out[i] = 0;
+        }
+        v.cycles = out[0];
+        v.cacheMisses = out[1];
+        v.branchMisses = out[2];
+#endif
+        return v;
+    }
+
+private:
+    void close_all() {
+#if defined(__linux__)
+        for (int& fd : fds_) {
+            if (fd >= 0) close(fd);
+            fd = -1;
+        }
+#endif
+        active_ = false;
+    }
+    int fds_[3] {-1, -1, -1};
+    bool active_ {false};
+};
+
+// ---- Case definition and measurement ----------------------------------------------------------
+
+struct Result {
+    std::string name;
+    uint64_t opsPerRep {0};
+    double minNs {0}, meanNs {0}, p50Ns {0}, p90Ns {0}, p99Ns {0}; // per op
+    bool hasCounters {false};
+    double cyclesPerOp {0}, cacheMissesPerOp {0}, branchMissesPerOp {0};
+    bool hasEngineStats {false};
+    double searchStepsPerOp {0}, lutBuildNsPerOp {0}; // from getEngineStats over the timed reps
+};
+
+struct Case {
+    std::string name;
+    uint64_t ops;                  // operations per repetition (for per-op normalization)
+    std::function<void()> setup;   // untimed, before every repetition
+    std::function<float()> body;   // timed
+};
+
+double percentile(std::vector<double> v, double p) {
+    if (v.empty()) return 0.0;
+    std::sort(v.begin(), v.end());
+    const double idx = p * double(v.size() - 1);
+    const size_t lo = size_t(idx);
+    const size_t hi = std::min(lo + 1, v.size() - 1);
+    return v[lo] + (v[hi] - v[lo]) * (idx - double(lo));
+}
+
+volatile float g_sink = 0.f; // keeps evaluation results observable
+
+Result run_case(const Case& c, const Options& opt, PerfCounters& perf) {
+    for (int i = 0; i < opt.warmup; ++i) {
+        if (c.setup) c.setup();
+        g_sink = g_sink + c.body();
+    }
+    std::vector<double> perOp;
+    perOp.reserve(size_t(opt.reps));
+    CounterValues total;
+    resetEngineStats();
+    for (int i = 0; i < opt.reps; ++i) {
+        if (c.setup) c.setup();
+        perf.start();
+        const auto t0 = std::chrono::steady_clock::now();
+        const float r = c.body();
+        const auto t1 = std::chrono::steady_clock::now();
+        const CounterValues cv = perf.stop();
+        g_sink = g_sink + r;
+        total.cycles += cv.cycles;
+        total.cacheMisses += cv.cacheMisses;
+        total.branchMisses += cv.branchMisses;
+        perOp.push_back(double(std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count()) /
+                        double(c.ops));
+    }
+    const EngineStats es = getEngineStats();
+    Result res;
+    res.name = c.name;
+    if (es.enabled) {
+        const double ops = double(c.ops) * double(opt.reps);
+        res.hasEngineStats = true;
+        res.searchStepsPerOp = double(es.searchSteps) / ops;
+        res.lutBuildNsPerOp = double(es.lutBuildNanos) / ops;
+    }
+    res.opsPerRep = c.ops;
+    res.minNs = *std::min_element(perOp.begin(), perOp.end());
+    double sum = 0;
+    for (double v : perOp) sum += v;
+    res.meanNs = sum / double(perOp.size());
+    res.p50Ns = percentile(perOp, 0.50);
+    res.p90Ns = percentile(perOp, 0.90);
+    res.p99Ns = percentile(perOp, 0.99);
+    if (perf.active()) {
+        const double ops = double(c.ops) * double(opt.reps);
+        res.hasCounters = true;
+        res.cyclesPerOp = double(total.cycles) / ops;
+        res.cacheMissesPerOp = double(total.cacheMisses) / ops;
+        res.branchMissesPerOp = double(total.branchMisses) / ops;
+    }
+    return res;
+}
+
+// ---- Workloads --------------------------------------------------------------------------------
+
+const char* kind_name(CurveKind k) {
+    switch (k) {
+    case CurveKind::BezierCubic: return "bezier";
+    case CurveKind::Hermite: return "hermite";
+    case CurveKind::CatmullRom: return "catmullrom";
+    }
+    return "?";
+}
+
+// Sine-like keys on integral millisecond times (so the quantized layout stores exact ticks)
+std::vector<Key> make_keys(size_t n, float phase) {
+    std::vector<Key> keys(n);
+    for (size_t i = 0; i < n; ++i) {
+        const float t = float(i) * 40.f;
+        const float x = t * 0.001f + phase;
+        keys[i] = Key{t, std::sin(x), std::cos(x) * 0.001f, std::cos(x) * 0.001f};
+    }
+    return keys;
+}
+
+std::vector<float> sequential_times(size_t samples, float t1) {
+    std::vector<float> ts(samples);
+    for (size_t i = 0; i < samples; ++i) ts[i] = t1 * float(i) / float(samples - 1);
+    return ts;
+}
+
+std::vector<float> random_times(size_t samples, float t1) {
+    std::mt19937 rng(1234);
+    std::uniform_real_distribution<float> dist(0.f, t1);
+    std::vector<float> ts(samples);
+    for (auto& t : ts) t = dist(rng);
+    return ts;
+}
+
+struct Fixture {
+    int curve[3];  // one scratch curve per kind, reconfigured per case
+    int partner;   // second Hermite curve for blended evaluation
+};
+
+void add_cases(std::vector<Case>& cases, const Fixture& fx, size_t keyCount, const Options& opt) {
+    const float t1 = float(keyCount - 1) * 40.f;
+    auto keys = std::make_shared<std::vector<Key>>(make_keys(keyCount, 0.f));
+    auto seq = std::make_shared<std::vector<float>>(sequential_times(opt.samples, t1));
+    auto rnd = std::make_shared<std::vector<float>>(random_times(opt.samples, t1));
+    auto out = std::make_shared<std::vector<float>>(opt.samples);
+    const std::string keysTag = "/keys=" + std::to_string(keyCount);
+    const uint64_t samples = opt.samples;
+
+    for (CurveKind kind : {CurveKind::BezierCubic, CurveKind::Hermite, CurveKind::CatmullRom}) {
+        const int id = fx.curve[int(kind)];
+        for (KeyStorage storage : {KeyStorage::Float32, KeyStorage::Quantized}) {
+            const char* st = storage == KeyStorage::Float32 ? "float32" : "quantized";
+            for (bool cs : {false, true}) {
+                const std::string tag = std::string("/kind=") + kind_name(kind) + keysTag + "/storage=" + st +
+                                        "/cs=" + (cs ? "on" : "off");
+                // Configure lazily: the first case of each configuration loads the curve
+                auto configure = [id, storage, cs, keys] {
+                    setConstantSpeed(id, false);
+                    setKeyStorage(id, storage);
+                    setKeys(id, *keys);
+                    setConstantSpeed(id, cs);
+                };
+                auto configured = std::make_shared<bool>(false);
+                auto once = [configure, configured] {
+                    if (!*configured) {
+                        configure();
+                        *configured = true;
+                    }
+                };
+
+                cases.push_back({"build" + tag, keyCount, nullptr, [id, storage, cs, keys, configured] {
+                                     setConstantSpeed(id, cs);
+                                     setKeyStorage(id, storage);
+                                     setKeys(id, *keys);
+                                     *configured = true;
+                                     return 0.f;
+                                 }});
+                cases.push_back({"eval_seq" + tag, samples, once, [id, seq] {
+                                     float acc = 0.f;
+                                     for (float t : *seq) acc += evaluate(id, t);
+                                     return acc;
+                                 }});
+                cases.push_back({"eval_random" + tag, samples, once, [id, rnd] {
+                                     float acc = 0.f;
+                                     for (float t : *rnd) acc += evaluate(id, t);
+                                     return acc;
+                                 }});
+                cases.push_back({"eval_range" + tag, samples, once, [id, seq, out] {
+                                     evaluateMany(id, seq->data(), seq->size(), out->data());
+                                     return (*out)[out->size() / 2];
+                                 }});
+            }
+        }
+    }
+
+    // Blended evaluation of two float Hermite curves
+    auto partnerKeys = std::make_shared<std::vector<Key>>(make_keys(keyCount, 1.f));
+    const int a = fx.curve[int(CurveKind::Hermite)];
+    const int b = fx.partner;
+    auto loaded = std::make_shared<bool>(false);
+    cases.push_back({"eval_blended/kind=hermite" + keysTag + "/storage=float32/cs=off", samples,
+                     [a, b, keys, partnerKeys, loaded] {
+                         if (*loaded) return;
+                         setConstantSpeed(a, false);
+                         setKeyStorage(a, KeyStorage::Float32);
+                         setKeys(a, *keys);
+                         setKeys(b, *partnerKeys);
+                         *loaded = true;
+                     },
+                     [a, b, seq] {
+                         float acc = 0.f;
+                         for (float t : *seq) acc += evaluateBlended(a, b, 0.3f, t);
+                         return acc;
+                     }});
+}
+
+// ---- Output and baseline comparison -----------------------------------------------------------
+
+std::string json_line(const Result& r) {
+    std::ostringstream os;
+    os.precision(6);
+    os << "{\"name\":\"" << r.name << "\",\"ops\":" << r.opsPerRep << ",\"min_ns\":" << r.minNs
+       << ",\"mean_ns\":" << r.meanNs << ",\"p50_ns\":" << r.p50Ns << ",\"p90_ns\":" << r.p90Ns
+       << ",\"p99_ns\":" << r.p99Ns;
+    if (r.hasCounters) {
+        os << ",\"cycles_per_op\":" << r.cyclesPerOp << ",\"cache_misses_per_op\":" << r.cacheMissesPerOp
+           << ",\"branch_misses_per_op\":" << r.branchMissesPerOp;
+    }
+    if (r.hasEngineStats) {
+        os << ",\"search_steps_per_op\":" << r.searchStepsPerOp << ",\"lut_build_ns_per_op\":" << r.lutBuildNsPerOp;
+    }
+    os << "}";
+    return os.str();
 }
 
+// Reads files written by --json: one result object per line, name before p50_ns.
+std::map<std::string, double> read_baseline(const std::string& path) {
+    std::map<std::string, double> out;
+    std::ifstream in(path);
+    std::string line;
+    while (std::getline(in, line)) {
+        const auto n = line.find("\"name\":\"");
+        const auto p = line.find("\"p50_ns\":");
+        if (n == std::string::npos || p == std::string::npos) continue;
+        const auto nb = n + 8;
+        const auto ne = line.find('"', nb);
+        if (ne == std::string::npos) continue;
+        out[line.substr(nb, ne - nb)] = std::strtod(line.c_str() + p + 9, nullptr);
+    }
+    return out;
+}
+
+bool parse_args(int argc, char** argv, Options& opt) {
+    for (int i = 1; i < argc; ++i) {
+        const std::string a = argv[i];
+        auto next = [&](const char* flag) -> const char* {
+            if (i + 1 >= argc) {
+                std::cerr << flag << " requires a value\n";
+                std::exit(2);
+            }
+            return argv[++i];
+        };
+        if (a == "--quick") {
+            opt.keyCounts = {10, 1000, 10000};
+            opt.reps = 5;
+            opt.samples = 20000;
+        } else if (a == "--filter") {
+            opt.filter = next("--filter");
+        } else if (a == "--reps") {
+            opt.reps = std::max(1, std::atoi(next("--reps")));
+        } else if (a == "--samples") {
+            opt.samples = std::max<size_t>(2, std::strtoull(next("--samples"), nullptr, 10));
+        } else if (a == "--max-keys") {
+            const size_t m = std::strtoull(next("--max-keys"), nullptr, 10);
+            opt.keyCounts.erase(std::remove_if(opt.keyCounts.begin(), opt.keyCounts.end(),
+                                               [m](size_t k) { return k > m; }),
+                                opt.keyCounts.end());
+        } else if (a == "--perf") {
+            opt.perf = true;
+        } else if (a == "--json") {
+            opt.jsonPath = next("--json");
+        } else if (a == "--baseline") {
+            opt.baselinePath = next("--baseline");
+        } else if (a == "--threshold") {
+            opt.threshold = std::atof(next("--threshold"));
+        } else {
+            std::cerr << "unknown argument: " << a << "\n";
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options opt;
+    if (!parse_args(argc, argv, opt)) return 2;
+
+    Fixture fx {};
+    for (CurveKind kind : {CurveKind::BezierCubic, CurveKind::Hermite, CurveKind::CatmullRom}) {
+        fx.curve[int(kind)] = createCurve(kind);
+    }
+    fx.partner = createCurve(CurveKind::Hermite);
+
+    PerfCounters perf(opt.perf);
+    std::vector<Result> results;
+    for (size_t keyCount : opt.keyCounts) {
+        // Cases are generated per key count so only one size is resident at a time
+        std::vector<Case> cases;
+        add_cases(cases, fx, keyCount, opt);
+        for (const Case& c : cases) {
+            if (!opt.filter.empty() && c.name.find(opt.filter) == std::string::npos) continue;
+            Result r = run_case(c, opt, perf);
+            std::printf("%-72s p50=%9.2f ns  p90=%9.2f ns  p99=%9.2f ns", r.name.c_str(), r.p50Ns, r.p90Ns, r.p99Ns);
+            if (r.hasCounters) {
+                std::printf("  cyc=%.1f cm=%.3f bm=%.3f", r.cyclesPerOp, r.cacheMissesPerOp, r.branchMissesPerOp);
+            }
+            if (r.hasEngineStats) std::printf("  steps=%.2f", r.searchStepsPerOp);
+            std::printf("\n");
+            std::fflush(stdout);
+            results.push_back(std::move(r));
+        }
+    }
+
+    if (!opt.jsonPath.empty()) {
+        std::ofstream out(opt.jsonPath);
+        out << "{\"version\":1,\"results\":[\n";
+        for (size_t i = 0; i < results.size(); ++i) {
+            out << json_line(results[i]) << (i + 1 < results.size() ? ",\n" : "\n");
+        }
+        out << "]}\n";
+    }
+
+    int regressions = 0;
+    if (!opt.baselinePath.empty()) {
+        const auto base = read_baseline(opt.baselinePath);
+        if (base.empty()) {
+            std::cerr << "baseline " << opt.baselinePath << " has no results\n";
+            return 2;
+        }
+        for (const Result& r : results) {
+            auto it = base.find(r.name);
+            if (it == base.end() || it->second <= 0.0) continue;
+            const double ratio = r.p50Ns / it->second;
+            if (ratio > 1.0 + opt.threshold) {
+                ++regressions;
+                std::printf("REGRESSION %-62s %9.2f -> %9.2f ns (%+.1f%%)\n", r.name.c_str(), it->second, r.p50Ns,
+                            (ratio - 1.0) * 100.0);
+            }
+        }
+        std::printf("compared %zu cases against %s: %d regression(s) over %.0f%%\n", results.size(),
+                    opt.baselinePath.c_str(), regressions, opt.threshold * 100.0);
+    }
+    std::cerr << "sink=" << g_sink << "\n";
+    return regressions ? 1 : 0;
+}
@@ -1,6 +1,8 @@
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
+#include <string>
 #include <vector>
 
 namespace verity {
@@ -11,6 +13,12 @@ enum class CurveKind : uint8_t {
     CatmullRom = 2,
 };
 
+// In-memory layout of a curve's keys.
+enum class KeyStorage : uint8_t {
+    Float32 = 0,   // Key array as given (16 bytes per key)
+    Quantized = 1, // int32 time ticks + 16-bit fixed-point value/tangents (10 bytes per key)
+};
+
 struct Key {
     float time;   // milliseconds or normalized seconds
     float value;  // scalar value (position component)
@@ -22,17 +30,64 @@ struct Key {
 int createCurve(CurveKind kind);
 
 // Replace keys for a curve (keys must be sorted by time and contain at least 2 entries).
+// setKeys/setConstantSpeed on distinct curves may run concurrently, provided no curve is being
+// created at the same time (bulk loaders create all curves first, then fill them in parallel).
 void setKeys(int curveId, const std::vector<Key>& keys);
+void setKeys(int curveId, std::vector<Key>&& keys);
 
 // Enable/disable constant-speed evaluation using an arc-length LUT per segment.
 void setConstantSpeed(int curveId, bool enabled);
 
+// Select the key storage layout. Quantized stores times as int32 ticks (1 tick == 1 unit when all
+// key times are integral, e.g. t_ms from the DB) and values/tangents relative to per-curve ranges;
+// decoding happens on the fly during evaluation. Switching re-encodes the current keys.
+void setKeyStorage(int curveId, KeyStorage storage);
+
+// Approximate resident bytes held by a curve (keys + arc-length LUTs).
+size_t curveMemoryBytes(int curveId);
+
 // Evaluate curve at absolute time (uses key times for segment selection).
 float evaluate(int curveId, float time);
 
+// Evaluate `count` sample times in one call. Strides are in bytes so interleaved or NumPy-strided
+// buffers can be read/written in place; monotone sample times reuse the previous segment.
+void evaluateMany(int curveId, const float* times, size_t count, float* out,
+                  ptrdiff_t timeStride = sizeof(float), ptrdiff_t outStride = sizeof(float));
+
 // Evaluate linear blend of two curves at time.
 float evaluateBlended(int curveA, int curveB, float alpha, float time);
 
+// Write the whole engine state (curve ids, keys, arc-length LUTs) to a binary snapshot.
+// `revisionTag` ties the file to the project state it was built from, e.g. the latest revision id.
+// The file is written to `path`.tmp and renamed into place.
+void saveSnapshot(const std::string& path, uint64_t revisionTag);
+
+// Replace the engine state with a snapshot. The file is memory-mapped and copied array-by-array
+// without parsing, sorting or LUT rebuilds. Returns false (leaving the engine untouched) when the
+// file is missing, truncated, of another format version, or tagged with a different revision.
+bool loadSnapshot(const std::string& path, uint64_t revisionTag);
+
+// Engine counters since the last resetEngineStats(), summed over all threads (including threads
+// that have exited). Hot paths bump per-thread relaxed atomics; when the engine is built without
+// VERITY_ENGINE_STATS the counters compile away and stay zero (`enabled` is false). The byte and
+// curve gauges are computed on each call by walking the curves, so they are always populated.
+struct EngineStats {
+    bool enabled {false};
+    uint64_t evaluations[3] {0, 0, 0}; // indexed by CurveKind
+    uint64_t segmentSearches {0};      // binary searches for a key segment
+    uint64_t searchSteps {0};          // bisection steps taken by those searches
+    uint64_t hintedLookups {0};        // batch samples resolved from the previous segment
+    uint64_t lutBuilds {0};            // arc-length LUT rebuilds (one per curve rebuild)
+    uint64_t lutBuildNanos {0};
+    uint64_t setKeysCalls {0};
+    uint64_t curves {0};
+    uint64_t keyBytes {0};
+    uint64_t lutBytes {0};
+};
+
+EngineStats getEngineStats();
+void resetEngineStats();
+
 // Simple helper kept for legacy test; sums 0..n-1
 int evaluate_curve_sample(int n);
 
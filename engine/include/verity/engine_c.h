@@ -0,0 +1,72 @@
+/* Stable C ABI for the curve engine (shared library verity_engine_c).
+ *
+ * Intended for FFI callers (Python ctypes/cffi, NumPy): every bulk function takes raw pointers
+ * plus byte strides, so strided arrays are read and written in place with one call per batch.
+ * Functions never throw; they return VERITY_OK or a negative VERITY_ERR_* code.
+ * The shared library holds its own engine instance, separate from any static verity_engine
+ * linked into the same process.
+ */
+#ifndef VERITY_ENGINE_C_H
+#define VERITY_ENGINE_C_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(_WIN32)
+#if defined(VERITY_ENGINE_C_BUILD)
+#define VERITY_C_API __declspec(dllexport)
+#else
+#define VERITY_C_API __declspec(dllimport)
+#endif
+#else
+#define VERITY_C_API __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define VERITY_ABI_VERSION 1u
+
+enum {
+    VERITY_OK = 0,
+    VERITY_ERR_INVALID_CURVE = -1,
+    VERITY_ERR_INVALID_ARGUMENT = -2,
+    VERITY_ERR_INTERNAL = -3
+};
+
+/* Curve kinds and key storage layouts (values match verity::CurveKind / verity::KeyStorage) */
+enum { VERITY_CURVE_BEZIER_CUBIC = 0, VERITY_CURVE_HERMITE = 1, VERITY_CURVE_CATMULL_ROM = 2 };
+enum { VERITY_KEYS_FLOAT32 = 0, VERITY_KEYS_QUANTIZED = 1 };
+
+/* Returns VERITY_ABI_VERSION of the loaded library; callers should refuse a mismatch. */
+VERITY_C_API uint32_t verity_abi_version(void);
+
+/* Returns the new curve id (>= 0) or a negative error. */
+VERITY_C_API int verity_create_curve(int kind);
+
+/* Replace keys from `count` strided floats (at least 2). Strides are in bytes. `in_tan` and
+ * `out_tan` may be NULL (treated as 0). */
+VERITY_C_API int verity_set_keys(int curve, size_t count, const float* time, ptrdiff_t time_stride, const float* value,
+                                 ptrdiff_t value_stride, const float* in_tan, ptrdiff_t in_stride,
+                                 const float* out_tan, ptrdiff_t out_stride);
+
+VERITY_C_API int verity_set_constant_speed(int curve, int enabled);
+VERITY_C_API int verity_set_key_storage(int curve, int storage);
+
+/* out[i * out_stride] = evaluate(curve, times[i * times_stride]) for i in [0, count). */
+VERITY_C_API int verity_evaluate_many(int curve, size_t count, const float* times, ptrdiff_t times_stride, float* out,
+                                      ptrdiff_t out_stride);
+
+/* Uniform sampling of [t0, t1] into `count` outputs (t1 included when count > 1). */
+VERITY_C_API int verity_evaluate_range(int curve, float t0, float t1, size_t count, float* out, ptrdiff_t out_stride);
+
+/* Blend of two curves: a * (1 - alpha) + b * alpha, per sample. */
+VERITY_C_API int verity_evaluate_blended_many(int curve_a, int curve_b, float alpha, size_t count, const float* times,
+                                              ptrdiff_t times_stride, float* out, ptrdiff_t out_stride);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* VERITY_ENGINE_C_H */
@@ -1,29 +1,172 @@
 #include "verity/engine.hpp"
 #include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
 #include <stdexcept>
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 namespace verity {
 
 namespace {
 
-struct SegmentLUT {
-    // Uniform u samples in [0,1], cumulative arc-length s(u)
-    std::vector<float> u;
-    std::vector<float> s;
-    float total = 0.f;
+// Arc-length LUT resolution per segment; u samples are uniform in [0,1] so only s(u) is stored.
+constexpr int kLutSamples = 64;
+constexpr size_t kLutStride = kLutSamples + 1;
+
+// Compact key layout: time = timeOrigin + tick * timeStep, value = valueMin + q * valueScale,
+// tangent = tanMin + q * tanScale. Arrays are kept separate so the segment search only touches ticks.
+struct QuantizedKeys {
+    std::vector<int32_t> ticks;
+    std::vector<uint16_t> value;
+    std::vector<uint16_t> inTan;
+    std::vector<uint16_t> outTan;
+    double timeOrigin {0.0};
+    double timeStep {1.0};
+    float valueMin {0.f};
+    float valueScale {0.f};
+    float tanMin {0.f};
+    float tanScale {0.f};
 };
 
 struct Curve {
     CurveKind kind {CurveKind::Hermite};
-    std::vector<Key> keys;
+    KeyStorage storage {KeyStorage::Float32};
+    std::vector<Key> keys;  // Float32 storage
+    QuantizedKeys packed;   // Quantized storage
     bool constantSpeed {false};
-    // One LUT per segment (keys.size()-1)
-    std::vector<SegmentLUT> luts;
+    // Flat per-segment LUTs (keys.size()-1 segments): cumulative arc-length s(u) at kLutStride
+    // uniform u samples, followed by the segment total in lutTotal.
+    std::vector<float> lutS;
+    std::vector<float> lutTotal;
+    size_t lutSegments() const { return lutTotal.size(); }
+};
+
+// Read-only views over both key layouts; kernels are templated on these so the float path keeps
+// direct array access while the quantized path decodes per key.
+struct FloatKeyView {
+    const Key* k;
+    size_t n;
+    size_t size() const { return n; }
+    float time(size_t i) const { return k[i].time; }
+    float value(size_t i) const { return k[i].value; }
+    Key key(size_t i) const { return k[i]; }
+    // Search position of `time` in the coordinate space of time(i)
+    float searchKey(float t) const { return t; }
+    float searchAt(size_t i) const { return k[i].time; }
+};
+
+struct QuantizedKeyView {
+    const QuantizedKeys* q;
+    size_t size() const { return q->ticks.size(); }
+    float time(size_t i) const { return float(q->timeOrigin + double(q->ticks[i]) * q->timeStep); }
+    float value(size_t i) const { return q->valueMin + float(q->value[i]) * q->valueScale; }
+    Key key(size_t i) const {
+        return Key{time(i), value(i), q->tanMin + float(q->inTan[i]) * q->tanScale,
+                   q->tanMin + float(q->outTan[i]) * q->tanScale};
+    }
+    double searchKey(float t) const { return (double(t) - q->timeOrigin) / q->timeStep; }
+    int32_t searchAt(size_t i) const { return q->ticks[i]; }
 };
 
 static std::vector<Curve> g_curves;
 
+// ---- Statistics ----
+// Each thread owns a block of relaxed atomics that only it writes (plain load+store, no locked RMW);
+// readers sum all live blocks plus the totals folded in by exited threads. Reset records a baseline
+// instead of writing into other threads' blocks.
+enum Stat : size_t {
+    kStatEvalBezier,
+    kStatEvalHermite,
+    kStatEvalCatmull,
+    // evaluate() calls, one search each; folded into evaluations/segmentSearches when read so the
+    // single-sample path bumps two counters instead of three
+    kStatSingleBezier,
+    kStatSingleHermite,
+    kStatSingleCatmull,
+    kStatSearches,
+    kStatSearchSteps,
+    kStatHintedLookups,
+    kStatLutBuilds,
+    kStatLutBuildNanos,
+    kStatSetKeys,
+    kStatCount
+};
+
+#if VERITY_ENGINE_STATS
+struct StatBlock {
+    std::atomic<uint64_t> v[kStatCount] {};
+};
+
+struct StatRegistry {
+    std::mutex mu;
+    std::vector<StatBlock*> live;
+    uint64_t retired[kStatCount] {};
+    uint64_t baseline[kStatCount] {};
+
+    void totals(uint64_t (&out)[kStatCount]) {
+        for (size_t i = 0; i < kStatCount; ++i) out[i] = retired[i];
+        for (const StatBlock* b : live) {
+            for (size_t i = 0; i < kStatCount; ++i) out[i] += b->v[i].load(std::memory_order_relaxed);
+        }
+    }
+};
+
+static StatRegistry& stat_registry() {
+    static StatRegistry* r = new StatRegistry(); // leaked: thread exits may outlive static teardown
+    return *r;
+}
+
+static thread_local StatBlock* t_stats = nullptr;
+
+struct ThreadStats {
+    StatBlock block;
+    ThreadStats() {
+        auto& r = stat_registry();
+        std::lock_guard<std::mutex> lock(r.mu);
+        r.live.push_back(&block);
+    }
+    ~ThreadStats() {
+        auto& r = stat_registry();
+        std::lock_guard<std::mutex> lock(r.mu);
+        for (size_t i = 0; i < kStatCount; ++i) r.retired[i] += block.v[i].load(std::memory_order_relaxed);
+        r.live.erase(std::find(r.live.begin(), r.live.end(), &block));
+        t_stats = nullptr;
+    }
+};
+
+static StatBlock& thread_stats_slow() {
+    static thread_local ThreadStats holder;
+    t_stats = &holder.block;
+    return holder.block;
+}
+
+// Hot paths look the block up once per call and publish their local sums with stat_bump
+static inline StatBlock& stat_block() { return t_stats ? *t_stats : thread_stats_slow(); }
+
+static inline void stat_bump(StatBlock& b, Stat s, uint64_t n) {
+    auto& c = b.v[s];
+    c.store(c.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+}
+
+static inline void stat_add(Stat s, uint64_t n) { stat_bump(stat_block(), s, n); }
+#define VERITY_STAT_ADD(stat, n) stat_add(stat, static_cast<uint64_t>(n))
+#else
+#define VERITY_STAT_ADD(stat, n) ((void)(n))
+#endif
+
 inline float clamp01(float x) { return x < 0.f ? 0.f : (x > 1.f ? 1.f : x); }
 
 // Hermite basis evaluation for scalar value
@@ -56,12 +199,10 @@ static inline float catmull_rom(float p_1, float p0, float p1, float p2, float u
 }
 
 // dv/du for Hermite (approx for LUT). Here we use small delta for numerical derivative.
-static inline float eval_segment(CurveKind kind,
-                                 const std::vector<Key>& keys,
-                                 size_t i,
-                                 float u) {
-    const Key& k0 = keys[i];
-    const Key& k1 = keys[i + 1];
+template <class View>
+static inline float eval_segment(CurveKind kind, const View& keys, size_t i, float u) {
+    const Key k0 = keys.key(i);
+    const Key k1 = keys.key(i + 1);
     switch (kind) {
     case CurveKind::Hermite: {
         float dt = (k1.time - k0.time);
@@ -76,62 +217,310 @@ static inline float eval_segment(CurveKind kind,
         return bezier_from_hermite(k0.value, k1.value, m0, m1, u);
     }
     case CurveKind::CatmullRom: {
-        float p_1 = (i == 0) ? keys[i].value : keys[i - 1].value;
-        float p2 = (i + 2 < keys.size()) ? keys[i + 2].value : keys[i + 1].value;
+        float p_1 = (i == 0) ? k0.value : keys.value(i - 1);
+        float p2 = (i + 2 < keys.size()) ? keys.value(i + 2) : k1.value;
         return catmull_rom(p_1, k0.value, k1.value, p2, u, 0.5f);
     }
     }
     return 0.f;
 }
 
-static SegmentLUT build_lut(const Curve& c, size_t segIndex, int samples = 64) {
-    SegmentLUT out;
-    out.u.resize(samples + 1);
-    out.s.resize(samples + 1);
-    out.u[0] = 0.f;
-    out.s[0] = 0.f;
-    float prev = eval_segment(c.kind, c.keys, segIndex, 0.f);
+template <class View>
+static float build_lut(CurveKind kind, const View& keys, size_t segIndex, float* s) {
+    s[0] = 0.f;
+    float prev = eval_segment(kind, keys, segIndex, 0.f);
     float accum = 0.f;
-    for (int i = 1; i <= samples; ++i) {
-        float u = float(i) / float(samples);
-        float v = eval_segment(c.kind, c.keys, segIndex, u);
+    for (int i = 1; i <= kLutSamples; ++i) {
+        float u = float(i) / float(kLutSamples);
+        float v = eval_segment(kind, keys, segIndex, u);
         // arc length in value-space along u; approximate via |delta v|
         accum += std::abs(v - prev);
         prev = v;
-        out.u[i] = u;
-        out.s[i] = accum;
+        s[i] = accum;
     }
-    out.total = accum;
-    if (out.total <= 1e-6f) {
+    if (accum <= 1e-6f) {
         // avoid zero-length
-        out.total = 1e-6f;
-        for (auto& s : out.s) s = 0.f;
+        std::fill(s, s + kLutStride, 0.f);
+        return 1e-6f;
     }
-    return out;
+    return accum;
+}
+
+template <class F>
+static decltype(auto) with_keys(const Curve& c, F&& f) {
+    if (c.storage == KeyStorage::Quantized) return f(QuantizedKeyView{&c.packed});
+    return f(FloatKeyView{c.keys.data(), c.keys.size()});
+}
+
+static size_t key_count(const Curve& c) {
+    return c.storage == KeyStorage::Quantized ? c.packed.ticks.size() : c.keys.size();
+}
+
+static void release_luts(Curve& c) {
+    std::vector<float>().swap(c.lutS);
+    std::vector<float>().swap(c.lutTotal);
 }
 
 static void rebuild_luts(Curve& c) {
-    c.luts.clear();
-    if (c.keys.size() < 2) return;
-    c.luts.reserve(c.keys.size() - 1);
-    for (size_t i = 0; i + 1 < c.keys.size(); ++i) {
-        c.luts.emplace_back(build_lut(c, i, 64));
+    const size_t n = key_count(c);
+    // Drop the old tables when the curve shrank a lot so replaced curves don't pin LUT memory
+    if (n < 2 || (n - 1) * kLutStride < c.lutS.capacity() / 2) release_luts(c);
+    c.lutS.clear();
+    c.lutTotal.clear();
+    if (n < 2) return;
+#if VERITY_ENGINE_STATS
+    const auto start = std::chrono::steady_clock::now();
+#endif
+    c.lutS.resize((n - 1) * kLutStride);
+    c.lutTotal.resize(n - 1);
+    with_keys(c, [&](const auto& keys) {
+        for (size_t i = 0; i + 1 < n; ++i) {
+            c.lutTotal[i] = build_lut(c.kind, keys, i, c.lutS.data() + i * kLutStride);
+        }
+    });
+#if VERITY_ENGINE_STATS
+    VERITY_STAT_ADD(kStatLutBuilds, 1);
+    VERITY_STAT_ADD(kStatLutBuildNanos, std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                            std::chrono::steady_clock::now() - start).count());
+#endif
+}
+
+static uint16_t quantize16(float v, float lo, float scale) {
+    if (scale <= 0.f) return 0;
+    float q = std::round((v - lo) / scale);
+    return static_cast<uint16_t>(std::min(65535.f, std::max(0.f, q)));
+}
+
+// Encode sorted keys into the compact layout. Integral times that fit int32 are stored verbatim
+// (t_ms ticks); anything else is mapped onto the full int32 range across the curve's time span.
+static void pack_keys(const std::vector<Key>& keys, QuantizedKeys& out) {
+    const size_t n = keys.size();
+    out = QuantizedKeys{};
+    out.ticks.resize(n);
+    out.value.resize(n);
+    out.inTan.resize(n);
+    out.outTan.resize(n);
+    if (n == 0) return;
+
+    bool integral = true;
+    float vmin = keys[0].value, vmax = keys[0].value;
+    float tmin = keys[0].inTan, tmax = keys[0].inTan;
+    for (const Key& k : keys) {
+        integral = integral && std::nearbyint(k.time) == k.time && std::fabs(k.time) < 2147483647.f;
+        vmin = std::min(vmin, k.value);
+        vmax = std::max(vmax, k.value);
+        tmin = std::min({tmin, k.inTan, k.outTan});
+        tmax = std::max({tmax, k.inTan, k.outTan});
+    }
+    if (integral) {
+        out.timeOrigin = 0.0;
+        out.timeStep = 1.0;
+    } else {
+        const double span = double(keys.back().time) - double(keys.front().time);
+        out.timeOrigin = keys.front().time;
+        out.timeStep = span > 0.0 ? span / 2147483647.0 : 1.0;
+    }
+    out.valueMin = vmin;
+    out.valueScale = (vmax - vmin) / 65535.f;
+    out.tanMin = tmin;
+    out.tanScale = (tmax - tmin) / 65535.f;
+    for (size_t i = 0; i < n; ++i) {
+        const Key& k = keys[i];
+        out.ticks[i] = static_cast<int32_t>(std::llround((double(k.time) - out.timeOrigin) / out.timeStep));
+        out.value[i] = quantize16(k.value, out.valueMin, out.valueScale);
+        out.inTan[i] = quantize16(k.inTan, out.tanMin, out.tanScale);
+        out.outTan[i] = quantize16(k.outTan, out.tanMin, out.tanScale);
     }
 }
 
-static float remap_u_by_arclength(const SegmentLUT& lut, float u_linear) {
-    float target = lut.total * clamp01(u_linear);
+static void unpack_keys(const QuantizedKeys& in, std::vector<Key>& out) {
+    QuantizedKeyView view{&in};
+    out.resize(view.size());
+    for (size_t i = 0; i < out.size(); ++i) out[i] = view.key(i);
+}
+
+static float remap_u_by_arclength(const float* s, float total, float u_linear) {
+    float target = total * clamp01(u_linear);
     // find smallest j with s[j] >= target
-    const auto& s = lut.s;
-    const auto& uu = lut.u;
-    auto it = std::lower_bound(s.begin(), s.end(), target);
-    if (it == s.begin()) return uu.front();
-    if (it == s.end()) return uu.back();
-    size_t j = size_t(it - s.begin());
+    const float* it = std::lower_bound(s, s + kLutStride, target);
+    if (it == s) return 0.f;
+    if (it == s + kLutStride) return 1.f;
+    size_t j = size_t(it - s);
     float s1 = s[j - 1], s2 = s[j];
-    float u1 = uu[j - 1], u2 = uu[j];
+    float u1 = float(j - 1) / float(kLutSamples);
     float t = (target - s1) / std::max(1e-6f, (s2 - s1));
-    return u1 + t * (u2 - u1);
+    return u1 + t / float(kLutSamples);
+}
+
+// ---- Snapshot format -------------------------------------------------------------------------
+// [SnapshotHeader][SnapshotCurve x curveCount][per-curve arrays]. Every section is padded to
+// 8 bytes so the checksum can run over 64-bit words and arrays are naturally aligned in the map.
+// Host byte order; the version is bumped whenever the layout or LUT resolution changes.
+
+constexpr char kSnapshotMagic[8] = {'V', 'R', 'T', 'Y', 'S', 'N', 'A', 'P'};
+constexpr uint32_t kSnapshotVersion = 1;
+
+struct SnapshotHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t curveCount;
+    uint64_t revisionTag;
+    uint64_t payloadBytes; // everything after the header
+    uint64_t checksum;     // over the payload
+};
+
+struct SnapshotCurve {
+    uint8_t kind;
+    uint8_t storage;
+    uint8_t constantSpeed;
+    uint8_t reserved;
+    uint32_t lutStride;
+    uint64_t keyCount;
+    uint64_t lutSegments;
+    double timeOrigin;
+    double timeStep;
+    float valueMin;
+    float valueScale;
+    float tanMin;
+    float tanScale;
+    uint64_t dataOffset; // relative to payload start
+};
+
+static_assert(sizeof(SnapshotHeader) % 8 == 0, "snapshot header must keep 8-byte alignment");
+static_assert(sizeof(SnapshotCurve) % 8 == 0, "snapshot curve record must keep 8-byte alignment");
+
+inline size_t pad8(size_t n) { return (n + 7) & ~size_t(7); }
+
+inline uint64_t checksum_words(uint64_t h, const unsigned char* p, size_t n) {
+    // FNV-1a over 64-bit words; n is always a multiple of 8
+    for (size_t i = 0; i < n; i += 8) {
+        uint64_t w;
+        std::memcpy(&w, p + i, 8);
+        h = (h ^ w) * 0x100000001b3ull;
+    }
+    return h;
+}
+
+constexpr uint64_t kChecksumSeed = 0xcbf29ce484222325ull;
+
+struct CurveArrays {
+    // (pointer, bytes) pairs in on-disk order
+    const void* ptr[6];
+    size_t bytes[6];
+    size_t count;
+};
+
+static CurveArrays curve_arrays(const Curve& c) {
+    CurveArrays a{};
+    auto add = [&a](const void* p, size_t b) {
+        a.ptr[a.count] = p;
+        a.bytes[a.count] = b;
+        ++a.count;
+    };
+    if (c.storage == KeyStorage::Quantized) {
+        const size_t n = c.packed.ticks.size();
+        add(c.packed.ticks.data(), n * sizeof(int32_t));
+        add(c.packed.value.data(), n * sizeof(uint16_t));
+        add(c.packed.inTan.data(), n * sizeof(uint16_t));
+        add(c.packed.outTan.data(), n * sizeof(uint16_t));
+    } else {
+        add(c.keys.data(), c.keys.size() * sizeof(Key));
+    }
+    add(c.lutS.data(), c.lutS.size() * sizeof(float));
+    add(c.lutTotal.data(), c.lutTotal.size() * sizeof(float));
+    return a;
+}
+
+class SnapshotWriter {
+public:
+    explicit SnapshotWriter(std::FILE* f) : f_(f) {}
+    // Append n bytes, zero-padding the tail to the next 8-byte boundary
+    void put(const void* p, size_t n) {
+        const size_t body = n & ~size_t(7);
+        if (body) write(static_cast<const unsigned char*>(p), body);
+        if (n != body) {
+            unsigned char last[8] = {};
+            std::memcpy(last, static_cast<const unsigned char*>(p) + body, n - body);
+            write(last, 8);
+        }
+    }
+    uint64_t checksum() const { return h_; }
+    bool ok() const { return ok_; }
+
+private:
+    void write(const unsigned char* p, size_t n) {
+        h_ = checksum_words(h_, p, n);
+        ok_ = ok_ && std::fwrite(p, 1, n, f_) == n;
+    }
+    std::FILE* f_;
+    uint64_t h_ {kChecksumSeed};
+    bool ok_ {true};
+};
+
+// Read-only file mapping; empty() when the file is missing or cannot be mapped.
+class MappedFile {
+public:
+    explicit MappedFile(const std::string& path) {
+#if defined(_WIN32)
+        file_ = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                            FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (file_ == INVALID_HANDLE_VALUE) return;
+        LARGE_INTEGER size;
+        if (!GetFileSizeEx(file_, &size) || size.QuadPart == 0) return;
+        mapping_ = CreateFileMappingA(file_, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (!mapping_) return;
+        data_ = static_cast<const unsigned char*>(MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0));
+        if (data_) size_ = static_cast<size_t>(size.QuadPart);
+#else
+        fd_ = ::open(path.c_str(), O_RDONLY);
+        if (fd_ < 0) return;
+        struct stat st {};
+        if (::fstat(fd_, &st) != 0 || st.st_size == 0) return;
+        void* p = ::mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd_, 0);
+        if (p == MAP_FAILED) return;
+        ::madvise(p, static_cast<size_t>(st.st_size), MADV_SEQUENTIAL);
+        data_ = static_cast<const unsigned char*>(p);
+        size_ = static_cast<size_t>(st.st_size);
+#endif
+    }
+    ~MappedFile() {
+#if defined(_WIN32)
+        if (data_) UnmapViewOfFile(data_);
+        if (mapping_) CloseHandle(mapping_);
+        if (file_ != INVALID_HANDLE_VALUE) CloseHandle(file_);
+#else
+        if (data_) ::munmap(const_cast<unsigned char*>(data_), size_);
+        if (fd_ >= 0) ::close(fd_);
+#endif
+    }
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const unsigned char* data() const { return data_; }
+    size_t size() const { return size_; }
+    bool empty() const { return data_ == nullptr; }
+
+private:
+#if defined(_WIN32)
+    HANDLE file_ {INVALID_HANDLE_VALUE};
+    HANDLE mapping_ {nullptr};
+#else
+    int fd_ {-1};
+#endif
+    const unsigned char* data_ {nullptr};
+    size_t size_ {0};
+};
+
+template <class T>
+static bool copy_array(const unsigned char* payload, size_t payloadBytes, size_t& offset, size_t count,
+                       std::vector<T>& out) {
+    const size_t bytes = count * sizeof(T);
+    if (count != 0 && bytes / count != sizeof(T)) return false;
+    if (offset > payloadBytes || payloadBytes - offset < bytes) return false;
+    out.resize(count);
+    if (bytes) std::memcpy(out.data(), payload + offset, bytes);
+    offset += pad8(bytes);
+    return true;
 }
 
 } // namespace
@@ -145,12 +534,22 @@ int createCurve(CurveKind kind) {
 }
 
 void setKeys(int curveId, const std::vector<Key>& keys) {
+    setKeys(curveId, std::vector<Key>(keys));
+}
+
+void setKeys(int curveId, std::vector<Key>&& keys) {
     if (curveId < 0 || static_cast<size_t>(curveId) >= g_curves.size()) throw std::out_of_range("curveId");
     if (keys.size() < 2) throw std::invalid_argument("setKeys requires at least two keys");
     auto& c = g_curves[static_cast<size_t>(curveId)];
-    c.keys = keys;
-    // ensure sorted by time
-    std::sort(c.keys.begin(), c.keys.end(), [](const Key& a, const Key& b) { return a.time < b.time; });
+    VERITY_STAT_ADD(kStatSetKeys, 1);
+    c.keys = std::move(keys);
+    // ensure sorted by time (bulk loaders usually hand over already-sorted keys)
+    auto by_time = [](const Key& a, const Key& b) { return a.time < b.time; };
+    if (!std::is_sorted(c.keys.begin(), c.keys.end(), by_time)) std::sort(c.keys.begin(), c.keys.end(), by_time);
+    if (c.storage == KeyStorage::Quantized) {
+        pack_keys(c.keys, c.packed);
+        std::vector<Key>().swap(c.keys);
+    }
     if (c.constantSpeed) rebuild_luts(c);
 }
 
@@ -159,32 +558,138 @@ void setConstantSpeed(int curveId, bool enabled) {
     auto& c = g_curves[static_cast<size_t>(curveId)];
     c.constantSpeed = enabled;
     if (enabled) rebuild_luts(c);
+    else release_luts(c);
+}
+
+void setKeyStorage(int curveId, KeyStorage storage) {
+    if (curveId < 0 || static_cast<size_t>(curveId) >= g_curves.size()) throw std::out_of_range("curveId");
+    auto& c = g_curves[static_cast<size_t>(curveId)];
+    if (c.storage == storage) return;
+    if (storage == KeyStorage::Quantized) {
+        pack_keys(c.keys, c.packed);
+        std::vector<Key>().swap(c.keys);
+    } else {
+        unpack_keys(c.packed, c.keys);
+        c.packed = QuantizedKeys{};
+    }
+    c.storage = storage;
+    // LUTs sample the decoded curve, so they follow the storage precision
+    if (c.constantSpeed) rebuild_luts(c);
 }
 
-static inline size_t find_segment(const std::vector<Key>& keys, float time) {
-    if (time <= keys.front().time) return 0;
-    if (time >= keys.back().time) return keys.size() - 2;
-    size_t lo = 0, hi = keys.size() - 1;
+size_t curveMemoryBytes(int curveId) {
+    if (curveId < 0 || static_cast<size_t>(curveId) >= g_curves.size()) throw std::out_of_range("curveId");
+    const auto& c = g_curves[static_cast<size_t>(curveId)];
+    size_t bytes = sizeof(Curve);
+    bytes += c.keys.capacity() * sizeof(Key);
+    bytes += c.packed.ticks.capacity() * sizeof(int32_t);
+    bytes += (c.packed.value.capacity() + c.packed.inTan.capacity() + c.packed.outTan.capacity()) * sizeof(uint16_t);
+    bytes += (c.lutS.capacity() + c.lutTotal.capacity()) * sizeof(float);
+    return bytes;
+}
+
+// `steps` accumulates bisection steps for the stats counters (dead code when stats are off).
+template <class View>
+static inline size_t find_segment(const View& keys, float time, uint64_t& steps) {
+    const size_t n = keys.size();
+    const auto t = keys.searchKey(time);
+    if (t <= keys.searchAt(0)) return 0;
+    if (t >= keys.searchAt(n - 1)) return n - 2;
+    size_t lo = 0, hi = n - 1;
+    uint64_t taken = 0; // local, so the counter stays in a register through the loop
     while (lo + 1 < hi) {
         size_t mid = (lo + hi) / 2;
-        if (time < keys[mid].time) hi = mid; else lo = mid;
+        if (t < keys.searchAt(mid)) hi = mid; else lo = mid;
+        ++taken;
     }
+    steps += taken;
     return lo;
 }
 
+template <class View>
+static inline float eval_in_segment(const Curve& c, const View& keys, size_t i, float time) {
+    const float t0 = keys.time(i);
+    const float t1 = keys.time(i + 1);
+    float u = (time - t0) / std::max(1e-6f, (t1 - t0));
+    u = clamp01(u);
+    if (c.constantSpeed && i < c.lutSegments()) {
+        u = remap_u_by_arclength(c.lutS.data() + i * kLutStride, c.lutTotal[i], u);
+    }
+    return eval_segment(c.kind, keys, i, u);
+}
+
+// Segment lookup seeded with the previous sample's segment: same or next segment is checked
+// before falling back to the binary search, so monotone sample streams avoid O(log n) per sample.
+template <class View>
+static inline size_t find_segment_hinted(const View& keys, float time, size_t hint, uint64_t& hits,
+                                         uint64_t& searches, uint64_t& steps) {
+    const size_t n = keys.size();
+    const auto t = keys.searchKey(time);
+    if (hint + 1 < n && keys.searchAt(hint) <= t) {
+        if (t < keys.searchAt(hint + 1)) {
+            ++hits;
+            return hint;
+        }
+        if (hint + 2 < n && t < keys.searchAt(hint + 2)) {
+            ++hits;
+            return hint + 1;
+        }
+    }
+    ++searches;
+    return find_segment(keys, time, steps);
+}
+
 float evaluate(int curveId, float time) {
     if (curveId < 0 || static_cast<size_t>(curveId) >= g_curves.size()) throw std::out_of_range("curveId");
     const auto& c = g_curves[static_cast<size_t>(curveId)];
-    if (c.keys.size() < 2) return 0.f;
-    size_t i = find_segment(c.keys, time);
-    const Key& k0 = c.keys[i];
-    const Key& k1 = c.keys[i + 1];
-    float u = (time - k0.time) / std::max(1e-6f, (k1.time - k0.time));
-    u = clamp01(u);
-    if (c.constantSpeed && i < c.luts.size()) {
-        u = remap_u_by_arclength(c.luts[i], u);
+    if (key_count(c) < 2) return 0.f;
+    uint64_t steps = 0;
+    const float v = with_keys(c, [&](const auto& keys) {
+        return eval_in_segment(c, keys, find_segment(keys, time, steps), time);
+    });
+#if VERITY_ENGINE_STATS
+    StatBlock& stats = stat_block();
+    stat_bump(stats, static_cast<Stat>(kStatSingleBezier + size_t(c.kind)), 1);
+    stat_bump(stats, kStatSearchSteps, steps);
+#else
+    (void)steps;
+#endif
+    return v;
+}
+
+void evaluateMany(int curveId, const float* times, size_t count, float* out, ptrdiff_t timeStride,
+                  ptrdiff_t outStride) {
+    if (curveId < 0 || static_cast<size_t>(curveId) >= g_curves.size()) throw std::out_of_range("curveId");
+    const auto& c = g_curves[static_cast<size_t>(curveId)];
+    const auto* in = reinterpret_cast<const unsigned char*>(times);
+    auto* dst = reinterpret_cast<unsigned char*>(out);
+    if (key_count(c) < 2) {
+        for (size_t j = 0; j < count; ++j) {
+            const float zero = 0.f;
+            std::memcpy(dst + ptrdiff_t(j) * outStride, &zero, sizeof(float));
+        }
+        return;
     }
-    return eval_segment(c.kind, c.keys, i, u);
+    uint64_t hits = 0, searches = 0, steps = 0;
+    with_keys(c, [&](const auto& keys) {
+        size_t seg = 0;
+        for (size_t j = 0; j < count; ++j) {
+            float t;
+            std::memcpy(&t, in + ptrdiff_t(j) * timeStride, sizeof(float));
+            seg = find_segment_hinted(keys, t, seg, hits, searches, steps);
+            const float v = eval_in_segment(c, keys, seg, t);
+            std::memcpy(dst + ptrdiff_t(j) * outStride, &v, sizeof(float));
+        }
+    });
+#if VERITY_ENGINE_STATS
+    StatBlock& stats = stat_block();
+    stat_bump(stats, static_cast<Stat>(kStatEvalBezier + size_t(c.kind)), count);
+    stat_bump(stats, kStatHintedLookups, hits);
+    stat_bump(stats, kStatSearches, searches);
+    stat_bump(stats, kStatSearchSteps, steps);
+#else
+    (void)hits, (void)searches, (void)steps;
+#endif
 }
 
 float evaluateBlended(int curveA, int curveB, float alpha, float time) {
@@ -193,6 +698,151 @@ float evaluateBlended(int curveA, int curveB, float alpha, float time) {
     return a * (1.f - alpha) + b * alpha;
 }
 
+void saveSnapshot(const std::string& path, uint64_t revisionTag) {
+    const std::string tmp = path + ".tmp";
+    std::FILE* f = std::fopen(tmp.c_str(), "wb");
+    if (!f) throw std::runtime_error("saveSnapshot: cannot open " + tmp);
+
+    SnapshotHeader header {};
+    std::memcpy(header.magic, kSnapshotMagic, sizeof(kSnapshotMagic));
+    header.version = kSnapshotVersion;
+    header.curveCount = static_cast<uint32_t>(g_curves.size());
+    header.revisionTag = revisionTag;
+    bool ok = std::fwrite(&header, sizeof(header), 1, f) == 1; // placeholder, rewritten below
+
+    // Curve table first so the loader can validate every range before copying
+    SnapshotWriter w(f);
+    size_t offset = g_curves.size() * sizeof(SnapshotCurve);
+    for (const Curve& c : g_curves) {
+        SnapshotCurve rec {};
+        rec.kind = static_cast<uint8_t>(c.kind);
+        rec.storage = static_cast<uint8_t>(c.storage);
+        rec.constantSpeed = c.constantSpeed ? 1 : 0;
+        rec.lutStride = static_cast<uint32_t>(kLutStride);
+        rec.keyCount = key_count(c);
+        rec.lutSegments = c.lutSegments();
+        rec.timeOrigin = c.packed.timeOrigin;
+        rec.timeStep = c.packed.timeStep;
+        rec.valueMin = c.packed.valueMin;
+        rec.valueScale = c.packed.valueScale;
+        rec.tanMin = c.packed.tanMin;
+        rec.tanScale = c.packed.tanScale;
+        rec.dataOffset = offset;
+        const CurveArrays arrays = curve_arrays(c);
+        for (size_t i = 0; i < arrays.count; ++i) offset += pad8(arrays.bytes[i]);
+        w.put(&rec, sizeof(rec));
+    }
+    for (const Curve& c : g_curves) {
+        const CurveArrays arrays = curve_arrays(c);
+        for (size_t i = 0; i < arrays.count; ++i) w.put(arrays.ptr[i], arrays.bytes[i]);
+    }
+
+    header.payloadBytes = offset;
+    header.checksum = w.checksum();
+    ok = ok && w.ok() && std::fseek(f, 0, SEEK_SET) == 0 && std::fwrite(&header, sizeof(header), 1, f) == 1;
+    ok = (std::fclose(f) == 0) && ok;
+    if (!ok) {
+        std::remove(tmp.c_str());
+        throw std::runtime_error("saveSnapshot: write failed for " + tmp);
+    }
+#if defined(_WIN32)
+    if (!MoveFileExA(tmp.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING)) {
+#else
+    if (std::rename(tmp.c_str(), path.c_str()) != 0) {
+#endif
+        std::remove(tmp.c_str());
+        throw std::runtime_error("saveSnapshot: cannot replace " + path);
+    }
+}
+
+bool loadSnapshot(const std::string& path, uint64_t revisionTag) {
+    MappedFile file(path);
+    if (file.empty() || file.size() < sizeof(SnapshotHeader)) return false;
+    SnapshotHeader header;
+    std::memcpy(&header, file.data(), sizeof(header));
+    if (std::memcmp(header.magic, kSnapshotMagic, sizeof(kSnapshotMagic)) != 0) return false;
+    if (header.version != kSnapshotVersion || header.revisionTag != revisionTag) return false;
+    const size_t payloadBytes = file.size() - sizeof(SnapshotHeader);
+    if (header.payloadBytes != payloadBytes || payloadBytes % 8 != 0) return false;
+    const unsigned char* payload = file.data() + sizeof(SnapshotHeader);
+    if (checksum_words(kChecksumSeed, payload, payloadBytes) != header.checksum) return false;
+    if (size_t(header.curveCount) * sizeof(SnapshotCurve) > payloadBytes) return false;
+
+    std::vector<Curve> curves(header.curveCount);
+    for (size_t ci = 0; ci < curves.size(); ++ci) {
+        SnapshotCurve rec;
+        std::memcpy(&rec, payload + ci * sizeof(SnapshotCurve), sizeof(rec));
+        if (rec.kind > uint8_t(CurveKind::CatmullRom) || rec.storage > uint8_t(KeyStorage::Quantized)) return false;
+        if (rec.lutStride != kLutStride) return false;
+        Curve& c = curves[ci];
+        c.kind = static_cast<CurveKind>(rec.kind);
+        c.storage = static_cast<KeyStorage>(rec.storage);
+        c.constantSpeed = rec.constantSpeed != 0;
+        size_t offset = static_cast<size_t>(rec.dataOffset);
+        const auto n = static_cast<size_t>(rec.keyCount);
+        const auto segs = static_cast<size_t>(rec.lutSegments);
+        bool ok = true;
+        if (c.storage == KeyStorage::Quantized) {
+            c.packed.timeOrigin = rec.timeOrigin;
+            c.packed.timeStep = rec.timeStep;
+            c.packed.valueMin = rec.valueMin;
+            c.packed.valueScale = rec.valueScale;
+            c.packed.tanMin = rec.tanMin;
+            c.packed.tanScale = rec.tanScale;
+            ok = copy_array(payload, payloadBytes, offset, n, c.packed.ticks) &&
+                 copy_array(payload, payloadBytes, offset, n, c.packed.value) &&
+                 copy_array(payload, payloadBytes, offset, n, c.packed.inTan) &&
+                 copy_array(payload, payloadBytes, offset, n, c.packed.outTan);
+        } else {
+            ok = copy_array(payload, payloadBytes, offset, n, c.keys);
+        }
+        ok = ok && copy_array(payload, payloadBytes, offset, segs * kLutStride, c.lutS) &&
+             copy_array(payload, payloadBytes, offset, segs, c.lutTotal);
+        if (!ok) return false;
+    }
+    g_curves.swap(curves);
+    return true;
+}
+
+EngineStats getEngineStats() {
+    EngineStats out;
+#if VERITY_ENGINE_STATS
+    uint64_t v[kStatCount];
+    {
+        auto& r = stat_registry();
+        std::lock_guard<std::mutex> lock(r.mu);
+        r.totals(v);
+        for (size_t i = 0; i < kStatCount; ++i) v[i] -= r.baseline[i];
+    }
+    out.enabled = true;
+    out.evaluations[0] = v[kStatEvalBezier] + v[kStatSingleBezier];
+    out.evaluations[1] = v[kStatEvalHermite] + v[kStatSingleHermite];
+    out.evaluations[2] = v[kStatEvalCatmull] + v[kStatSingleCatmull];
+    out.segmentSearches = v[kStatSearches] + v[kStatSingleBezier] + v[kStatSingleHermite] + v[kStatSingleCatmull];
+    out.searchSteps = v[kStatSearchSteps];
+    out.hintedLookups = v[kStatHintedLookups];
+    out.lutBuilds = v[kStatLutBuilds];
+    out.lutBuildNanos = v[kStatLutBuildNanos];
+    out.setKeysCalls = v[kStatSetKeys];
+#endif
+    out.curves = g_curves.size();
+    for (const Curve& c : g_curves) {
+        out.keyBytes += c.keys.capacity() * sizeof(Key) + c.packed.ticks.capacity() * sizeof(int32_t) +
+                        (c.packed.value.capacity() + c.packed.inTan.capacity() + c.packed.outTan.capacity()) *
+                            sizeof(uint16_t);
+        out.lutBytes += (c.lutS.capacity() + c.lutTotal.capacity()) * sizeof(float);
+    }
+    return out;
+}
+
+void resetEngineStats() {
+#if VERITY_ENGINE_STATS
+    auto& r = stat_registry();
+    std::lock_guard<std::mutex> lock(r.mu);
+    r.totals(r.baseline);
+#endif
+}
+
 int evaluate_curve_sample(int n) {
     int acc = 0;
     for (int i = 0; i < n; ++i) acc += i;
@@ -0,0 +1,117 @@
+#include "verity/engine_c.h"
+#include "verity/engine.hpp"
+#include <cstring>
+#include <exception>
+#include <stdexcept>
+#include <vector>
+
+using namespace verity;
+
+namespace {
+
+// Map C++ exceptions onto status codes at the ABI boundary
+template <class F>
+int guarded(F&& f) {
+    try {
+        f();
+        return VERITY_OK;
+    } catch (const std::out_of_range&) {
+        return VERITY_ERR_INVALID_CURVE;
+    } catch (const std::invalid_argument&) {
+        return VERITY_ERR_INVALID_ARGUMENT;
+    } catch (...) {
+        return VERITY_ERR_INTERNAL;
+    }
+}
+
+inline float load_strided(const float* base, ptrdiff_t stride, size_t i) {
+    float v;
+    std::memcpy(&v, reinterpret_cast<const unsigned char*>(base) + ptrdiff_t(i) * stride, sizeof(float));
+    return v;
+}
+
+} // namespace
+
+extern "C" {
+
+uint32_t verity_abi_version(void) { return VERITY_ABI_VERSION; }
+
+int verity_create_curve(int kind) {
+    if (kind < VERITY_CURVE_BEZIER_CUBIC || kind > VERITY_CURVE_CATMULL_ROM) return VERITY_ERR_INVALID_ARGUMENT;
+    int id = -1;
+    const int rc = guarded([&] { id = createCurve(static_cast<CurveKind>(kind)); });
+    return rc == VERITY_OK ? id : rc;
+}
+
+int verity_set_keys(int curve, size_t count, const float* time, ptrdiff_t time_stride, const float* value,
+                    ptrdiff_t value_stride, const float* in_tan, ptrdiff_t in_stride, const float* out_tan,
+                    ptrdiff_t out_stride) {
+    if (!time || !value) return VERITY_ERR_INVALID_ARGUMENT;
+    return guarded([&] {
+        std::vector<Key> keys(count);
+        for (size_t i = 0; i < count; ++i) {
+            keys[i].time = load_strided(time, time_stride, i);
+            keys[i].value = load_strided(value, value_stride, i);
+            keys[i].inTan = in_tan ? load_strided(in_tan, in_stride, i) : 0.f;
+            keys[i].outTan = out_tan ? load_strided(out_tan, out_stride, i) : 0.f;
+        }
+        setKeys(curve, std::move(keys));
+    });
+}
+
+int verity_set_constant_speed(int curve, int enabled) {
+    return guarded([&] { setConstantSpeed(curve, enabled != 0); });
+}
+
+int verity_set_key_storage(int curve, int storage) {
+    if (storage != VERITY_KEYS_FLOAT32 && storage != VERITY_KEYS_QUANTIZED) return VERITY_ERR_INVALID_ARGUMENT;
+    return guarded([&] { setKeyStorage(curve, static_cast<KeyStorage>(storage)); });
+}
+
+int verity_evaluate_many(int curve, size_t count, const float* times, ptrdiff_t times_stride, float* out,
+                         ptrdiff_t out_stride) {
+    if (count && (!times || !out)) return VERITY_ERR_INVALID_ARGUMENT;
+    return guarded([&] { evaluateMany(curve, times, count, out, times_stride, out_stride); });
+}
+
+int verity_evaluate_range(int curve, float t0, float t1, size_t count, float* out, ptrdiff_t out_stride) {
+    if (count && !out) return VERITY_ERR_INVALID_ARGUMENT;
+    return guarded([&] {
+        // Generate times in fixed-size blocks so the batch kernel keeps its segment hint
+        constexpr size_t kBlock = 1024;
+        float block[kBlock];
+        const double step = count > 1 ? (double(t1) - double(t0)) / double(count - 1) : 0.0;
+        auto* dst = reinterpret_cast<unsigned char*>(out);
+        for (size_t base = 0; base < count; base += kBlock) {
+            const size_t n = count - base < kBlock ? count - base : kBlock;
+            for (size_t i = 0; i < n; ++i) block[i] = float(double(t0) + double(base + i) * step);
+            evaluateMany(curve, block, n, reinterpret_cast<float*>(dst + ptrdiff_t(base) * out_stride), sizeof(float),
+                         out_stride);
+        }
+    });
+}
+
+int verity_evaluate_blended_many(int curve_a, int curve_b, float alpha, size_t count, const float* times,
+                                 ptrdiff_t times_stride, float* out, ptrdiff_t out_stride) {
+    if (count && (!times || !out)) return VERITY_ERR_INVALID_ARGUMENT;
+    return guarded([&] {
+        // Evaluate each curve over a block, then blend into the strided output
+        constexpr size_t kBlock = 1024;
+        float a[kBlock];
+        float b[kBlock];
+        auto* dst = reinterpret_cast<unsigned char*>(out);
+        const auto* src = reinterpret_cast<const unsigned char*>(times);
+        for (size_t base = 0; base < count; base += kBlock) {
+            const size_t n = count - base < kBlock ? count - base : kBlock;
+            const auto* t = reinterpret_cast<const float*>(src + ptrdiff_t(base) * times_stride);
+            evaluateMany(curve_a, t, n, a, times_stride, sizeof(float));
+            evaluateMany(curve_b, t, n, b, times_stride, sizeof(float));
+            for (size_t i = 0; i < n; ++i) {
+                const float v = a[i] * (1.f - alpha) + b[i] * alpha;
+                std::memcpy(dst + ptrdiff_t(base + i) * out_stride, &v, sizeof(float));
+            }
+        }
+    });
+}
+
+} // extern "C"
@@ -0,0 +1,59 @@
+/* C ABI smoke test: compiled as C to keep engine_c.h C-compatible. Calls stay outside assert()
+   so the test still exercises the ABI under NDEBUG. */
+#include "verity/engine_c.h"
+#include <assert.h>
+#include <math.h>
+
+static int nearly(float a, float b) { return fabsf(a - b) <= 1e-4f; }
+
+int main(void) {
+    int rc = verity_abi_version();
+    assert(rc == VERITY_ABI_VERSION);
+    rc = verity_create_curve(7);
+    assert(rc == VERITY_ERR_INVALID_ARGUMENT);
+
+    /* Interleaved key records {time, value, in, out} read through byte strides */
+    const float keys[2][4] = {{0.f, 0.f, 0.f, 1.f}, {1.f, 1.f, 1.f, 0.f}};
+    const ptrdiff_t kstride = sizeof(keys[0]);
+    int c = verity_create_curve(VERITY_CURVE_HERMITE);
+    assert(c >= 0);
+    rc = verity_set_keys(c, 2, &keys[0][0], kstride, &keys[0][1], kstride, &keys[0][2], kstride, &keys[0][3], kstride);
+    assert(rc == VERITY_OK);
+    rc = verity_set_keys(c, 1, &keys[0][0], kstride, &keys[0][1], kstride, NULL, 0, NULL, 0);
+    assert(rc == VERITY_ERR_INVALID_ARGUMENT);
+    rc = verity_set_keys(99, 2, &keys[0][0], kstride, &keys[0][1], kstride, NULL, 0, NULL, 0);
+    assert(rc == VERITY_ERR_INVALID_CURVE);
+
+    /* Strided output: write every other float */
+    float times[5] = {0.f, 0.25f, 0.5f, 0.75f, 1.f};
+    float out[10] = {0};
+    rc = verity_evaluate_many(c, 5, times, sizeof(float), out, 2 * sizeof(float));
+    assert(rc == VERITY_OK);
+    assert(nearly(out[0], 0.f) && nearly(out[4], 0.5f) && nearly(out[8], 1.f));
+    assert(out[1] == 0.f);
+
+    float range[5];
+    rc = verity_evaluate_range(c, 0.f, 1.f, 5, range, sizeof(float));
+    assert(rc == VERITY_OK);
+    assert(nearly(range[1], out[2]) && nearly(range[3], out[6]));
+
+    const float flat[2][4] = {{0.f, 1.f, 0.f, 0.f}, {1.f, 1.f, 0.f, 0.f}};
+    int d = verity_create_curve(VERITY_CURVE_HERMITE);
+    rc = verity_set_keys(d, 2, &flat[0][0], kstride, &flat[0][1], kstride, NULL, 0, NULL, 0);
+    assert(rc == VERITY_OK);
+    float blended[5];
+    rc = verity_evaluate_blended_many(c, d, 0.5f, 5, times, sizeof(float), blended, sizeof(float));
+    assert(rc == VERITY_OK);
+    assert(nearly(blended[0], 0.5f) && nearly(blended[4], 1.f));
+
+    rc = verity_set_key_storage(c, VERITY_KEYS_QUANTIZED);
+    assert(rc == VERITY_OK);
+    rc = verity_set_constant_speed(c, 1);
+    assert(rc == VERITY_OK);
+    rc = verity_evaluate_many(c, 5, times, sizeof(float), out, sizeof(float));
+    assert(rc == VERITY_OK);
+    assert(nearly(out[4], 1.f));
+    (void)rc;
+    (void)nearly;
+    return 0;
+}
@@ -2,6 +2,9 @@
 #include "verity/engine.hpp"
 #include <cassert>
 #include <cmath>
+#include <cstdio>
+#include <string>
+#include <thread>
 #include <vector>
 
 using namespace verity;
@@ -71,5 +74,73 @@ int main() {
     setKeys(cb, std::vector<Key>{{0.f, 1.f, 0.f, 0.f}, {1.f, 1.f, 0.f, 0.f}});
     assert(nearly(evaluateBlended(ca, cb, 0.25f, 0.33f), 0.25f));
 
+    // Quantized storage tracks the float layout within the fixed-point resolution and uses less memory
+    std::vector<Key> wave;
+    for (int i = 0; i < 200; ++i) {
+        float t = float(i * 40); // integral t_ms ticks
+        wave.push_back(Key{t, std::sin(t * 0.001f), std::cos(t * 0.001f), std::cos(t * 0.001f)});
+    }
+    int cf = createCurve(CurveKind::Hermite);
+    setKeys(cf, wave);
+    int cq = createCurve(CurveKind::Hermite);
+    setKeyStorage(cq, KeyStorage::Quantized);
+    setKeys(cq, wave);
+    assert(curveMemoryBytes(cq) < curveMemoryBytes(cf));
+    for (int i = 0; i <= 100; ++i) {
+        float t = 7960.f * float(i) / 100.f;
+        assert(nearly(evaluate(cq, t), evaluate(cf, t), 2e-3f));
+    }
+    // Non-integral times and switching layouts back and forth
+    setKeyStorage(c3, KeyStorage::Quantized);
+    assert(nearly(evaluate(c3, 0.5f), v05, 1e-3f));
+    setKeyStorage(c3, KeyStorage::Float32);
+    assert(nearly(evaluate(c3, 0.5f), v05, 1e-3f));
+
+    // Batch evaluation matches per-sample evaluation for sorted, unsorted and strided samples
+    std::vector<float> ts;
+    for (int i = -5; i <= 105; ++i) ts.push_back(80.f * float(i));
+    ts.push_back(40.f);
+    ts.push_back(7999.f);
+    ts.push_back(0.f);
+    std::vector<float> batch(ts.size() * 2, -1.f);
+    evaluateMany(cq, ts.data(), ts.size(), batch.data(), sizeof(float), 2 * sizeof(float));
+    for (size_t i = 0; i < ts.size(); ++i) assert(batch[2 * i] == evaluate(cq, ts[i]));
+    evaluateMany(c3, ts.data(), ts.size(), batch.data());
+    for (size_t i = 0; i < ts.size(); ++i) assert(batch[i] == evaluate(c3, ts[i]));
+
+    // Snapshot round-trip restores curve ids, keys and LUTs; a stale revision tag is rejected
+    const std::string snap = "engine_tests.snap";
+    setConstantSpeed(cq, true);
+    const float cs_before = evaluate(c4, 0.3f);
+    const float q_before = evaluate(cq, 1234.f);
+    saveSnapshot(snap, 42);
+    setKeys(c4, std::vector<Key>{{0.f, 5.f, 0.f, 0.f}, {1.f, 6.f, 0.f, 0.f}});
+    int extra = createCurve(CurveKind::Hermite);
+    assert(!loadSnapshot(snap, 41));
+    assert(!loadSnapshot("missing.snap", 42));
+    assert(loadSnapshot(snap, 42));
+    assert(evaluate(c4, 0.3f) == cs_before);
+    assert(evaluate(cq, 1234.f) == q_before);
+    assert(createCurve(CurveKind::Hermite) == extra); // id space restored
+    std::remove(snap.c_str());
+
+    // Stats: counters since reset, including work done on threads that have since exited
+    resetEngineStats();
+    evaluate(c1, 0.25f);
+    std::thread([&] { evaluateMany(c3, ts.data(), ts.size(), batch.data()); }).join();
+    setKeys(c1, std::vector<Key>{{0.f, 0.f, 0.f, 1.f}, {1.f, 1.f, 1.f, 0.f}});
+    setConstantSpeed(c1, true);
+    EngineStats st = getEngineStats();
+    if (st.enabled) {
+        assert(st.evaluations[int(CurveKind::Hermite)] == 1);
+        assert(st.evaluations[int(CurveKind::CatmullRom)] == ts.size());
+        assert(st.segmentSearches + st.hintedLookups == ts.size() + 1);
+        assert(st.setKeysCalls == 1);
+        assert(st.lutBuilds == 1);
+    }
+    assert(st.curves >= 6 && st.keyBytes > 0 && st.lutBytes > 0);
+    resetEngineStats();
+    assert(getEngineStats().evaluations[int(CurveKind::Hermite)] == 0);
+
     return 0;
 }
@@ -37,14 +37,14 @@ CREATE TABLE projects(id TEXT PRIMARY KEY, name TEXT, version INTEGER, created_a
 CREATE TABLE scenes(id TEXT PRIMARY KEY, project_id TEXT, name TEXT, created_at INTEGER, updated_at INTEGER);
 CREATE TABLE tracks(id TEXT PRIMARY KEY, scene_id TEXT, name TEXT, kind TEXT, created_at INTEGER, updated_at INTEGER);
 CREATE TABLE keyframes(id TEXT PRIMARY KEY, track_id TEXT NOT NULL, t_ms INTEGER NOT NULL, value_json TEXT NOT NULL, interp TEXT NOT NULL, created_at INTEGER, updated_at INTEGER);
-CREATE TABLE revisions(id INTEGER PRIMARY KEY AUTOINCREMENT, project_id TEXT, user TEXT, label TEXT, diff_json TEXT, created_at INTEGER);
+CREATE TABLE revisions(id INTEGER PRIMARY KEY AUTOINCREMENT, project_id TEXT, user TEXT, label TEXT, diff_json TEXT, created_at INTEGER, diff_blob BLOB);
 '@
 
 $projId = sqlite3 "$ProjectName/project.db" "SELECT id FROM projects LIMIT 1;"
 sqlite3 $fresh "INSERT INTO projects(id,name,version,created_at,updated_at) VALUES('$projId','E2E',1,0,0);"
 sqlite3 $fresh "INSERT INTO scenes(id,project_id,name,created_at,updated_at) VALUES('$SCENE','$projId','Act 1',0,0);"
 sqlite3 $fresh "INSERT INTO tracks(id,scene_id,name,kind,created_at,updated_at) VALUES('$TRACK','$SCENE','PathA','curve',0,0);"
-sqlite3 $fresh "ATTACH '$ProjectName/project.db' AS src; INSERT INTO revisions(project_id,user,label,diff_json,created_at) SELECT project_id,user,label,diff_json,created_at FROM src.revisions; DETACH src;"
+sqlite3 $fresh "ATTACH '$ProjectName/project.db' AS src; INSERT INTO revisions(project_id,user,label,diff_json,diff_blob,created_at) SELECT project_id,user,label,diff_json,diff_blob,created_at FROM src.revisions; DETACH src;"
 
 Run "./$BuildDirDesktop/Release/verity_desktop_runner.exe --db $fresh --restore"
 
@@ -29,7 +29,7 @@ CREATE TABLE projects(id TEXT PRIMARY KEY, name TEXT, version INTEGER, created_a
 CREATE TABLE scenes(id TEXT PRIMARY KEY, project_id TEXT, name TEXT, created_at INTEGER, updated_at INTEGER);
 CREATE TABLE tracks(id TEXT PRIMARY KEY, scene_id TEXT, name TEXT, kind TEXT, created_at INTEGER, updated_at INTEGER);
 CREATE TABLE keyframes(id TEXT PRIMARY KEY, track_id TEXT NOT NULL, t_ms INTEGER NOT NULL, value_json TEXT NOT NULL, interp TEXT NOT NULL, created_at INTEGER, updated_at INTEGER);
-CREATE TABLE revisions(id INTEGER PRIMARY KEY AUTOINCREMENT, project_id TEXT, user TEXT, label TEXT, diff_json TEXT, created_at INTEGER);
+CREATE TABLE revisions(id INTEGER PRIMARY KEY AUTOINCREMENT, project_id TEXT, user TEXT, label TEXT, diff_json TEXT, created_at INTEGER, diff_blob BLOB);
 SQL
 
 # Seed rows to satisfy FKs
@@ -39,7 +39,7 @@ sqlite3 "$FRESH" "INSERT INTO scenes(id,project_id,name,created_at,updated_at) V
 sqlite3 "$FRESH" "INSERT INTO tracks(id,scene_id,name,kind,created_at,updated_at) VALUES('$TRACK','$SCENE','PathA','curve',0,0);"
 
 # Copy revisions from original DB
-sqlite3 "$FRESH" "ATTACH '$PROJECT/project.db' AS src; INSERT INTO revisions(project_id,user,label,diff_json,created_at) SELECT project_id,user,label,diff_json,created_at FROM src.revisions; DETACH src;"
+sqlite3 "$FRESH" "ATTACH '$PROJECT/project.db' AS src; INSERT INTO revisions(project_id,user,label,diff_json,diff_blob,created_at) SELECT project_id,user,label,diff_json,diff_blob,created_at FROM src.revisions; DETACH src;"
 
 # Restore from revisions into the fresh DB
 "$DESKTOP_BUILD_DIR/verity_desktop_runner" --db "$FRESH" --restore
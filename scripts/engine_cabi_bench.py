@@ -0,0 +1,150 @@
+#!/usr/bin/env python3
+"""Benchmark the verity_engine C ABI from Python.
+
+Compares one ctypes call per sample against a single bulk call that fills a caller-provided
+buffer (NumPy array when available, otherwise array('f')) in place.
+
+Usage:
+  python scripts/engine_cabi_bench.py [--lib path/to/libverity_engine_c.so] [--samples 1000000]
+
+Build the library first:
+  cmake -S engine -B engine/build && cmake --build engine/build --target verity_engine_c
+"""
+from __future__ import annotations
+
+import argparse
+import ctypes
+import math
+import sys
+import time
+from array import array
+from pathlib import Path
+
+ROOT = Path(__file__).resolve().parents[1]
+LIB_NAMES = ("libverity_engine_c.so", "libverity_engine_c.dylib", "verity_engine_c.dll")
+SEARCH_DIRS = ("engine/build", "engine/build/Release", "_gate_build/engine")
+
+c_float_p = ctypes.POINTER(ctypes.c_float)
+
+
+def find_library(explicit: str | None) -> Path:
+    if explicit:
+        return Path(explicit)
+    for d in SEARCH_DIRS:
+        for name in LIB_NAMES:
+            cand = ROOT / d / name
+            if cand.exists():
+                return cand
+    raise FileNotFoundError("verity_engine_c not found; pass --lib")
+
+
+def load(path: Path) -> ctypes.CDLL:
+    lib = ctypes.CDLL(str(path))
+    lib.verity_abi_version.restype = ctypes.c_uint32
+    lib.verity_create_curve.argtypes = [ctypes.c_int]
+    lib.verity_create_curve.restype = ctypes.c_int
+    lib.verity_set_keys.argtypes = [
+        ctypes.c_int,
+        ctypes.c_size_t,
+        c_float_p,
+        ctypes.c_ssize_t,
+        c_float_p,
+        ctypes.c_ssize_t,
+        c_float_p,
+        ctypes.c_ssize_t,
+        c_float_p,
+        ctypes.c_ssize_t,
+    ]
+    lib.verity_set_keys.restype = ctypes.c_int
+    lib.verity_evaluate_many.argtypes = [
+        ctypes.c_int,
+        ctypes.c_size_t,
+        c_float_p,
+        ctypes.c_ssize_t,
+        c_float_p,
+        ctypes.c_ssize_t,
+    ]
+    lib.verity_evaluate_many.restype = ctypes.c_int
+    lib.verity_evaluate_range.argtypes = [
+        ctypes.c_int,
+        ctypes.c_float,
+        ctypes.c_float,
+        ctypes.c_size_t,
+        c_float_p,
+        ctypes.c_ssize_t,
+    ]
+    lib.verity_evaluate_range.restype = ctypes.c_int
+    return lib
+
+
+def float_buffer(n: int):
+    """Return (buffer, float*) for a contiguous float32 array of length n."""
+    try:
+        import numpy as np
+
+        buf = np.zeros(n, dtype=np.float32)
+        return buf, buf.ctypes.data_as(c_float_p)
+    except ImportError:
+        buf = array("f", bytes(4 * n))
+        addr, _ = buf.buffer_info()
+        return buf, ctypes.cast(addr, c_float_p)
+
+
+def check(rc: int, what: str) -> None:
+    if rc != 0:
+        raise RuntimeError(f"{what} failed with status {rc}")
+
+
+def main(argv: list[str]) -> int:
+    ap = argparse.ArgumentParser()
+    ap.add_argument("--lib")
+    ap.add_argument("--keys", type=int, default=10000)
+    ap.add_argument("--samples", type=int, default=1000000)
+    ap.add_argument("--loop-samples", type=int, default=100000)
+    args = ap.parse_args(argv)
+
+    lib = load(find_library(args.lib))
+    if lib.verity_abi_version() != 1:
+        raise RuntimeError("unexpected verity_engine_c ABI version")
+
+    # Sine wave keys on [0, 10], interleaved as {time, value, in, out} records
+    k = args.keys
+    keys, kp = float_buffer(4 * k)
+    for i in range(k):
+        t = 10.0 * i / (k - 1)
+        keys[4 * i] = t
+        keys[4 * i + 1] = math.sin(t)
+        keys[4 * i + 2] = math.cos(t)
+        keys[4 * i + 3] = math.cos(t)
+    curve = lib.verity_create_curve(1)  # Hermite
+    base = ctypes.cast(kp, ctypes.c_void_p).value
+    rec = 16
+    fields = [ctypes.cast(base + 4 * j, c_float_p) for j in range(4)]
+    strided = [arg for f in fields for arg in (f, rec)]
+    check(lib.verity_set_keys(curve, k, *strided), "set_keys")
+
+    # One FFI call per sample (what a pure-Python sampling loop costs)
+    n_loop = args.loop_samples
+    one_t, one_tp = float_buffer(1)
+    one_out, one_op = float_buffer(1)
+    t0 = time.perf_counter()
+    for i in range(n_loop):
+        one_t[0] = 10.0 * i / (n_loop - 1)
+        lib.verity_evaluate_many(curve, 1, one_tp, 4, one_op, 4)
+    loop_s = time.perf_counter() - t0
+
+    # One bulk call over caller-provided buffers
+    n = args.samples
+    out, op = float_buffer(n)
+    t0 = time.perf_counter()
+    check(lib.verity_evaluate_range(curve, 0.0, 10.0, n, op, 4), "evaluate_range")
+    bulk_s = time.perf_counter() - t0
+
+    print(f"per-call loop: samples={n_loop} ns_per_sample={loop_s / n_loop * 1e9:.1f}")
+    print(f"bulk call: samples={n} ns_per_sample={bulk_s / n * 1e9:.1f} ms={bulk_s * 1e3:.2f}")
+    print(f"check: out[n//2]={out[n // 2]:.5f} sin(5)={math.sin(5.0):.5f}")
+    return 0
+
+
+if __name__ == "__main__":
+    raise SystemExit(main(sys.argv[1:]))